@@ -1,10 +1,79 @@
 #include "binary.h"
 #include <string>
+
+#if defined(__AVX2__) || defined(__SSSE3__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 namespace nomp {
 	static void checkBinary() {
 		pro::make_proxy<interface::Encoder, BigEndian>();
 	}
 
+    // Copies |count| values of type T from |src| to |dst|, swapping the byte order of
+    // each on little endian targets. Swapping is its own inverse, so this both encodes
+    // and decodes.
+    template <typename T>
+    static void swapCopy(std::byte* dst, const std::byte* src, size_t count) {
+        if constexpr (std::endian::native == std::endian::big) {
+            std::memcpy(dst, src, count * sizeof(T));
+            return;
+        }
+        size_t i = 0;
+#if defined(__AVX2__)
+        // shuffles stay within 128-bit lanes, which never split a value
+        const __m256i mask = sizeof(T) == 8 ?
+            _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8) :
+            _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12, 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+        for (constexpr size_t step = 32 / sizeof(T); i + step <= count; i += step) {
+            const auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * sizeof(T)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * sizeof(T)), _mm256_shuffle_epi8(v, mask));
+        }
+#elif defined(__SSSE3__)
+        const __m128i mask = sizeof(T) == 8 ?
+            _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8) :
+            _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+        for (constexpr size_t step = 16 / sizeof(T); i + step <= count; i += step) {
+            const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * sizeof(T)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * sizeof(T)), _mm_shuffle_epi8(v, mask));
+        }
+#elif defined(__ARM_NEON)
+        for (constexpr size_t step = 16 / sizeof(T); i + step <= count; i += step) {
+            auto v = vld1q_u8(reinterpret_cast<const uint8_t*>(src + i * sizeof(T)));
+            v = sizeof(T) == 8 ? vrev64q_u8(v) : vrev32q_u8(v);
+            vst1q_u8(reinterpret_cast<uint8_t*>(dst + i * sizeof(T)), v);
+        }
+#endif
+        for (; i < count; ++i) {
+            T v;
+            std::memcpy(&v, src + i * sizeof(T), sizeof(T));
+            v = std::byteswap(v);
+            std::memcpy(dst + i * sizeof(T), &v, sizeof(T));
+        }
+    }
+
+    void BigEndian::writeUint64s(std::span<std::byte> buf, std::span<const uint64_t> values) {
+        if (buf.size() < values.size_bytes()) throw std::invalid_argument("Buffer too small for uint64 array");
+        swapCopy<uint64_t>(buf.data(), reinterpret_cast<const std::byte*>(values.data()), values.size());
+    }
+
+    void BigEndian::writeUint32s(std::span<std::byte> buf, std::span<const uint32_t> values) {
+        if (buf.size() < values.size_bytes()) throw std::invalid_argument("Buffer too small for uint32 array");
+        swapCopy<uint32_t>(buf.data(), reinterpret_cast<const std::byte*>(values.data()), values.size());
+    }
+
+    void BigEndian::readUint64s(std::span<const std::byte> buf, std::span<uint64_t> values) {
+        if (buf.size() < values.size_bytes()) throw std::invalid_argument("Buffer too small for uint64 array");
+        swapCopy<uint64_t>(reinterpret_cast<std::byte*>(values.data()), buf.data(), values.size());
+    }
+
+    void BigEndian::readUint32s(std::span<const std::byte> buf, std::span<uint32_t> values) {
+        if (buf.size() < values.size_bytes()) throw std::invalid_argument("Buffer too small for uint32 array");
+        swapCopy<uint32_t>(reinterpret_cast<std::byte*>(values.data()), buf.data(), values.size());
+    }
+
     uint32_t crc32(const std::byte* data, size_t length) {
         uint32_t crc = 0xFFFFFFFF;
         for (size_t i = 0; i < length; ++i) {
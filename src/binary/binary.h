@@ -1,5 +1,8 @@
 #pragma once 
 #include "common.h"
+#include <bit>
+#include <concepts>
+#include <cstring>
 
 namespace nomp {
     namespace interface {
@@ -30,17 +33,59 @@ namespace nomp {
 		};
     }
     class BigEndian {
+            template <std::unsigned_integral T>
+            static constexpr T load(const std::byte* p) {
+                if consteval {
+                    T v = 0;
+                    for (size_t i = 0; i < sizeof(T); ++i) {
+                        v = T(v << 8) | T(p[i]);
+                    }
+                    return v;
+                }
+                else {
+                    T v;
+                    std::memcpy(&v, p, sizeof(T));
+                    if constexpr (std::endian::native == std::endian::little) {
+                        v = std::byteswap(v);
+                    }
+                    return v;
+                }
+            }
+
+            template <std::unsigned_integral T>
+            static constexpr void store(std::byte* p, T v) {
+                if consteval {
+                    for (size_t i = sizeof(T); i-- > 0; v = T(v >> 8)) {
+                        p[i] = std::byte(v & 0xFF);
+                    }
+                }
+                else {
+                    if constexpr (std::endian::native == std::endian::little) {
+                        v = std::byteswap(v);
+                    }
+                    std::memcpy(p, &v, sizeof(T));
+                }
+            }
+
         public:
+            // Unchecked versions for hot loops, |p| must have room for the value.
+            static constexpr uint64_t loadUint64(const std::byte* p) { return load<uint64_t>(p); }
+            static constexpr uint32_t loadUint32(const std::byte* p) { return load<uint32_t>(p); }
+            static constexpr uint16_t loadUint16(const std::byte* p) { return load<uint16_t>(p); }
+            static constexpr void storeUint64(std::byte* p, uint64_t v) { store(p, v); }
+            static constexpr void storeUint32(std::byte* p, uint32_t v) { store(p, v); }
+            static constexpr void storeUint16(std::byte* p, uint16_t v) { store(p, v); }
+
+            // Bulk versions, convert a whole array with SIMD byte shuffles where the
+            // target supports them. The byte span must hold at least values.size() values.
+            static void writeUint64s(std::span<std::byte> buf, std::span<const uint64_t> values);
+            static void writeUint32s(std::span<std::byte> buf, std::span<const uint32_t> values);
+            static void readUint64s(std::span<const std::byte> buf, std::span<uint64_t> values);
+            static void readUint32s(std::span<const std::byte> buf, std::span<uint32_t> values);
+
             static void writeUint64(std::span<std::byte> buf, uint64_t v) {
                 if (buf.size() < 8) throw std::invalid_argument("Buffer too small for uint64");
-                buf[0] = static_cast<std::byte>((v >> 56) & 0xFF);
-                buf[1] = static_cast<std::byte>((v >> 48) & 0xFF);
-                buf[2] = static_cast<std::byte>((v >> 40) & 0xFF);
-                buf[3] = static_cast<std::byte>((v >> 32) & 0xFF);
-                buf[4] = static_cast<std::byte>((v >> 24) & 0xFF);
-                buf[5] = static_cast<std::byte>((v >> 16) & 0xFF);
-                buf[6] = static_cast<std::byte>((v >> 8) & 0xFF);
-                buf[7] = static_cast<std::byte>(v & 0xFF);
+                storeUint64(buf.data(), v);
             }
 
             static void writeUint64(interface::IWriter writer, uint64_t v) {
@@ -51,8 +96,7 @@ namespace nomp {
 
             static uint64_t uint64(std::span<const std::byte> buf) {
                 if (buf.size() < 8) throw std::invalid_argument("Buffer too small for uint64");
-                return uint64_t(buf[7]) | uint64_t(buf[6])<<8 | uint64_t(buf[5])<<16 | uint64_t(buf[4])<<24
-                     | uint64_t(buf[3])<<32 | uint64_t(buf[2])<<40 | uint64_t(buf[1])<<48 | uint64_t(buf[0])<<56;
+                return loadUint64(buf.data());
             }
 
             static void readUint64(interface::IReader reader, uint64_t& v) {
@@ -65,10 +109,7 @@ namespace nomp {
 
             static void writeUint32(std::span<std::byte> buf, uint32_t v) {
                 if (buf.size() < 4) throw std::invalid_argument("Buffer too small for uint32");
-                buf[0] = static_cast<std::byte>((v >> 24) & 0xFF);
-                buf[1] = static_cast<std::byte>((v >> 16) & 0xFF);
-                buf[2] = static_cast<std::byte>((v >> 8) & 0xFF);
-                buf[3] = static_cast<std::byte>(v & 0xFF);
+                storeUint32(buf.data(), v);
             }
 
             static void writeUint32(interface::IWriter writer, uint32_t v) {
@@ -79,7 +120,7 @@ namespace nomp {
 
             static uint32_t uint32(std::span<const std::byte> buf) {
                 if (buf.size() < 4) throw std::invalid_argument("Buffer too small for uint32");
-                return uint32_t(buf[3]) | uint32_t(buf[2])<<8 | uint32_t(buf[1])<<16 | uint32_t(buf[0])<<24;
+                return loadUint32(buf.data());
             }
 
             static void readUint32(interface::IReader reader, uint32_t& v) {
@@ -92,8 +133,7 @@ namespace nomp {
 
             static void writeUint16(std::span<std::byte> buf, uint16_t v) {
                 if (buf.size() < 2) throw std::invalid_argument("Buffer too small for uint16");
-                buf[0] = static_cast<std::byte>((v >> 8) & 0xFF);
-                buf[1] = static_cast<std::byte>(v & 0xFF);
+                storeUint16(buf.data(), v);
             }
 
             static void writeUint16(interface::IWriter writer, uint16_t v) {
@@ -104,7 +144,7 @@ namespace nomp {
 
             static uint16_t uint16(std::span<const std::byte> buf) {
                 if (buf.size() < 2) throw std::invalid_argument("Buffer too small for uint16");
-                return uint16_t(buf[1]) | uint16_t(buf[0])<<8;
+                return loadUint16(buf.data());
             }
 
             static void readUint16(interface::IReader reader, uint16_t& v) {
@@ -0,0 +1,33 @@
+#include <benchmark/benchmark.h>
+#include "binary/all.h"
+#include <random>
+#include <vector>
+
+using namespace nomp;
+
+static void BM_Crc32(benchmark::State& state) {
+	std::vector<std::byte> data(size_t(state.range(0)));
+	std::mt19937 rng(42);
+	for (auto& b : data) {
+		b = std::byte(rng());
+	}
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(crc32(data));
+	}
+	state.SetBytesProcessed(int64_t(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_Crc32)->RangeMultiplier(4)->Range(64, 1 << 20);
+
+static void BM_WriteUint64s(benchmark::State& state) {
+	std::vector<uint64_t> values(size_t(state.range(0)));
+	for (size_t i = 0; i < values.size(); ++i) {
+		values[i] = i * 0x9E3779B97F4A7C15ULL;
+	}
+	std::vector<std::byte> buf(values.size() * sizeof(uint64_t));
+	for (auto _ : state) {
+		BigEndian::writeUint64s(buf, values);
+		benchmark::DoNotOptimize(buf.data());
+	}
+	state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(buf.size()));
+}
+BENCHMARK(BM_WriteUint64s)->Range(1 << 10, 1 << 20);
@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 #include "binary.h"
+#include <vector>
 
 TEST(BinaryTest, TestBigEndian) {
 	uint64_t v64 = 0x0123456789ABCDEF;
@@ -33,4 +34,39 @@ TEST(BinaryTest, TestBigEndian) {
 	EXPECT_EQ(buf16[1], std::byte{ 0xEF });
 	uint16_t v16_read = nomp::BigEndian::uint16(std::span{ buf16, 2 });
 	EXPECT_EQ(v16, v16_read);
-}
\ No newline at end of file
+}
+
+TEST(BinaryTest, TestBulkBigEndian) {
+	// odd sizes exercise both the vector loop and the scalar tail
+	for (size_t n : { 0, 1, 3, 4, 17, 64, 1001 }) {
+		std::vector<uint64_t> v64(n);
+		std::vector<uint32_t> v32(n);
+		for (size_t i = 0; i < n; ++i) {
+			v64[i] = 0x0123456789ABCDEFULL * (i + 1);
+			v32[i] = uint32_t(0x89ABCDEF * (i + 1));
+		}
+		std::vector<std::byte> buf64(n * 8), buf32(n * 4);
+		nomp::BigEndian::writeUint64s(buf64, v64);
+		nomp::BigEndian::writeUint32s(buf32, v32);
+		for (size_t i = 0; i < n; ++i) {
+			EXPECT_EQ(nomp::BigEndian::uint64(std::span{ buf64 }.subspan(i * 8)), v64[i]);
+			EXPECT_EQ(nomp::BigEndian::uint32(std::span{ buf32 }.subspan(i * 4)), v32[i]);
+		}
+		std::vector<uint64_t> r64(n);
+		std::vector<uint32_t> r32(n);
+		nomp::BigEndian::readUint64s(buf64, r64);
+		nomp::BigEndian::readUint32s(buf32, r32);
+		EXPECT_EQ(r64, v64);
+		EXPECT_EQ(r32, v32);
+	}
+	std::vector<std::byte> small(7);
+	std::vector<uint64_t> one(1);
+	EXPECT_THROW(nomp::BigEndian::writeUint64s(small, one), std::invalid_argument);
+}
+
+static constexpr uint32_t constexprRoundTrip(uint32_t v) {
+	std::byte buf[4]{};
+	nomp::BigEndian::storeUint32(buf, v);
+	return buf[0] == std::byte{ uint8_t(v >> 24) } ? nomp::BigEndian::loadUint32(buf) : 0;
+}
+static_assert(constexprRoundTrip(0x89ABCDEF) == 0x89ABCDEF);
@@ -4,7 +4,9 @@
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <optional>
 #include <queue>
+#include <stdexcept>
 #include "proxy.h"
 
 using pro::proxy;
@@ -12,36 +14,60 @@ using pro::proxy;
 namespace nomp {
 
 
+// Channel passes values between threads in FIFO order. A channel built with a
+// capacity makes send() wait while that many values are queued, which bounds the
+// memory a fast producer can tie up ahead of a slow consumer.
 template <typename T>
 class Channel {
 private:
     std::queue<T> queue;
     std::mutex mtx;
     std::condition_variable cond_var;
+    std::condition_variable not_full;
+    size_t capacity;
     bool is_closed = false;
 
 public:
+    explicit Channel(size_t capacity = 0) : capacity(capacity) {} // 0 is unbounded
+
     void send(T value) {
         std::unique_lock<std::mutex> lock(mtx);
+        not_full.wait(lock, [this] { return capacity == 0 || queue.size() < capacity || is_closed; });
+        if (is_closed) {
+            throw std::runtime_error("Channel is closed");
+        }
         queue.push(std::move(value));
         cond_var.notify_one();
     }
 
     T receive() {
+        auto value = next();
+        if (!value.has_value()) {
+            throw std::runtime_error("Channel is closed");
+        }
+        return std::move(*value);
+    }
+
+    // Like receive(), but returns nullopt instead of throwing once the channel is
+    // closed and drained.
+    std::optional<T> next() {
         std::unique_lock<std::mutex> lock(mtx);
         cond_var.wait(lock, [this] { return !queue.empty() || is_closed; });
-        if (is_closed && queue.empty()) {
-            throw std::runtime_error("Channel is closed");
+        if (queue.empty()) {
+            return std::nullopt;
         }
-        T value = queue.front();
+        std::optional<T> value(std::move(queue.front()));
         queue.pop();
+        not_full.notify_one();
         return value;
     }
 
+    // Values already queued can still be received; sending to a closed channel throws.
     void close() {
         std::unique_lock<std::mutex> lock(mtx);
         is_closed = true;
         cond_var.notify_all(); // Wake up all waiting threads
+        not_full.notify_all();
     }
 };
 
@@ -0,0 +1,33 @@
+#include <benchmark/benchmark.h>
+#include "channel.h"
+#include <thread>
+#include <vector>
+
+using namespace nomp;
+
+// One consumer draining range(0) producers.
+static void BM_ChannelThroughput(benchmark::State& state) {
+	const int producers = int(state.range(0));
+	constexpr int PerProducer = 10000;
+	for (auto _ : state) {
+		Channel<int> ch;
+		std::vector<std::thread> threads;
+		for (int p = 0; p < producers; ++p) {
+			threads.emplace_back([&] {
+				for (int i = 0; i < PerProducer; ++i) {
+					ch.send(i);
+				}
+			});
+		}
+		int64_t sum = 0;
+		for (int i = 0; i < producers * PerProducer; ++i) {
+			sum += ch.receive();
+		}
+		for (auto& t : threads) {
+			t.join();
+		}
+		benchmark::DoNotOptimize(sum);
+	}
+	state.SetItemsProcessed(int64_t(state.iterations()) * producers * PerProducer);
+}
+BENCHMARK(BM_ChannelThroughput)->RangeMultiplier(2)->Range(1, 8)->UseRealTime();
@@ -1,3 +1,10 @@
 #pragma once
 #include "chunk.h"
-#include "chunk_store.h"
\ No newline at end of file
+#include "chunk_trie.h"
+#include "stats.h"
+#include "chunk_store.h"
+#include "refs.h"
+#include "walk.h"
+#include "chunker.h"
+#include "diff.h"
+#include "pull.h"
\ No newline at end of file
@@ -19,7 +19,7 @@ namespace nomp {
 			Len // 4 bytes
 			Data // Len bytes
 	*/
-	void Chunk::serialize(interface::IWriter writer) {
+	void Chunk::serialize(interface::IWriter writer) const {
 		writer->write(r);
 		// Because of chunking at higher levels, no chunk should never be more than 4GB
 		BigEndian::writeUint32(writer, static_cast<uint32_t>(size()));
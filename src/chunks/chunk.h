@@ -21,6 +21,8 @@ namespace nomp {
 		}
 		Chunk(std::shared_ptr<std::byte[]> data, size_t sz, const Hash& hash) : m_data(data, sz), r(hash) {
 		}
+		Chunk(const ByteSlice& data, const Hash& hash) : m_data(data), r(hash) {
+		}
 		static Chunk FromString(const std::string& str) {
 			return Chunk(std::span{ (std::byte*)str.data(), str.size() });
 		}
@@ -51,22 +53,27 @@ namespace nomp {
 		ByteSlice data() const { return m_data; }
 		size_t size() const { return m_data.size(); }
 
-		void serialize(interface::IWriter writer);
+		void serialize(interface::IWriter writer) const;
 		static std::optional<Chunk> deserialize(interface::IReader reader);
 	};
 
+	// ChunkWriter hashes bytes as they are written and hands its buffer to the
+	// chunk it returns, so getChunk() neither copies nor re-reads the data.
 	class ChunkWriter {
 		std::vector<std::byte> buffer;
+		Hasher hasher;
 	public:
 		int write(std::span<const std::byte> data) {
+			hasher.update(data);
 			buffer.insert(buffer.end(), data.begin(), data.end());
 			return (int)data.size();
 		}
 		Chunk getChunk() {
-			Chunk c(std::span{ buffer.data(), buffer.size() });
-			buffer.clear();
+			const Hash h = hasher.final();
+			Chunk c(ByteSlice(std::move(buffer)), h);
+			buffer = {};
+			hasher = Hasher();
 			return c;
 		}
 	};
-	
 }
@@ -1,6 +1,7 @@
 #pragma once
 #include "common.h"
 #include "chunk.h"
+#include "stats.h"
 #include <optional>
 #include <vector>
 
@@ -50,15 +51,12 @@ namespace nomp {
 			// If last doesn't match the root in persistent storage, returns false.
 			::add_convention<MemCommit, bool(const Hash& newRoot, const Hash& last)>
 			
-			// Stats may return some kind of struct that reports statistics about the
-			// ChunkStore instance. The type is implementation-dependent, and impls
-			// may return nil
-			//::add_convention<MemStats, std::string()>
+			// Stats returns a snapshot of the operation counts, latencies and I/O of
+			// this ChunkStore instance since it was opened.
+			::add_convention<MemStats, StoreStats()>
 			
-			// StatsSummary may return a string containing summarized statistics for
-			// this ChunkStore. It must return "Unsupported" if this operation is not
-			// supported.
-			//::add_convention<MemStatsSummary, std::string()>
+			// StatsSummary returns the same statistics rendered for humans.
+			::add_convention<MemStatsSummary, std::string()>
 			
 			// Close tears down any resources in use by the implementation. After
 			// Close(), the ChunkStore may not be used again. It is NOT SAFE to call
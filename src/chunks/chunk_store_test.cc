@@ -1,13 +1,14 @@
 #include <gtest/gtest.h>
 #include "chunk_store.h"
 #include "memory_store.h"
+#include "nbs/store.h"
 #include <string>
 
 using nomp::Chunk;
 using nomp::Hash;
 
 // 1. Define the list of types to be tested
-using ChunkStoreFactories = testing::Types<nomp::MemoryStoreFactory>;
+using ChunkStoreFactories = testing::Types<nomp::MemoryStoreFactory, nomp::NbsMemoryStoreFactory>;
 
 // 2. Define the test fixture as a template class
 template <class T>
@@ -124,3 +125,20 @@ TYPED_TEST(ChunkStoreTest, TestCommitUnchangedRoot) {
 
 
 
+
+TYPED_TEST(ChunkStoreTest, TestStats) {
+	auto store = this->factory->createStore("ns");
+	auto c = nomp::Chunk::FromString("abc");
+	store->put(c);
+	EXPECT_TRUE(store->has(c.hash()));
+	EXPECT_TRUE(store->get(c.hash()).has_value());
+	EXPECT_TRUE(store->commit(c.hash(), store->root()));
+
+	auto stats = store->stats();
+	EXPECT_EQ(stats.op(nomp::StoreOp::Put).count, 1u);
+	EXPECT_EQ(stats.op(nomp::StoreOp::Put).bytes, c.size());
+	EXPECT_EQ(stats.op(nomp::StoreOp::Has).count, 1u);
+	EXPECT_EQ(stats.op(nomp::StoreOp::Get).bytes, c.size());
+	EXPECT_EQ(stats.op(nomp::StoreOp::Commit).count, 1u);
+	EXPECT_NE(store->statsSummary().find("commit"), std::string::npos);
+}
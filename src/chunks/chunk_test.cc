@@ -41,6 +41,24 @@ TEST(ChunkTest, TestChunkWriter) {
 	EXPECT_TRUE(std::equal((std::byte*)data3.c_str(), (std::byte*)data3.c_str() + data3.size(), chunk2.data().span().begin()));
 }
 
+TEST(ChunkTest, TestChunkWriterHash) {
+	nomp::ChunkWriter writer;
+	std::vector<std::byte> all;
+	for (int i = 0; i < 100; ++i) {
+		std::vector<std::byte> piece(1000 + i, std::byte(i));
+		writer.write(piece);
+		all.insert(all.end(), piece.begin(), piece.end());
+	}
+	auto chunk = writer.getChunk();
+	EXPECT_EQ(chunk.hash(), nomp::Chunk(std::span{ all }).hash());
+	EXPECT_EQ(chunk.size(), all.size());
+
+	// the writer starts over after getChunk, including an empty chunk
+	auto empty = writer.getChunk();
+	EXPECT_EQ(empty.size(), 0u);
+	EXPECT_EQ(empty.hash(), nomp::Chunk(std::span<std::byte>{}).hash());
+}
+
 
 
 
@@ -0,0 +1,142 @@
+#include "chunk_trie.h"
+#include <bit>
+#include <stdexcept>
+
+namespace nomp {
+	// Returns the slot |h| falls into at |depth|, taken from the hash bits
+	// [depth * BitsPerLevel, (depth + 1) * BitsPerLevel).
+	static unsigned slotIndex(const Hash& h, unsigned depth) {
+		const std::span<const std::byte> bytes(h);
+		const unsigned bit = depth * ChunkTrie::BitsPerLevel;
+		const unsigned byte = bit / 8;
+		uint32_t window = uint32_t(bytes[byte]) << 8;
+		if (byte + 1 < bytes.size()) {
+			window |= uint32_t(bytes[byte + 1]);
+		}
+		return (window >> (16 - ChunkTrie::BitsPerLevel - bit % 8)) & (ChunkTrie::Fanout - 1);
+	}
+
+	const Chunk* ChunkTrie::find(const Hash& h) const {
+		const Node* node = rootNode.get();
+		for (unsigned depth = 0; node != nullptr; ++depth) {
+			const uint32_t bit = 1u << slotIndex(h, depth);
+			if ((node->bitmap & bit) == 0) {
+				return nullptr;
+			}
+			const auto& slot = node->slots[std::popcount(node->bitmap & (bit - 1))];
+			if (const auto* chunk = std::get_if<Chunk>(&slot)) {
+				return chunk->hash() == h ? chunk : nullptr;
+			}
+			node = std::get<NodePtr>(slot).get();
+		}
+		return nullptr;
+	}
+
+	// Builds the subtrie holding two chunks that share a slot at |depth| - 1.
+	ChunkTrie::NodePtr ChunkTrie::split(const Chunk& a, const Chunk& b, unsigned depth) {
+		if (depth >= MaxDepth) {
+			throw std::logic_error("ChunkTrie: distinct chunks with the same hash " + a.hash().toString());
+		}
+		auto node = std::make_shared<Node>();
+		const auto ia = slotIndex(a.hash(), depth);
+		const auto ib = slotIndex(b.hash(), depth);
+		if (ia == ib) {
+			node->bitmap = 1u << ia;
+			node->slots.emplace_back(split(a, b, depth + 1));
+		}
+		else {
+			node->bitmap = (1u << ia) | (1u << ib);
+			node->slots.emplace_back(ia < ib ? a : b);
+			node->slots.emplace_back(ia < ib ? b : a);
+		}
+		return node;
+	}
+
+	// Returns a copy of the path to |chunk| with |chunk| added, or nullptr if the
+	// subtrie at |node| already holds it.
+	ChunkTrie::NodePtr ChunkTrie::insert(const Node* node, const Chunk& chunk, unsigned depth) {
+		const uint32_t bit = 1u << slotIndex(chunk.hash(), depth);
+		const auto pos = std::popcount(node->bitmap & (bit - 1));
+		if ((node->bitmap & bit) == 0) {
+			auto copy = std::make_shared<Node>(*node);
+			copy->bitmap |= bit;
+			copy->slots.emplace(copy->slots.begin() + pos, chunk);
+			return copy;
+		}
+		const auto& slot = node->slots[pos];
+		NodePtr child;
+		if (const auto* existing = std::get_if<Chunk>(&slot)) {
+			if (existing->hash() == chunk.hash()) {
+				return nullptr;
+			}
+			child = split(*existing, chunk, depth + 1);
+		}
+		else {
+			child = insert(std::get<NodePtr>(slot).get(), chunk, depth + 1);
+			if (!child) {
+				return nullptr;
+			}
+		}
+		auto copy = std::make_shared<Node>(*node);
+		copy->slots[pos] = std::move(child);
+		return copy;
+	}
+
+	ChunkTrie ChunkTrie::insert(const Chunk& chunk) const {
+		static const Node emptyNode;
+		auto newRoot = insert(rootNode ? rootNode.get() : &emptyNode, chunk, 0);
+		if (!newRoot) {
+			return *this;
+		}
+		return ChunkTrie(std::move(newRoot), chunkCount + 1);
+	}
+
+	// Returns |node| as a node of this batch, copying it first if it is not one yet.
+	ChunkTrie::Node& ChunkTrie::own(NodePtr& node, FreshNodes& fresh) {
+		if (!fresh.contains(node.get())) {
+			node = std::make_shared<Node>(*node);
+			fresh.insert(node.get());
+		}
+		// every fresh node was made non-const by this batch
+		return const_cast<Node&>(*node);
+	}
+
+	// Adds |chunk| below |node|, a node of this batch, and returns whether it was new.
+	bool ChunkTrie::insertOwned(Node& node, const Chunk& chunk, unsigned depth, FreshNodes& fresh) {
+		const uint32_t bit = 1u << slotIndex(chunk.hash(), depth);
+		const auto pos = std::popcount(node.bitmap & (bit - 1));
+		if ((node.bitmap & bit) == 0) {
+			node.bitmap |= bit;
+			node.slots.emplace(node.slots.begin() + pos, chunk);
+			return true;
+		}
+		auto& slot = node.slots[pos];
+		if (const auto* existing = std::get_if<Chunk>(&slot)) {
+			if (existing->hash() == chunk.hash()) {
+				return false;
+			}
+			auto child = split(*existing, chunk, depth + 1);
+			slot = std::move(child);
+			return true;
+		}
+		return insertOwned(own(std::get<NodePtr>(slot), fresh), chunk, depth + 1, fresh);
+	}
+
+	ChunkTrie ChunkTrie::insert(std::span<const Chunk> chunks) const {
+		FreshNodes fresh;
+		NodePtr newRoot = rootNode;
+		if (!newRoot) {
+			newRoot = std::make_shared<Node>();
+			fresh.insert(newRoot.get());
+		}
+		auto& root = own(newRoot, fresh);
+		size_t added = 0;
+		for (const auto& chunk : chunks) {
+			added += insertOwned(root, chunk, 0, fresh);
+		}
+		if (added == 0) {
+			return *this;
+		}
+		return ChunkTrie(std::move(newRoot), chunkCount + added);
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include "common.h"
+#include "chunk.h"
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <unordered_set>
+#include <variant>
+#include <vector>
+
+namespace nomp {
+	// ChunkTrie is a persistent hash array mapped trie of chunks keyed by their hashes.
+	// A trie is never modified: insert() returns a new trie that shares every node off
+	// the inserted path with the old one. Any number of threads may therefore read a
+	// trie without locking while newer versions of it are being built.
+	class ChunkTrie {
+	public:
+		static constexpr unsigned BitsPerLevel = 5;
+		static constexpr unsigned Fanout = 1u << BitsPerLevel;
+		static constexpr unsigned MaxDepth = (ByteLen * 8 + BitsPerLevel - 1) / BitsPerLevel;
+
+	private:
+		struct Node;
+		using NodePtr = std::shared_ptr<const Node>;
+		using Slot = std::variant<Chunk, NodePtr>;
+		struct Node {
+			uint32_t bitmap = 0; // bit i is set iff slot i is occupied
+			std::vector<Slot> slots; // occupied slots only, in index order
+		};
+
+		NodePtr rootNode;
+		size_t chunkCount = 0;
+
+		ChunkTrie(NodePtr rootNode, size_t chunkCount) : rootNode(std::move(rootNode)), chunkCount(chunkCount) {}
+		// nodes created by the batch insert in progress, which it may still modify
+		using FreshNodes = std::unordered_set<const Node*>;
+
+		static NodePtr insert(const Node* node, const Chunk& chunk, unsigned depth);
+		static NodePtr split(const Chunk& a, const Chunk& b, unsigned depth);
+		static Node& own(NodePtr& node, FreshNodes& fresh);
+		static bool insertOwned(Node& node, const Chunk& chunk, unsigned depth, FreshNodes& fresh);
+
+	public:
+		ChunkTrie() = default;
+
+		size_t size() const { return chunkCount; }
+		bool empty() const { return chunkCount == 0; }
+
+		// Returns the chunk with hash |h|, or nullptr. The pointer stays valid as long
+		// as this trie, or any trie derived from it, is alive.
+		const Chunk* find(const Hash& h) const;
+		bool contains(const Hash& h) const { return find(h) != nullptr; }
+
+		// Returns a trie that also holds |chunk|, or this trie if it already does.
+		ChunkTrie insert(const Chunk& chunk) const;
+		// Returns a trie that also holds every chunk of |chunks|. Each node on the
+		// inserted paths is copied once for the whole batch rather than once per chunk.
+		ChunkTrie insert(std::span<const Chunk> chunks) const;
+	};
+}
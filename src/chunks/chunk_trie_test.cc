@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+
+#include "chunk_trie.h"
+#include "memory_store.h"
+#include "test_util.h"
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace nomp;
+
+TEST(ChunkTrieTest, TestInsertAndFind) {
+	auto chunks = test::makeChunks(5000, 16);
+	ChunkTrie trie;
+	EXPECT_TRUE(trie.empty());
+	for (const auto& c : chunks) {
+		trie = trie.insert(c);
+	}
+	EXPECT_EQ(trie.size(), chunks.size());
+	for (const auto& c : chunks) {
+		const auto* found = trie.find(c.hash());
+		ASSERT_NE(found, nullptr);
+		EXPECT_EQ(*found, c);
+	}
+	EXPECT_FALSE(trie.contains(Chunk::FromString("missing").hash()));
+	// inserting a chunk that is already there changes nothing
+	EXPECT_EQ(trie.insert(chunks[0]).size(), chunks.size());
+}
+
+TEST(ChunkTrieTest, TestBatchInsert) {
+	auto chunks = test::makeChunks(3000, 16);
+	const std::span<const Chunk> all{ chunks };
+	const auto v1 = ChunkTrie().insert(all.first(1000));
+	// the second batch overlaps the first, and repeats a chunk within itself
+	auto batch = std::vector<Chunk>(chunks.begin() + 500, chunks.end());
+	batch.push_back(chunks[2000]);
+	const auto v2 = v1.insert(batch);
+	EXPECT_EQ(v1.size(), 1000u);
+	EXPECT_EQ(v2.size(), chunks.size());
+	for (size_t i = 0; i < chunks.size(); ++i) {
+		EXPECT_EQ(v1.contains(chunks[i].hash()), i < 1000) << i;
+		ASSERT_NE(v2.find(chunks[i].hash()), nullptr) << i;
+		EXPECT_EQ(*v2.find(chunks[i].hash()), chunks[i]);
+	}
+	EXPECT_EQ(v2.insert(all.first(10)).size(), chunks.size());
+}
+
+TEST(ChunkTrieTest, TestOldVersionsAreUnchanged) {
+	auto chunks = test::makeChunks(100, 16);
+	ChunkTrie v1;
+	for (size_t i = 0; i < 50; ++i) {
+		v1 = v1.insert(chunks[i]);
+	}
+	auto v2 = v1;
+	for (size_t i = 50; i < chunks.size(); ++i) {
+		v2 = v2.insert(chunks[i]);
+	}
+	EXPECT_EQ(v1.size(), 50);
+	EXPECT_EQ(v2.size(), 100);
+	for (size_t i = 0; i < chunks.size(); ++i) {
+		EXPECT_EQ(v1.contains(chunks[i].hash()), i < 50);
+		EXPECT_TRUE(v2.contains(chunks[i].hash()));
+	}
+}
+
+TEST(ChunkTrieTest, TestSharedPrefixes) {
+	// hashes that only differ in their last bits force the trie to its full depth
+	std::vector<Chunk> chunks;
+	for (char last = 0; last < 4; ++last) {
+		std::string bytes(ByteLen, 'x');
+		bytes.back() = last;
+		chunks.emplace_back(Chunk::FromString("data").data(), Hash(std::span<const char>(bytes)));
+	}
+	ChunkTrie trie;
+	for (const auto& c : chunks) {
+		trie = trie.insert(c);
+	}
+	EXPECT_EQ(trie.size(), chunks.size());
+	for (const auto& c : chunks) {
+		ASSERT_NE(trie.find(c.hash()), nullptr);
+		EXPECT_EQ(trie.find(c.hash())->hash(), c.hash());
+	}
+}
+
+TEST(MemoryStoreTest, TestReadersDuringUpdates) {
+	MemoryStore storage;
+	auto chunks = test::makeChunks(2000, 16);
+	std::atomic<bool> done = false;
+	std::vector<std::thread> readers;
+	for (int r = 0; r < 4; ++r) {
+		readers.emplace_back([&] {
+			while (!done) {
+				// a snapshot never changes under its reader, and commits are all or nothing
+				auto snap = storage.snapshot();
+				size_t present = 0;
+				for (const auto& c : chunks) {
+					present += snap->chunks.contains(c.hash());
+				}
+				EXPECT_EQ(present % 100, 0);
+				EXPECT_EQ(present, snap->chunks.size());
+			}
+		});
+	}
+	auto view = storage.newView();
+	for (size_t i = 0; i < chunks.size(); i += 100) {
+		for (size_t j = i; j < i + 100; ++j) {
+			view->put(chunks[j]);
+		}
+		EXPECT_TRUE(view->commit(chunks[i].hash(), view->root()));
+	}
+	done = true;
+	for (auto& t : readers) {
+		t.join();
+	}
+	EXPECT_EQ(storage.root(), chunks[chunks.size() - 100].hash());
+	EXPECT_EQ(storage.snapshot()->chunks.size(), chunks.size());
+}
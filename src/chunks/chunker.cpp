@@ -0,0 +1,110 @@
+#include "chunker.h"
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+namespace nomp {
+	namespace {
+		// The Gear table: one fixed pseudo-random value per byte, from splitmix64, so
+		// every build cuts the same input in the same places.
+		constexpr std::array<uint64_t, 256> makeGearTable() {
+			std::array<uint64_t, 256> table{};
+			uint64_t state = 0x6E6F6D70;
+			for (auto& v : table) {
+				state += 0x9E3779B97F4A7C15;
+				uint64_t z = state;
+				z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+				z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+				v = z ^ (z >> 31);
+			}
+			return table;
+		}
+		constexpr auto GearTable = makeGearTable();
+
+		// The top |bits| bits, which carry the most recent bytes' influence.
+		constexpr uint64_t topBits(unsigned bits) {
+			return bits == 0 ? 0 : ~uint64_t(0) << (64 - bits);
+		}
+
+		// Scans data[i, end) for a boundary under |mask|, returning its end or |end|.
+		inline size_t scan(std::span<const std::byte> data, size_t i, size_t end, uint64_t& h, uint64_t mask) {
+			const auto* p = data.data();
+			// two bytes per round keeps the loop-carried dependency to the hash alone
+			for (; i + 1 < end; i += 2) {
+				h = (h << 1) + GearTable[uint8_t(p[i])];
+				if ((h & mask) == 0) {
+					return i + 1;
+				}
+				h = (h << 1) + GearTable[uint8_t(p[i + 1])];
+				if ((h & mask) == 0) {
+					return i + 2;
+				}
+			}
+			for (; i < end; ++i) {
+				h = (h << 1) + GearTable[uint8_t(p[i])];
+				if ((h & mask) == 0) {
+					return i + 1;
+				}
+			}
+			return end;
+		}
+	}
+
+	Chunker::Chunker(const ChunkerOptions& options) : options(options) {
+		if (options.minSize == 0 || options.minSize > options.targetSize || options.targetSize > options.maxSize) {
+			throw std::invalid_argument("Chunker sizes must satisfy 0 < minSize <= targetSize <= maxSize");
+		}
+		const unsigned bits = unsigned(std::bit_width(options.targetSize)) - 1;
+		strictMask = topBits(std::min(bits + 2, 63u));
+		looseMask = topBits(bits > 2 ? bits - 2 : 0);
+	}
+
+	size_t Chunker::cut(std::span<const std::byte> data) const {
+		const size_t n = std::min(data.size(), options.maxSize);
+		if (n <= options.minSize) {
+			return n;
+		}
+		uint64_t h = 0;
+		const size_t normal = std::min(options.targetSize, n);
+		const size_t i = scan(data, options.minSize, normal, h, strictMask);
+		if (i < normal) {
+			return i;
+		}
+		return scan(data, normal, n, h, looseMask);
+	}
+
+	ChunkedStream chunkStream(interface::IReader reader, interface::IChunkStore& store, const ChunkerOptions& options) {
+		const Chunker chunker(options);
+		ChunkedStream result;
+		std::vector<std::byte> buf(2 * options.maxSize);
+		size_t begin = 0, end = 0;
+		bool eof = false;
+		while (true) {
+			// keep at least maxSize bytes ahead of the cut, unless the input runs out
+			if (!eof && end - begin < options.maxSize) {
+				std::copy(buf.begin() + begin, buf.begin() + end, buf.begin());
+				end -= begin;
+				begin = 0;
+				while (!eof && end < buf.size()) {
+					const int n = reader->read(std::span{ buf }.subspan(end));
+					if (n < 0) {
+						throw std::runtime_error("Chunker failed to read its input");
+					}
+					eof = n == 0;
+					end += size_t(n);
+				}
+			}
+			if (begin == end) {
+				return result;
+			}
+			const auto data = std::span<const std::byte>{ buf }.subspan(begin, end - begin);
+			const size_t len = chunker.cut(data);
+			const ByteSlice slice(data.first(len));
+			Chunk chunk(slice, Hash::Of(slice));
+			store->put(chunk);
+			result.chunks.push_back(chunk.hash());
+			result.size += len;
+			begin += len;
+		}
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "common.h"
+#include "chunk_store.h"
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace nomp {
+	struct ChunkerOptions {
+		size_t minSize = 2 << 10; // no boundary is looked for before this many bytes
+		size_t targetSize = 8 << 10; // rounded down to a power of two
+		size_t maxSize = 64 << 10; // a chunk is cut here if no boundary turned up
+	};
+
+	// Chunker finds content-defined chunk boundaries with FastCDC: a Gear rolling
+	// hash, where every byte shifts the hash left and adds a random value picked by
+	// the byte, so the top bits depend only on the last few dozen bytes. A boundary
+	// is where the masked top bits are all zero. Boundaries move with the content
+	// rather than with offsets, so an edit only changes the chunks around it.
+	// Normalized chunking uses a stricter mask before targetSize and a looser one
+	// after, which keeps sizes close to the target.
+	class Chunker {
+		ChunkerOptions options;
+		uint64_t strictMask;
+		uint64_t looseMask;
+	public:
+		explicit Chunker(const ChunkerOptions& options = {});
+
+		// Returns the length of the first chunk of |data|. |data| must hold at least
+		// maxSize bytes unless it is the end of the input, whose last chunk may end
+		// anywhere.
+		size_t cut(std::span<const std::byte> data) const;
+		const ChunkerOptions& chunkerOptions() const { return options; }
+	};
+
+	struct ChunkedStream {
+		std::vector<Hash> chunks; // in stream order
+		uint64_t size = 0;
+	};
+
+	// Reads |reader| to its end and puts it into |store| as content-defined chunks,
+	// holding at most 2 * maxSize bytes of it at a time.
+	ChunkedStream chunkStream(interface::IReader reader, interface::IChunkStore& store, const ChunkerOptions& options = {});
+}
@@ -0,0 +1,25 @@
+#include <benchmark/benchmark.h>
+#include "chunker.h"
+#include <random>
+#include <vector>
+
+using namespace nomp;
+
+// Args: target chunk size
+static void BM_ChunkerCut(benchmark::State& state) {
+	std::mt19937_64 rng(1);
+	std::vector<std::byte> data(16 << 20);
+	for (auto& b : data) {
+		b = std::byte(rng());
+	}
+	const auto target = size_t(state.range(0));
+	const Chunker chunker(ChunkerOptions{ target / 4, target, target * 8 });
+	for (auto _ : state) {
+		std::span<const std::byte> rest{ data };
+		while (!rest.empty()) {
+			rest = rest.subspan(chunker.cut(rest));
+		}
+	}
+	state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(data.size()));
+}
+BENCHMARK(BM_ChunkerCut)->Arg(4 << 10)->Arg(64 << 10);
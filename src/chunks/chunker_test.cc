@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+#include "chunker.h"
+#include "memory_store.h"
+#include "io/buffer.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace nomp;
+
+namespace {
+	std::vector<std::byte> randomBytes(size_t n, uint64_t seed) {
+		std::mt19937_64 rng(seed);
+		std::vector<std::byte> data(n);
+		for (auto& b : data) {
+			b = std::byte(rng());
+		}
+		return data;
+	}
+
+	// ShortReader hands out at most |step| bytes per read, like a pipe would.
+	class ShortReader {
+		SpanReader reader;
+		size_t step;
+	public:
+		ShortReader(std::span<const std::byte> data, size_t step) : reader(data), step(step) {}
+		int read(std::span<std::byte> buf) {
+			return reader.read(buf.first(std::min(buf.size(), step)));
+		}
+	};
+
+	ChunkedStream chunkBytes(std::span<const std::byte> data, interface::IChunkStore& store, const ChunkerOptions& options = {}) {
+		ShortReader reader(data, 3000);
+		return chunkStream(interface::IReader(&reader), store, options);
+	}
+}
+
+TEST(ChunkerTest, TestChunkStreamRoundTrip) {
+	MemoryStoreFactory factory;
+	auto store = factory.createStore("chunker");
+	const auto data = randomBytes(1 << 20, 1);
+	const ChunkerOptions options;
+
+	const auto result = chunkBytes(data, store, options);
+	EXPECT_EQ(result.size, data.size());
+	std::vector<std::byte> joined;
+	for (size_t i = 0; i < result.chunks.size(); ++i) {
+		const auto chunk = store->get(result.chunks[i]);
+		ASSERT_TRUE(chunk.has_value());
+		const auto span = chunk->data().span();
+		if (i + 1 < result.chunks.size()) {
+			EXPECT_GE(span.size(), options.minSize);
+		}
+		EXPECT_LE(span.size(), options.maxSize);
+		joined.insert(joined.end(), span.begin(), span.end());
+	}
+	EXPECT_EQ(joined, data);
+	// normalized chunking keeps the mean near the target
+	const auto mean = data.size() / result.chunks.size();
+	EXPECT_GT(mean, options.targetSize / 2);
+	EXPECT_LT(mean, options.targetSize * 2);
+
+	// the same input is always cut the same way
+	EXPECT_EQ(chunkBytes(data, store, options).chunks, result.chunks);
+	EXPECT_TRUE(chunkBytes({}, store, options).chunks.empty());
+}
+
+TEST(ChunkerTest, TestChunkStreamDedupsAcrossEdits) {
+	MemoryStoreFactory factory;
+	auto store = factory.createStore("chunker");
+	const auto data = randomBytes(1 << 20, 2);
+	auto edited = data;
+	const auto inserted = randomBytes(10, 3);
+	edited.insert(edited.begin() + 300000, inserted.begin(), inserted.end());
+
+	const auto before = chunkBytes(data, store);
+	const auto after = chunkBytes(edited, store);
+	HashSet known(before.chunks.begin(), before.chunks.end());
+	const auto shared = std::count_if(after.chunks.begin(), after.chunks.end(), [&](const Hash& h) { return known.contains(h); });
+	// only the chunks around the insertion change
+	EXPECT_GE(size_t(shared) + 3, after.chunks.size());
+}
+
+TEST(ChunkerTest, TestChunkerOptions) {
+	EXPECT_THROW(Chunker(ChunkerOptions{ 0, 8, 16 }), std::invalid_argument);
+	EXPECT_THROW(Chunker(ChunkerOptions{ 16, 8, 32 }), std::invalid_argument);
+	EXPECT_THROW(Chunker(ChunkerOptions{ 4, 64, 32 }), std::invalid_argument);
+
+	// without a boundary, chunks are cut at maxSize
+	const Chunker chunker(ChunkerOptions{ 64, 1 << 20, 1 << 20 });
+	std::vector<std::byte> zeros((1 << 20) + 5);
+	EXPECT_EQ(chunker.cut(zeros), size_t(1 << 20));
+	EXPECT_EQ(chunker.cut(std::span{ zeros }.first(10)), 10u);
+}
@@ -0,0 +1,128 @@
+#include "diff.h"
+#include "parallel.h"
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace nomp {
+	GraphDiff::GraphDiff(interface::IChunkStore& store, const Hash& from, const Hash& to, interface::IRefDecoder& decoder,
+		const GraphDiffOptions& options) : store(store), decoder(decoder), options(options)
+	{
+		if (options.batchSize == 0 || options.threads == 0) {
+			throw std::invalid_argument("Diff batch size and threads must be at least 1");
+		}
+		if (!from.isEmpty()) {
+			fromLevel.push_back(from);
+		}
+		if (!to.isEmpty()) {
+			toLevel.push_back(to);
+		}
+	}
+
+	std::optional<ChunkDiff> GraphDiff::next() {
+		while (ready.empty() && (!fromLevel.empty() || !toLevel.empty())) {
+			advance();
+		}
+		if (ready.empty()) {
+			return std::nullopt;
+		}
+		auto d = std::move(ready.front());
+		ready.pop_front();
+		return d;
+	}
+
+	void GraphDiff::advance() {
+		// Drop what the other side has reached at this level. Having reached it at
+		// another level means the graphs are not layered, see the class comment.
+		for (const auto& h : fromLevel) {
+			fromSeen.emplace(h, depth);
+		}
+		for (const auto& h : toLevel) {
+			toSeen.emplace(h, depth);
+		}
+		auto shared = [this](const Hash& h, const Depths& other) {
+			auto it = other.find(h);
+			if (it == other.end()) {
+				return false;
+			}
+			if (it->second != depth) {
+				throw std::runtime_error("Diff found chunk " + h.toString() + " at depth " + std::to_string(it->second) +
+					" on one side and " + std::to_string(depth) + " on the other");
+			}
+			return true;
+		};
+		std::vector<std::pair<Hash, DiffSide>> wanted;
+		for (auto& h : fromLevel) {
+			if (shared(h, toSeen)) {
+				++totals.chunksPruned;
+			}
+			else {
+				wanted.emplace_back(std::move(h), DiffSide::From);
+			}
+		}
+		for (auto& h : toLevel) {
+			if (shared(h, fromSeen)) {
+				++totals.chunksPruned;
+			}
+			else {
+				wanted.emplace_back(std::move(h), DiffSide::To);
+			}
+		}
+		fromLevel.clear();
+		toLevel.clear();
+
+		const size_t batches = (wanted.size() + options.batchSize - 1) / options.batchSize;
+		std::vector<std::vector<ChunkDiff>> found(batches);
+		std::vector<std::vector<Hash>> fromRefs(batches), toRefs(batches);
+		parallelFor(batches, options.threads, [&](size_t b) {
+			const auto begin = wanted.begin() + b * options.batchSize;
+			const auto end = wanted.begin() + std::min(wanted.size(), (b + 1) * options.batchSize);
+			HashSet hashes;
+			for (auto it = begin; it != end; ++it) {
+				hashes.insert(it->first);
+			}
+			auto chunks = store->getMany(hashes);
+			if (chunks.size() != hashes.size()) {
+				for (const auto& c : chunks) {
+					hashes.erase(c.hash());
+				}
+				throw std::runtime_error("Diff found a ref to missing chunk " + hashes.begin()->toString());
+			}
+			std::unordered_map<Hash, Chunk, Hash::Hasher> byHash;
+			for (auto& c : chunks) {
+				byHash.emplace(c.hash(), std::move(c));
+			}
+			// report in level order rather than the order getMany() found them in
+			for (auto it = begin; it != end; ++it) {
+				auto& chunk = byHash.at(it->first);
+				decoder->refs(chunk, it->second == DiffSide::From ? fromRefs[b] : toRefs[b]);
+				found[b].push_back(ChunkDiff{ it->second, chunk, depth });
+			}
+		});
+
+		for (size_t b = 0; b < batches; ++b) {
+			totals.chunksFetched += found[b].size();
+			for (auto& d : found[b]) {
+				ready.push_back(std::move(d));
+			}
+			for (auto& h : fromRefs[b]) {
+				if (!h.isEmpty() && !fromSeen.contains(h)) {
+					fromLevel.push_back(std::move(h));
+				}
+			}
+			for (auto& h : toRefs[b]) {
+				if (!h.isEmpty() && !toSeen.contains(h)) {
+					toLevel.push_back(std::move(h));
+				}
+			}
+		}
+		// a chunk two parents at this level share is only listed once
+		auto dedup = [](std::vector<Hash>& level) {
+			HashSet unique;
+			std::erase_if(level, [&](const Hash& h) { return !unique.insert(h).second; });
+		};
+		dedup(fromLevel);
+		dedup(toLevel);
+		++depth;
+	}
+}
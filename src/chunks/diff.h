@@ -0,0 +1,75 @@
+#pragma once
+#include "common.h"
+#include "chunk_store.h"
+#include "refs.h"
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace nomp {
+	enum class DiffSide {
+		From, // only the |from| graph reaches the chunk
+		To, // only the |to| graph reaches the chunk
+	};
+
+	struct ChunkDiff {
+		DiffSide side;
+		Chunk chunk;
+		uint32_t depth; // refs followed from the root
+	};
+
+	struct GraphDiffOptions {
+		size_t batchSize = 256; // addresses per getMany()
+		size_t threads = 4; // concurrent getMany() calls
+	};
+
+	struct GraphDiffStats {
+		uint64_t chunksFetched = 0;
+		uint64_t chunksPruned = 0; // addresses not followed as the other side reached them, per side
+	};
+
+	// GraphDiff finds the chunks one of two graphs reaches and the other does not.
+	// It walks both from their roots a level at a time: an address both sides reach
+	// is dropped with everything below it without being read, and the rest of the
+	// level is fetched in batches, reported and expanded. The work is proportional to
+	// what changed, not to the size of the graphs. Entries come out a level at a time
+	// as next() asks for them, so stopping early saves the deeper levels.
+	//
+	// Comparing level by level is only sound when every chunk sits at the same depth
+	// below both roots, as in prolly trees: otherwise a chunk reported as one side's
+	// at one depth may turn out to be under the other side's chunks further down, and
+	// its whole subgraph has been walked and reported with it. next() throws as soon
+	// as it meets a chunk the two sides reach at different depths; entries returned
+	// before that are not to be trusted. A chunk one side reaches only below a shared
+	// subtree is not known to that side either, so if the other side reaches it
+	// elsewhere it is reported as the other side's.
+	class GraphDiff {
+		using Depths = std::unordered_map<Hash, uint32_t, Hash::Hasher>;
+
+		interface::IChunkStore& store;
+		interface::IRefDecoder& decoder;
+		GraphDiffOptions options;
+		std::vector<Hash> fromLevel; // the next level to compare
+		std::vector<Hash> toLevel;
+		Depths fromSeen; // the depth each side first reached a chunk at
+		Depths toSeen;
+		uint32_t depth = 0;
+		std::deque<ChunkDiff> ready;
+		GraphDiffStats totals;
+
+		// Compares, fetches and expands the next level into |ready|.
+		void advance();
+
+	public:
+		GraphDiff(interface::IChunkStore& store, const Hash& from, const Hash& to, interface::IRefDecoder& decoder,
+			const GraphDiffOptions& options = {});
+
+		// Returns the next chunk only one side reaches, in order of depth, or nothing
+		// once the graphs are exhausted. Throws if a ref leads to a missing chunk, or
+		// if a chunk sits at different depths on the two sides.
+		std::optional<ChunkDiff> next();
+		const GraphDiffStats& stats() const { return totals; }
+	};
+}
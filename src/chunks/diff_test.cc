@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+#include "diff.h"
+#include "memory_store.h"
+#include <string>
+#include <vector>
+
+using namespace nomp;
+
+namespace {
+	Hash putNode(interface::IChunkStore& store, std::span<const Hash> children, const std::string& payload) {
+		auto chunk = RefListDecoder::encode(children, std::span{ (const std::byte*)payload.data(), payload.size() });
+		store->put(chunk);
+		return chunk.hash();
+	}
+
+	// A two-level tree with |width| subtrees of 10 leaves; |changed| picks the
+	// subtree whose first leaf differs.
+	Hash putTree(interface::IChunkStore& store, int width, int changed, std::vector<Hash>& subtrees) {
+		subtrees.clear();
+		for (int i = 0; i < width; ++i) {
+			std::vector<Hash> leaves;
+			for (int j = 0; j < 10; ++j) {
+				const auto salt = i == changed && j == 0 ? "*" : "";
+				leaves.push_back(putNode(store, {}, "leaf" + std::to_string(i) + "." + std::to_string(j) + salt));
+			}
+			subtrees.push_back(putNode(store, leaves, "node" + std::to_string(i)));
+		}
+		return putNode(store, subtrees, "root");
+	}
+}
+
+TEST(GraphDiffTest, TestDiffPrunesSharedSubtrees) {
+	MemoryStoreFactory factory;
+	auto store = factory.createStore("diff");
+	interface::IRefDecoder decoder = pro::make_proxy<interface::RefDecoder, RefListDecoder>();
+	std::vector<Hash> fromNodes, toNodes;
+	const auto from = putTree(store, 50, -1, fromNodes);
+	const auto to = putTree(store, 50, 7, toNodes);
+
+	GraphDiff diff(store, from, to, decoder, GraphDiffOptions{ 8, 3 });
+	std::vector<ChunkDiff> entries;
+	while (auto d = diff.next()) {
+		entries.push_back(std::move(*d));
+	}
+	// each side's root, the changed subtree and its changed leaf
+	ASSERT_EQ(entries.size(), 6u);
+	for (const auto& d : entries) {
+		const auto& nodes = d.side == DiffSide::From ? fromNodes : toNodes;
+		if (d.depth == 0) {
+			EXPECT_EQ(d.chunk.hash(), d.side == DiffSide::From ? from : to);
+		}
+		if (d.depth == 1) {
+			EXPECT_EQ(d.chunk.hash(), nodes[7]);
+		}
+	}
+	EXPECT_EQ(entries.back().depth, 2u);
+	// the 49 shared subtrees and 9 shared leaves were never read
+	EXPECT_EQ(diff.stats().chunksFetched, 6u);
+	EXPECT_EQ(diff.stats().chunksPruned, 2 * (49u + 9u));
+
+	// a graph against nothing is all one side, and against itself is nothing
+	size_t count = 0;
+	GraphDiff all(store, Hash(), to, decoder);
+	while (auto d = all.next()) {
+		EXPECT_EQ(d->side, DiffSide::To);
+		++count;
+	}
+	EXPECT_EQ(count, 1u + 50u + 500u);
+	EXPECT_FALSE(GraphDiff(store, to, to, decoder).next().has_value());
+
+	// entries are produced lazily
+	GraphDiff lazy(store, from, to, decoder);
+	EXPECT_TRUE(lazy.next().has_value());
+	EXPECT_EQ(lazy.stats().chunksFetched, 2u);
+}
+
+TEST(GraphDiffTest, TestDiffRejectsChunkAtDifferentDepths) {
+	MemoryStoreFactory factory;
+	auto store = factory.createStore("diff");
+	interface::IRefDecoder decoder = pro::make_proxy<interface::RefDecoder, RefListDecoder>();
+	// c1 is the root of one side and a child of the other's root, so it is not
+	// one side's alone
+	std::vector<Hash> leaves{ putNode(store, {}, "a"), putNode(store, {}, "b") };
+	const auto c1 = putNode(store, leaves, "c1");
+	std::vector<Hash> children{ c1, putNode(store, {}, "c") };
+	const auto c2 = putNode(store, children, "c2");
+
+	for (const auto& [from, to] : { std::pair{ c1, c2 }, std::pair{ c2, c1 } }) {
+		GraphDiff diff(store, from, to, decoder);
+		EXPECT_THROW(while (diff.next()) {}, std::runtime_error);
+	}
+}
+
+TEST(GraphDiffTest, TestDiffFailsOnMissingChunk) {
+	MemoryStoreFactory factory;
+	auto store = factory.createStore("diff");
+	interface::IRefDecoder decoder = pro::make_proxy<interface::RefDecoder, RefListDecoder>();
+	std::vector<Hash> children{ Chunk::FromString("never put").hash() };
+	GraphDiff diff(store, Hash(), putNode(store, children, "root"), decoder);
+	EXPECT_TRUE(diff.next().has_value());
+	EXPECT_THROW(diff.next(), std::runtime_error);
+}
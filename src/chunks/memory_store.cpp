@@ -1,8 +1,69 @@
 #include "memory_store.h"
+#include <functional>
+#include <thread>
 
 namespace nomp {
+	MemoryStore::MemoryStore() :
+		readers(std::make_unique<ReaderSlot[]>(ReaderSlotCount)),
+		current(new Snapshot())
+	{
+	}
+
+	MemoryStore::~MemoryStore() {
+		delete current.load(std::memory_order_relaxed);
+	}
+
 	interface::IChunkStore MemoryStore::newView() {
 		return pro::make_proxy<interface::ChunkStore, MemoryStoreView>(*this);
 	}
 
-}
\ No newline at end of file
+	size_t MemoryStore::readerSlot() {
+		thread_local const size_t slot = std::hash<std::thread::id>{}(std::this_thread::get_id()) % ReaderSlotCount;
+		return slot;
+	}
+
+	// The counter is raised before the epoch is read again and the snapshot is loaded,
+	// all sequentially consistent, so a reader either shows up in the counters
+	// synchronize() waits on or loads the snapshot published before the flip.
+	MemoryStore::ReadGuard::ReadGuard(const MemoryStore& store) {
+		auto& slot = store.readers[readerSlot()];
+		while (true) {
+			const auto e = store.epoch.load() & 1;
+			active = &slot.active[e];
+			active->fetch_add(1);
+			if ((store.epoch.load() & 1) == e) {
+				break;
+			}
+			// an update flipped the epoch under us, join the new one
+			active->fetch_sub(1);
+		}
+		snap = store.current.load();
+	}
+
+	void MemoryStore::synchronize() {
+		const auto old = epoch.fetch_add(1) & 1;
+		for (size_t i = 0; i < ReaderSlotCount; ++i) {
+			while (readers[i].active[old].load() != 0) {
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	bool MemoryStore::update(const Hash& last, const Hash& newRoot, const std::unordered_map<Hash, Chunk, Hash::Hasher>& newChunks) {
+		std::lock_guard lock(writeMtx);
+		// only update() replaces the snapshot, so it can read it without a guard
+		const auto* snap = current.load();
+		if (last != snap->root) {
+			return false;
+		}
+		std::vector<Chunk> chunks;
+		chunks.reserve(newChunks.size());
+		for (const auto& [hash, chunk] : newChunks) {
+			chunks.push_back(chunk);
+		}
+		current.store(new Snapshot{ newRoot, snap->chunks.insert(chunks) });
+		synchronize();
+		delete snap;
+		return true;
+	}
+}
@@ -1,8 +1,13 @@
+#pragma once
 #include "chunk_store.h"
+#include "chunk_trie.h"
 #include <unordered_map>
 #include "hash/all.h"
+#include <atomic>
+#include <memory>
 #include <mutex>
 #include <optional>
+#include <shared_mutex>
 
 namespace nomp {
 	class MemoryStoreView;
@@ -11,52 +16,92 @@ namespace nomp {
 	// root and set of chunks that are visible to all MemoryStoreViews vended by
 	// NewView(), allowing them to implement the transaction-style semantics that
 	// ChunkStore requires.
+	//
+	// The contents are published as immutable snapshots: update() builds the next one
+	// off to the side and swaps it in atomically. Readers never lock or touch a shared
+	// refcount. They pin the snapshot they read with an epoch counter that is striped
+	// over cache lines by thread. update() flips the epoch and waits for the readers
+	// of the old one to leave before it frees the snapshot they may hold.
 	class MemoryStore {
-		std::unordered_map<Hash, Chunk, Hash::Hasher> store;
-		Hash rootHash;
-		mutable std::mutex mtx;
+	public:
+		struct Snapshot {
+			Hash root;
+			ChunkTrie chunks;
+		};
+
+	private:
+		static constexpr size_t ReaderSlotCount = 64;
+
+		struct alignas(64) ReaderSlot {
+			std::atomic<uint64_t> active[2]{}; // readers inside each epoch
+		};
+
+		std::unique_ptr<ReaderSlot[]> readers;
+		std::atomic<unsigned> epoch = 0; // parity selects the counters new readers use
+		std::atomic<const Snapshot*> current;
+		std::mutex writeMtx; // serializes update(), readers never take it
+
+		static size_t readerSlot();
+		// Waits until no reader can still hold a snapshot replaced before the call.
+		void synchronize();
 
 	public:
+		// ReadGuard pins the snapshot that was current when it was taken, which stays
+		// valid until the guard is destroyed. Guards are meant to be short lived: an
+		// update() waits for the guards taken before it. Taking one while holding
+		// another on the same thread is fine, calling update() while holding one is not.
+		class ReadGuard {
+			std::atomic<uint64_t>* active;
+			const Snapshot* snap;
+		public:
+			explicit ReadGuard(const MemoryStore& store);
+			ReadGuard(const ReadGuard&) = delete;
+			ReadGuard& operator=(const ReadGuard&) = delete;
+			~ReadGuard() {
+				active->fetch_sub(1, std::memory_order_release);
+			}
+			const Snapshot* operator->() const { return snap; }
+			const Snapshot& operator*() const { return *snap; }
+		};
+
+		MemoryStore();
+		~MemoryStore();
+		MemoryStore(const MemoryStore&) = delete;
+		MemoryStore& operator=(const MemoryStore&) = delete;
+
 		interface::IChunkStore newView();
 
+		// Returns the current contents. Reading several hashes from one snapshot is
+		// cheaper than calling get() for each and gives a consistent view.
+		ReadGuard snapshot() const {
+			return ReadGuard(*this);
+		}
+
 		// Get retrieves the Chunk with the Hash h, returning EmptyChunk if it's not
 		// present.
-		std::optional<Chunk> get(const Hash &h) {
-			std::lock_guard lock(mtx);
-			auto it = store.find(h);
-			if (it != store.end()) {
-				return it->second;
+		std::optional<Chunk> get(const Hash &h) const {
+			auto snap = snapshot();
+			if (const auto* chunk = snap->chunks.find(h)) {
+				return *chunk;
 			}
 			return std::nullopt;
 		}
 
 		// Has returns true if the Chunk with the Hash h is present in ms.data, false
 		// if not.
-		bool has(const Hash& hash) {
-			std::lock_guard lock(mtx);
-			return store.contains(hash);
+		bool has(const Hash& hash) const {
+			return snapshot()->chunks.contains(hash);
 		}
 
 		// Root returns the currently "persisted" root hash of this in-memory store.
-		Hash root() {
-			std::lock_guard lock(mtx);
-			return rootHash;
+		Hash root() const {
+			return snapshot()->root;
 		}
 
 		// Update checks the "persisted" root against last and, iff it matches,
 		// updates the root to newRoot, adds all of newChunks to ms.data, and returns
 		// true. Otherwise returns false.
-		bool update(const Hash& last, const Hash& newRoot, const std::unordered_map<Hash, Chunk, Hash::Hasher>& newChunks) {
-			std::lock_guard lock(mtx);
-			if (last != rootHash) {
-				return false;
-			}
-			for (const auto& [hash, chunk] : newChunks) {
-				store[chunk.hash()] = chunk;
-			}
-			rootHash = newRoot;
-			return true;
-		}
+		bool update(const Hash& last, const Hash& newRoot, const std::unordered_map<Hash, Chunk, Hash::Hasher>& newChunks);
 	};
 
 	 //MemoryStoreView is an in-memory implementation of store.ChunkStore. Useful
@@ -68,45 +113,61 @@ namespace nomp {
 		MemoryStore& storage;
 		Hash currentRoot;
 		std::unordered_map<Hash, Chunk, Hash::Hasher> pending; // chunks to be committed
-		mutable std::mutex mtx;
+		mutable std::shared_mutex mtx; // guards currentRoot and pending
+		StatsRecorder recorder;
 
 	public:
 		explicit MemoryStoreView(MemoryStore& storage) : storage(storage), currentRoot(storage.root()), pending() {}
 		
 		~MemoryStoreView() = default;
 		bool has(const Hash& hash) {
-			std::lock_guard lock(mtx);
+			auto timer = recorder.time(StoreOp::Has);
+			std::shared_lock lock(mtx);
 			return pending.contains(hash) || storage.has(hash);
 		}
 		std::unique_ptr<HashSet> absent(const HashSet& hashes) {
-			std::lock_guard lock(mtx);
 			auto absent = std::make_unique<HashSet>();
+			std::shared_lock lock(mtx);
+			auto snap = storage.snapshot();
 			for (const auto& h : hashes) {
-				if (!has(h)) {
+				if (!pending.contains(h) && !snap->chunks.contains(h)) {
 					absent->insert(h);
 				}
 			}
 			return absent;
 		}
 		std::optional<Chunk> get(const Hash& hash) {
-			std::lock_guard lock(mtx);
+			auto timer = recorder.time(StoreOp::Get);
+			std::shared_lock lock(mtx);
 			auto it = pending.find(hash);
-			if (it != pending.end()) {
-				return it->second;
+			auto chunk = it != pending.end() ? std::optional<Chunk>(it->second) : storage.get(hash);
+			if (chunk.has_value()) {
+				timer.bytes = chunk->size();
 			}
-			return storage.get(hash);
+			return chunk;
 		}
 		std::vector<Chunk> getMany(const HashSet& hashes) {
+			auto timer = recorder.time(StoreOp::GetMany);
 			std::vector<Chunk> chunks;
+			std::shared_lock lock(mtx);
+			auto snap = storage.snapshot();
 			for (const auto& h : hashes) {
-				auto chunk = get(h);
-				if (chunk.has_value()) {
-					chunks.push_back(chunk.value());
+				auto it = pending.find(h);
+				if (it != pending.end()) {
+					chunks.push_back(it->second);
 				}
+				else if (const auto* chunk = snap->chunks.find(h)) {
+					chunks.push_back(*chunk);
+				}
+			}
+			for (const auto& c : chunks) {
+				timer.bytes += c.size();
 			}
 			return chunks;
 		}
 		void put(const Chunk& chunk) {
+			auto timer = recorder.time(StoreOp::Put);
+			timer.bytes = chunk.size();
 			std::lock_guard lock(mtx);
 			pending[chunk.hash()] = chunk;
 		}
@@ -118,10 +179,11 @@ namespace nomp {
 			currentRoot = storage.root();
 		}
 		Hash root() {
-			std::lock_guard lock(mtx);
+			std::shared_lock lock(mtx);
 			return currentRoot;
 		}
 		bool commit(const Hash& newRoot, const Hash& last) {
+			auto timer = recorder.time(StoreOp::Commit);
 			std::lock_guard lock(mtx);
 			if (last != currentRoot) {
 				return false;
@@ -133,6 +195,12 @@ namespace nomp {
 			currentRoot = newRoot;
 			return success;
 		}
+		StoreStats stats() const {
+			return recorder.snapshot();
+		}
+		std::string statsSummary() const {
+			return stats().summary();
+		}
 		void close() {
 		}
 	};
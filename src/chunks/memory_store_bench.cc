@@ -0,0 +1,66 @@
+#include <benchmark/benchmark.h>
+#include "memory_store.h"
+#include "test_util.h"
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace nomp;
+using test::makeChunks;
+
+// Args: chunk count, chunk size
+static void BM_MemoryStorePutCommit(benchmark::State& state) {
+	const auto chunks = makeChunks(size_t(state.range(0)), size_t(state.range(1)));
+	for (auto _ : state) {
+		MemoryStore storage;
+		auto view = storage.newView();
+		for (const auto& c : chunks) {
+			view->put(c);
+		}
+		benchmark::DoNotOptimize(view->commit(chunks[0].hash(), view->root()));
+	}
+	state.SetItemsProcessed(int64_t(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_MemoryStorePutCommit)->ArgsProduct({ { 1 << 10, 1 << 14 }, { 64, 4096 } });
+
+// Every thread reads through one shared view, so the threads contend for the
+// same store the way concurrent readers of a database do.
+static void BM_MemoryStoreHas(benchmark::State& state) {
+	static std::vector<Chunk> chunks;
+	static std::unique_ptr<MemoryStore> storage;
+	static std::optional<interface::IChunkStore> view;
+	if (state.thread_index() == 0) {
+		// the previous run has finished, and the others wait for us to enter the loop
+		view.reset();
+		chunks = makeChunks(size_t(state.range(0)), 64);
+		storage = std::make_unique<MemoryStore>();
+		view.emplace(storage->newView());
+		for (const auto& c : chunks) {
+			(*view)->put(c);
+		}
+		(*view)->commit(chunks[0].hash(), (*view)->root());
+	}
+	size_t i = size_t(state.thread_index()) * 7919;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize((*view)->has(chunks[i++ % chunks.size()].hash()));
+	}
+}
+BENCHMARK(BM_MemoryStoreHas)->Range(1 << 10, 1 << 16)->ThreadRange(1, 8);
+
+static void BM_MemoryStoreGetMany(benchmark::State& state) {
+	const auto chunks = makeChunks(size_t(state.range(0)), 64);
+	MemoryStore storage;
+	auto view = storage.newView();
+	HashSet hashes;
+	for (const auto& c : chunks) {
+		view->put(c);
+		hashes.insert(c.hash());
+	}
+	view->commit(chunks[0].hash(), view->root());
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(view->getMany(hashes));
+	}
+	state.SetItemsProcessed(int64_t(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_MemoryStoreGetMany)->Range(1 << 10, 1 << 14);
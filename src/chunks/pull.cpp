@@ -0,0 +1,189 @@
+#include "pull.h"
+#include "channel.h"
+#include "walk.h"
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+namespace nomp {
+	namespace {
+		// Decides when a chunk found missing may be put: only once everything it refers
+		// to is in the sink. The sink's absent() is what lets a later pull skip a whole
+		// subgraph, so putting a parent before its children would let a pull cut short
+		// leave a chunk that the next pull trusts but whose subgraph is incomplete.
+		class WriteOrder {
+			struct Held {
+				Chunk chunk;
+				size_t outstanding = 0; // refs not yet in the sink
+			};
+
+			std::mutex mtx;
+			HashSet stored; // in the sink along with everything below
+			std::unordered_map<Hash, Held, Hash::Hasher> held;
+			std::unordered_map<Hash, std::vector<Hash>, Hash::Hasher> parents; // by ref, the held chunks waiting on it
+
+			// Under mtx.
+			void complete(const Hash& hash, std::vector<Chunk>& ready) {
+				stored.insert(hash);
+				auto waiting = parents.find(hash);
+				if (waiting == parents.end()) {
+					return;
+				}
+				for (const auto& parent : waiting->second) {
+					auto h = held.find(parent);
+					if (--h->second.outstanding == 0) {
+						ready.push_back(std::move(h->second.chunk));
+						held.erase(h);
+					}
+				}
+				parents.erase(waiting);
+			}
+
+		public:
+			// |chunk|, missing from the sink, refers to |refs|. Returns true if it can be
+			// put now; otherwise it is held until complete() has been called for its refs.
+			bool found(const Chunk& chunk, std::span<const Hash> refs) {
+				std::lock_guard lock(mtx);
+				Held entry{ chunk };
+				HashSet distinct;
+				for (const auto& ref : refs) {
+					if (!ref.isEmpty() && !stored.contains(ref) && distinct.insert(ref).second) {
+						parents[ref].push_back(chunk.hash());
+						++entry.outstanding;
+					}
+				}
+				if (entry.outstanding == 0) {
+					return true;
+				}
+				held.emplace(chunk.hash(), std::move(entry));
+				return false;
+			}
+
+			// |hashes| are in the sink with their subgraphs; appends the held chunks that
+			// can now be put to |ready|.
+			template <typename Hashes>
+			void complete(const Hashes& hashes, std::vector<Chunk>& ready) {
+				std::lock_guard lock(mtx);
+				for (const auto& hash : hashes) {
+					complete(hash, ready);
+				}
+			}
+		};
+	}
+
+	// A pull is a walk of the source that skips whatever the sink already has, run
+	// alongside one thread putting the chunks found into the sink. A chunk is only
+	// sent to that thread once its refs are in, so the sink is filled bottom up. The
+	// channel between them is bounded, so at most fetchThreads batches being fetched
+	// plus maxPendingBatches batches' worth of chunks are queued at once; interior
+	// chunks waiting on their subtrees are held besides.
+	PullProgress pull(interface::IChunkStore& src, interface::IChunkStore& sink, const Hash& root,
+		interface::IRefDecoder& decoder, const PullOptions& options)
+	{
+		if (options.batchSize == 0 || options.fetchThreads == 0 || options.maxPendingBatches == 0) {
+			throw std::invalid_argument("Pull batch size, fetch threads and pending batches must be at least 1");
+		}
+		if (root.isEmpty()) {
+			return PullProgress{};
+		}
+		std::atomic<uint64_t> chunksQueried = 0;
+		std::atomic<uint64_t> chunksMissing = 0;
+		std::atomic<uint64_t> chunksWritten = 0;
+		std::atomic<uint64_t> bytesWritten = 0;
+		auto progress = [&] {
+			return PullProgress{ chunksQueried.load(), chunksMissing.load(), chunksWritten.load(), bytesWritten.load() };
+		};
+
+		WriteOrder order;
+		Channel<Chunk> writeQueue(options.maxPendingBatches * options.batchSize);
+		std::exception_ptr writeError;
+		std::thread writer([&] {
+			try {
+				uint64_t unreported = 0;
+				// parents freed by this thread's own puts; kept off the bounded channel,
+				// which this thread alone drains
+				std::deque<Chunk> freed;
+				std::vector<Chunk> ready;
+				while (true) {
+					std::optional<Chunk> c;
+					if (!freed.empty()) {
+						c = std::move(freed.front());
+						freed.pop_front();
+					}
+					else if (!(c = writeQueue.next())) {
+						break;
+					}
+					sink->put(*c);
+					++chunksWritten;
+					bytesWritten += c->size();
+					order.complete(std::span{ &c->hash(), 1 }, ready);
+					std::move(ready.begin(), ready.end(), std::back_inserter(freed));
+					ready.clear();
+					if (++unreported == options.batchSize && options.progress) {
+						options.progress(progress());
+						unreported = 0;
+					}
+				}
+				if (unreported > 0 && options.progress) {
+					options.progress(progress());
+				}
+			}
+			catch (...) {
+				writeError = std::current_exception();
+				// fails the walk's next send
+				writeQueue.close();
+			}
+		});
+
+		RefWalker walker(decoder, WalkOptions{ options.batchSize, options.fetchThreads });
+		walker.add(root);
+		std::exception_ptr walkError;
+		try {
+			walker.run(
+				[&](const HashSet& hashes) { return src->getMany(hashes); },
+				[&](const Chunk&) { return true; },
+				// a chunk the sink has comes with everything it refers to
+				[&](HashSet& hashes) {
+					chunksQueried += hashes.size();
+					auto missing = sink->absent(hashes);
+					chunksMissing += missing->size();
+					std::vector<Hash> present;
+					for (const auto& h : hashes) {
+						if (!missing->contains(h)) {
+							present.push_back(h);
+						}
+					}
+					std::vector<Chunk> ready;
+					order.complete(present, ready);
+					for (auto& c : ready) {
+						writeQueue.send(std::move(c));
+					}
+					hashes = std::move(*missing);
+				},
+				[&](const Chunk& c, std::span<const Hash> refs, size_t) {
+					if (order.found(c, refs)) {
+						writeQueue.send(c);
+					}
+				});
+		}
+		catch (...) {
+			walkError = std::current_exception();
+		}
+		writeQueue.close();
+		writer.join();
+		if (writeError) {
+			std::rethrow_exception(writeError);
+		}
+		if (walkError) {
+			std::rethrow_exception(walkError);
+		}
+		return progress();
+	}
+}
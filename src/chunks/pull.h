@@ -0,0 +1,32 @@
+#pragma once
+#include "common.h"
+#include "chunk_store.h"
+#include "refs.h"
+#include <cstdint>
+#include <functional>
+
+namespace nomp {
+	struct PullProgress {
+		uint64_t chunksQueried = 0; // addresses checked against the sink
+		uint64_t chunksMissing = 0; // addresses the sink lacked, to be copied
+		uint64_t chunksWritten = 0;
+		uint64_t bytesWritten = 0;
+	};
+
+	struct PullOptions {
+		size_t batchSize = 256; // addresses per absent() and getMany() call
+		size_t fetchThreads = 4; // concurrent getMany() calls against the source
+		size_t maxPendingBatches = 8; // fetched batches waiting to be written, bounds memory
+		// Called on the writing thread after every batchSize chunks put into the sink,
+		// and once more at the end.
+		std::function<void(const PullProgress&)> progress;
+	};
+
+	// Copies every chunk reachable from |root| in |src| that |sink| lacks. A chunk
+	// the sink already has is taken to come with everything it refers to, so its
+	// subgraph is not visited. Chunks are put children first, so a pull that fails
+	// partway leaves nothing in the sink whose subgraph is incomplete and can simply be
+	// retried. Pull only puts chunks; commit the new root to the sink once it returns.
+	PullProgress pull(interface::IChunkStore& src, interface::IChunkStore& sink, const Hash& root,
+		interface::IRefDecoder& decoder, const PullOptions& options = {});
+}
@@ -0,0 +1,188 @@
+#include <gtest/gtest.h>
+#include "pull.h"
+#include "memory_store.h"
+#include "nbs/store.h"
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace nomp;
+
+namespace {
+	// Builds a tree of |depth| levels below a root, |fanout| children per node,
+	// putting every chunk into |store|. Leaves carry |salt| so trees can differ.
+	Hash buildTree(interface::IChunkStore& store, int depth, int fanout, const std::string& salt, size_t& count) {
+		std::vector<Hash> children;
+		if (depth > 0) {
+			for (int i = 0; i < fanout; ++i) {
+				children.push_back(buildTree(store, depth - 1, fanout, salt + "/" + std::to_string(i), count));
+			}
+		}
+		const auto payload = depth == 0 ? salt : std::string("node");
+		auto chunk = RefListDecoder::encode(children, std::span{ (const std::byte*)payload.data(), payload.size() });
+		store->put(chunk);
+		++count;
+		return chunk.hash();
+	}
+
+	// Forwards to another store, but fails every put once |failAfter| puts have gone
+	// through.
+	class FlakyStore {
+		interface::IChunkStore& inner;
+		const size_t failAfter;
+		std::atomic<size_t> puts = 0;
+
+	public:
+
+		FlakyStore(interface::IChunkStore& inner, size_t failAfter) : inner(inner), failAfter(failAfter) {}
+
+		bool has(const Hash& hash) { return inner->has(hash); }
+		std::unique_ptr<HashSet> absent(const HashSet& hashes) { return inner->absent(hashes); }
+		std::optional<Chunk> get(const Hash& hash) { return inner->get(hash); }
+		std::vector<Chunk> getMany(const HashSet& hashes) { return inner->getMany(hashes); }
+		void put(const Chunk& chunk) {
+			if (puts++ >= failAfter) {
+				throw std::runtime_error("injected put failure");
+			}
+			inner->put(chunk);
+		}
+		std::string_view version() { return inner->version(); }
+		void rebase() { inner->rebase(); }
+		Hash root() { return inner->root(); }
+		bool commit(const Hash& newRoot, const Hash& last) { return inner->commit(newRoot, last); }
+		StoreStats stats() { return inner->stats(); }
+		std::string statsSummary() { return inner->statsSummary(); }
+		void close() {}
+	};
+}
+
+TEST(RefsTest, TestRefListRoundTrip) {
+	auto a = Chunk::FromString("a");
+	auto b = Chunk::FromString("b");
+	std::vector<Hash> listed{ a.hash(), b.hash() };
+	auto chunk = RefListDecoder::encode(listed);
+	interface::IRefDecoder decoder = pro::make_proxy<interface::RefDecoder, RefListDecoder>();
+	std::vector<Hash> refs;
+	decoder->refs(chunk, refs);
+	EXPECT_EQ(refs, listed);
+	EXPECT_EQ(chunk.hash(), Hash::Of(chunk.data()));
+
+	EXPECT_THROW(decoder->refs(Chunk::FromString("ab"), refs), std::runtime_error);
+	auto truncated = chunk.data().subSlice(0, 30);
+	EXPECT_THROW(decoder->refs(Chunk(truncated, Hash::Of(truncated)), refs), std::runtime_error);
+}
+
+TEST(PullTest, TestPullCopiesOnlyWhatIsMissing) {
+	MemoryStoreFactory memory;
+	NbsMemoryStoreFactory nbs(NbsOptions{ 1 << 12, 2 });
+	auto src = memory.createStore("src");
+	auto sink = nbs.createStore("sink");
+	interface::IRefDecoder decoder = pro::make_proxy<interface::RefDecoder, RefListDecoder>();
+
+	size_t count = 0;
+	const auto root = buildTree(src, 3, 6, "v1", count);
+	ASSERT_TRUE(src->commit(root, src->root()));
+
+	PullOptions options;
+	options.batchSize = 7;
+	options.fetchThreads = 3;
+	options.maxPendingBatches = 2;
+	uint64_t lastWritten = 0;
+	options.progress = [&](const PullProgress& p) {
+		EXPECT_GE(p.chunksWritten, lastWritten);
+		lastWritten = p.chunksWritten;
+	};
+	auto result = pull(src, sink, root, decoder, options);
+	EXPECT_EQ(result.chunksWritten, count);
+	EXPECT_EQ(result.chunksMissing, count);
+	EXPECT_EQ(lastWritten, count);
+	options.progress = nullptr;
+	ASSERT_TRUE(sink->commit(root, sink->root()));
+
+	std::vector<Hash> pending{ root };
+	while (!pending.empty()) {
+		auto h = pending.back();
+		pending.pop_back();
+		auto chunk = sink->get(h);
+		ASSERT_TRUE(chunk.has_value());
+		decoder->refs(*chunk, pending);
+	}
+
+	// Pulling again copies nothing, and a new root that shares all but one leaf
+	// copies only the path down to that leaf.
+	EXPECT_EQ(pull(src, sink, root, decoder, options).chunksWritten, 0u);
+
+	auto rootChunk = src->get(root);
+	std::vector<Hash> children;
+	decoder->refs(*rootChunk, children);
+	auto child = src->get(children[0]);
+	std::vector<Hash> grandchildren;
+	decoder->refs(*child, grandchildren);
+	auto grandchild = src->get(grandchildren[0]);
+	std::vector<Hash> leaves;
+	decoder->refs(*grandchild, leaves);
+	auto leaf = RefListDecoder::encode({}, std::span{ (const std::byte*)"changed", 7 });
+	src->put(leaf);
+	leaves[0] = leaf.hash();
+	auto newGrandchild = RefListDecoder::encode(leaves, std::span{ (const std::byte*)"node", 4 });
+	src->put(newGrandchild);
+	grandchildren[0] = newGrandchild.hash();
+	auto newChild = RefListDecoder::encode(grandchildren, std::span{ (const std::byte*)"node", 4 });
+	src->put(newChild);
+	children[0] = newChild.hash();
+	auto newRoot = RefListDecoder::encode(children, std::span{ (const std::byte*)"node", 4 });
+	src->put(newRoot);
+
+	result = pull(src, sink, newRoot.hash(), decoder, options);
+	EXPECT_EQ(result.chunksWritten, 4u);
+	EXPECT_TRUE(sink->has(leaf.hash()));
+}
+
+TEST(PullTest, TestPullFailsOnMissingChunk) {
+	MemoryStoreFactory memory;
+	auto src = memory.createStore("src");
+	auto sink = memory.createStore("sink");
+	interface::IRefDecoder decoder = pro::make_proxy<interface::RefDecoder, RefListDecoder>();
+
+	auto dangling = Chunk::FromString("never stored");
+	std::vector<Hash> refs{ dangling.hash() };
+	auto root = RefListDecoder::encode(refs);
+	src->put(root);
+	EXPECT_THROW(pull(src, sink, root.hash(), decoder), std::runtime_error);
+	EXPECT_THROW(pull(src, sink, root.hash(), decoder, PullOptions{ .batchSize = 0 }), std::invalid_argument);
+}
+
+TEST(PullTest, TestPullRetriesAfterFailedPut) {
+	MemoryStoreFactory memory;
+	NbsMemoryStoreFactory nbs(NbsOptions{ 1 << 12, 2 });
+	auto src = memory.createStore("src");
+	interface::IRefDecoder decoder = pro::make_proxy<interface::RefDecoder, RefListDecoder>();
+
+	size_t count = 0;
+	const auto root = buildTree(src, 3, 5, "v1", count);
+	PullOptions options;
+	options.batchSize = 4;
+	options.fetchThreads = 3;
+
+	// Every partial pull must leave the sink with only complete subgraphs, so the
+	// retry finds and copies whatever is still missing.
+	for (size_t failAfter : { size_t{ 0 }, size_t{ 1 }, count / 3, count - 1 }) {
+		auto target = nbs.createStore("sink-" + std::to_string(failAfter));
+		interface::IChunkStore flaky = pro::make_proxy<interface::ChunkStore, FlakyStore>(target, failAfter);
+		EXPECT_THROW(pull(src, flaky, root, decoder, options), std::runtime_error);
+		EXPECT_FALSE(target->has(root));
+
+		auto result = pull(src, target, root, decoder, options);
+		EXPECT_EQ(result.chunksWritten, count - failAfter);
+		ASSERT_TRUE(target->commit(root, target->root()));
+		std::vector<Hash> pending{ root };
+		while (!pending.empty()) {
+			auto h = pending.back();
+			pending.pop_back();
+			auto chunk = target->get(h);
+			ASSERT_TRUE(chunk.has_value());
+			decoder->refs(*chunk, pending);
+		}
+	}
+}
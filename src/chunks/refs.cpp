@@ -0,0 +1,40 @@
+#include "refs.h"
+#include "binary/binary.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace nomp {
+	static void checkRefListDecoder() {
+		pro::make_proxy<interface::RefDecoder, RefListDecoder>();
+	}
+
+	constexpr size_t RefCountSize = 4; // bytes
+
+	Chunk RefListDecoder::encode(std::span<const Hash> refs, std::span<const std::byte> payload) {
+		std::vector<std::byte> buf(RefCountSize + refs.size() * ByteLen + payload.size());
+		BigEndian::storeUint32(buf.data(), uint32_t(refs.size()));
+		auto p = buf.begin() + RefCountSize;
+		for (const auto& ref : refs) {
+			const std::span<const std::byte> bytes(ref);
+			p = std::copy(bytes.begin(), bytes.end(), p);
+		}
+		std::copy(payload.begin(), payload.end(), p);
+		const Hash h = Hash::Of(std::span<const std::byte>(buf));
+		return Chunk(ByteSlice(std::move(buf)), h);
+	}
+
+	void RefListDecoder::refs(const Chunk& chunk, std::vector<Hash>& refs) const {
+		const auto data = chunk.data();
+		const auto bytes = data.span();
+		if (bytes.size() < RefCountSize) {
+			throw std::runtime_error("Chunk " + chunk.hash().toString() + " is too short for a ref list");
+		}
+		const uint64_t count = BigEndian::loadUint32(bytes.data());
+		if (count * ByteLen > bytes.size() - RefCountSize) {
+			throw std::runtime_error("Chunk " + chunk.hash().toString() + " lists more refs than it holds");
+		}
+		for (uint64_t i = 0; i < count; ++i) {
+			refs.emplace_back(std::span{ (const char*)bytes.data() + RefCountSize + i * ByteLen, size_t(ByteLen) });
+		}
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include "common.h"
+#include "chunk.h"
+#include <span>
+#include <vector>
+
+namespace nomp {
+	namespace interface {
+		PRO_DEF_MEM_DISPATCH(MemRefs, refs);
+
+		// RefDecoder knows how to find the addresses a chunk refers to. Chunks are
+		// opaque to the stores, so anything that walks the chunk graph takes one.
+		// Implementations must be safe to call from several threads at once.
+		struct RefDecoder : pro::facade_builder
+			// Appends the addresses |chunk| refers to to |refs|.
+			::add_convention<MemRefs, void(const Chunk& chunk, std::vector<Hash>& refs)>
+			::build {
+		};
+		using IRefDecoder = pro::proxy<RefDecoder>;
+	}
+
+	/*
+		RefList encoding:
+			Ref count // 4 bytes
+			Refs // 20 bytes each
+			Payload // the rest of the chunk
+	*/
+	// RefListDecoder decodes chunks in the RefList encoding, a minimal format that
+	// lists a chunk's refs up front. It is what tests and tools use to build chunk
+	// graphs without a value encoding.
+	class RefListDecoder {
+	public:
+		static Chunk encode(std::span<const Hash> refs, std::span<const std::byte> payload = {});
+		void refs(const Chunk& chunk, std::vector<Hash>& refs) const;
+	};
+}
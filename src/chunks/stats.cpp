@@ -0,0 +1,201 @@
+#include "stats.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <format>
+#include <functional>
+#include <numeric>
+#include <thread>
+
+namespace nomp {
+	size_t Histogram::bucketOf(uint64_t v) {
+		v = std::min<uint64_t>(v, (1ULL << MaxValueBits) - 1);
+		if (v < SubBucketCount) {
+			return size_t(v);
+		}
+		// v = top << e with top in [SubBucketCount, 2 * SubBucketCount)
+		const unsigned e = unsigned(std::bit_width(v)) - 1 - SubBucketBits;
+		return (size_t(e + 1) << SubBucketBits) + size_t((v >> e) - SubBucketCount);
+	}
+
+	uint64_t Histogram::bucketLow(size_t i) {
+		if (i < SubBucketCount) {
+			return i;
+		}
+		const unsigned e = unsigned(i >> SubBucketBits) - 1;
+		return (SubBucketCount + (i & (SubBucketCount - 1))) << e;
+	}
+
+	void Histogram::record(uint64_t v, uint64_t n) {
+		buckets[bucketOf(v)] += n;
+		total += n;
+		sum += v * n;
+		max = std::max(max, v);
+	}
+
+	void Histogram::merge(const Histogram& other) {
+		for (size_t i = 0; i < BucketCount; ++i) {
+			buckets[i] += other.buckets[i];
+		}
+		total += other.total;
+		sum += other.sum;
+		max = std::max(max, other.max);
+	}
+
+	uint64_t Histogram::percentile(double q) const {
+		if (total == 0) {
+			return 0;
+		}
+		const auto rank = std::max<uint64_t>(1, uint64_t(std::ceil(std::clamp(q, 0.0, 1.0) * double(total))));
+		uint64_t seen = 0;
+		for (size_t i = 0; i < BucketCount; ++i) {
+			seen += buckets[i];
+			if (seen >= rank) {
+				// the highest value the bucket can hold, but never above what was recorded
+				const uint64_t high = i + 1 < BucketCount ? bucketLow(i + 1) - 1 : max;
+				return std::min(high, max);
+			}
+		}
+		return max;
+	}
+
+	std::string_view storeOpName(StoreOp op) {
+		switch (op) {
+		case StoreOp::Has: return "has";
+		case StoreOp::Get: return "get";
+		case StoreOp::GetMany: return "getMany";
+		case StoreOp::Put: return "put";
+		case StoreOp::Commit: return "commit";
+		case StoreOp::Flush: return "flush";
+		case StoreOp::TableOpen: return "tableOpen";
+		}
+		return "unknown";
+	}
+
+	std::string formatNanos(uint64_t ns) {
+		if (ns < 1000) return std::format("{}ns", ns);
+		if (ns < 1000000) return std::format("{:.1f}us", double(ns) / 1e3);
+		if (ns < 1000000000) return std::format("{:.1f}ms", double(ns) / 1e6);
+		return std::format("{:.2f}s", double(ns) / 1e9);
+	}
+
+	std::string StoreStats::summary() const {
+		std::string out;
+		for (size_t i = 0; i < StoreOpCount; ++i) {
+			const auto& s = ops[i];
+			if (s.count == 0) {
+				continue;
+			}
+			out += std::format("{:<10} count={} bytes={} mean={} p50={} p99={} p999={} max={}\n",
+				storeOpName(StoreOp(i)), s.count, s.bytes, formatNanos(uint64_t(s.latency.mean())),
+				formatNanos(s.latency.percentile(0.5)), formatNanos(s.latency.percentile(0.99)),
+				formatNanos(s.latency.percentile(0.999)), formatNanos(s.latency.max));
+		}
+		out += std::format("cache      hits={} misses={}\n", cacheHits, cacheMisses);
+		out += std::format("bytes      read={} written={} compression={:.2f}x\n", bytesRead, bytesWritten, compressionRatio());
+		if (chunksDeduped > 0) {
+			out += std::format("dedup      chunks={} bytes={}\n", chunksDeduped, bytesDeduped);
+		}
+		return out;
+	}
+
+	StatsRecorder::StatsRecorder() :
+		shardCount(std::bit_ceil(std::max(1u, std::thread::hardware_concurrency()))),
+		shards(std::make_unique<std::atomic<Shard*>[]>(shardCount))
+	{
+	}
+
+	StatsRecorder::~StatsRecorder() {
+		for (size_t i = 0; i < shardCount; ++i) {
+			delete shards[i].load(std::memory_order_relaxed);
+		}
+	}
+
+	StatsRecorder::Shard& StatsRecorder::shard() const {
+		static std::atomic<size_t> nextSlot = 0;
+		thread_local const size_t slot = nextSlot.fetch_add(1, std::memory_order_relaxed);
+		auto& entry = shards[slot & (shardCount - 1)];
+		auto* s = entry.load(std::memory_order_acquire);
+		if (s == nullptr) {
+			auto* fresh = new Shard();
+			if (entry.compare_exchange_strong(s, fresh, std::memory_order_acq_rel)) {
+				s = fresh;
+			}
+			else {
+				delete fresh; // another thread sharing the slot got there first
+			}
+		}
+		return *s;
+	}
+
+	void StatsRecorder::record(StoreOp op, Clock::duration latency, uint64_t bytes) const {
+		auto& c = shard().ops[size_t(op)];
+		const auto ns = uint64_t(std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count()));
+		c.count.fetch_add(1, std::memory_order_relaxed);
+		c.bytes.fetch_add(bytes, std::memory_order_relaxed);
+		c.sum.fetch_add(ns, std::memory_order_relaxed);
+		c.buckets[Histogram::bucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+		auto max = c.max.load(std::memory_order_relaxed);
+		while (ns > max && !c.max.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {
+		}
+	}
+
+	void StatsRecorder::cacheHit() const {
+		shard().cacheHits.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void StatsRecorder::cacheMiss() const {
+		shard().cacheMisses.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void StatsRecorder::read(uint64_t bytes) const {
+		shard().bytesRead.fetch_add(bytes, std::memory_order_relaxed);
+	}
+
+	void StatsRecorder::wrote(uint64_t bytes, uint64_t uncompressed) const {
+		auto& s = shard();
+		s.bytesWritten.fetch_add(bytes, std::memory_order_relaxed);
+		s.bytesWrittenUncompressed.fetch_add(uncompressed, std::memory_order_relaxed);
+	}
+
+	void StatsRecorder::deduped(uint64_t chunks, uint64_t bytes) const {
+		auto& s = shard();
+		s.chunksDeduped.fetch_add(chunks, std::memory_order_relaxed);
+		s.bytesDeduped.fetch_add(bytes, std::memory_order_relaxed);
+	}
+
+	// Counters are read one by one while others may be recording, so a snapshot taken
+	// under load can be off by the operations in flight.
+	StoreStats StatsRecorder::snapshot() const {
+		StoreStats stats;
+		for (size_t s = 0; s < shardCount; ++s) {
+			const auto* p = shards[s].load(std::memory_order_acquire);
+			if (p == nullptr) {
+				continue;
+			}
+			const auto& shard = *p;
+			for (size_t i = 0; i < StoreOpCount; ++i) {
+				const auto& c = shard.ops[i];
+				auto& out = stats.ops[i];
+				out.count += c.count.load(std::memory_order_relaxed);
+				out.bytes += c.bytes.load(std::memory_order_relaxed);
+				for (size_t b = 0; b < Histogram::BucketCount; ++b) {
+					out.latency.buckets[b] += c.buckets[b].load(std::memory_order_relaxed);
+				}
+				out.latency.sum += c.sum.load(std::memory_order_relaxed);
+				out.latency.max = std::max(out.latency.max, c.max.load(std::memory_order_relaxed));
+			}
+			stats.cacheHits += shard.cacheHits.load(std::memory_order_relaxed);
+			stats.cacheMisses += shard.cacheMisses.load(std::memory_order_relaxed);
+			stats.bytesRead += shard.bytesRead.load(std::memory_order_relaxed);
+			stats.bytesWritten += shard.bytesWritten.load(std::memory_order_relaxed);
+			stats.bytesWrittenUncompressed += shard.bytesWrittenUncompressed.load(std::memory_order_relaxed);
+			stats.chunksDeduped += shard.chunksDeduped.load(std::memory_order_relaxed);
+			stats.bytesDeduped += shard.bytesDeduped.load(std::memory_order_relaxed);
+		}
+		for (auto& op : stats.ops) {
+			op.latency.total = std::accumulate(op.latency.buckets.begin(), op.latency.buckets.end(), uint64_t(0));
+		}
+		return stats;
+	}
+}
@@ -0,0 +1,145 @@
+#pragma once
+#include "common.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace nomp {
+	// Histogram counts values, typically latencies in nanoseconds, in log-linear
+	// buckets like an HDR histogram: every power of two is split into SubBucketCount
+	// buckets, so any recorded value is known to within 1 / SubBucketCount of itself.
+	// Values at or above 2^MaxValueBits land in the last bucket.
+	class Histogram {
+	public:
+		static constexpr unsigned SubBucketBits = 4;
+		static constexpr uint64_t SubBucketCount = 1ULL << SubBucketBits;
+		static constexpr unsigned MaxValueBits = 36; // about 69 seconds in nanoseconds
+		static constexpr size_t BucketCount = size_t(MaxValueBits - SubBucketBits + 1) << SubBucketBits;
+
+		static size_t bucketOf(uint64_t v);
+		// Returns the smallest value that falls in bucket |i|.
+		static uint64_t bucketLow(size_t i);
+
+		std::array<uint64_t, BucketCount> buckets{};
+		uint64_t total = 0;
+		uint64_t sum = 0;
+		uint64_t max = 0;
+
+		void record(uint64_t v, uint64_t n = 1);
+		void merge(const Histogram& other);
+
+		uint64_t count() const { return total; }
+		double mean() const { return total == 0 ? 0 : double(sum) / double(total); }
+		// Returns a value that at least |q| (0..1) of the recorded values do not exceed.
+		uint64_t percentile(double q) const;
+	};
+
+	// Renders a duration in nanoseconds with a unit that keeps it short, e.g. "12.3us".
+	std::string formatNanos(uint64_t ns);
+
+	// StoreOp names the ChunkStore operations a StatsRecorder times.
+	enum class StoreOp {
+		Has,
+		Get,
+		GetMany,
+		Put,
+		Commit,
+		Flush, // writing a memtable out as a table
+		TableOpen,
+	};
+	constexpr size_t StoreOpCount = 7;
+	std::string_view storeOpName(StoreOp op);
+
+	struct OpStats {
+		uint64_t count = 0;
+		uint64_t bytes = 0; // chunk bytes put or returned, table bytes flushed
+		Histogram latency; // nanoseconds
+	};
+
+	// StoreStats is a snapshot of what a ChunkStore has done since it was opened.
+	struct StoreStats {
+		std::array<OpStats, StoreOpCount> ops;
+		uint64_t cacheHits = 0; // reads served from memory without touching a table
+		uint64_t cacheMisses = 0; // reads that had to go to the tables
+		uint64_t bytesRead = 0; // chunk bytes read out of tables
+		uint64_t bytesWritten = 0; // table bytes written
+		uint64_t bytesWrittenUncompressed = 0; // chunk bytes in the tables written
+		uint64_t chunksDeduped = 0; // chunks left out of a flush because a table already held them
+		uint64_t bytesDeduped = 0; // their uncompressed bytes
+
+		const OpStats& op(StoreOp o) const { return ops[size_t(o)]; }
+		double compressionRatio() const {
+			return bytesWritten == 0 ? 0 : double(bytesWrittenUncompressed) / double(bytesWritten);
+		}
+		// Renders the snapshot as a few human-readable lines.
+		std::string summary() const;
+	};
+
+	// StatsRecorder collects StoreStats from any number of threads. Counters are
+	// striped over cache-line aligned shards, one per hardware thread. Threads take
+	// shards round robin in the order they first record anything, so recording is a
+	// handful of relaxed atomic adds on a shard no other thread uses until there are
+	// more recording threads than hardware threads. A shard is about 30 KiB and is
+	// only allocated once a thread records into it.
+	class StatsRecorder {
+		struct OpCounters {
+			std::atomic<uint64_t> count = 0;
+			std::atomic<uint64_t> bytes = 0;
+			std::atomic<uint64_t> sum = 0;
+			std::atomic<uint64_t> max = 0;
+			std::array<std::atomic<uint64_t>, Histogram::BucketCount> buckets{};
+		};
+		struct alignas(64) Shard {
+			std::array<OpCounters, StoreOpCount> ops;
+			std::atomic<uint64_t> cacheHits = 0;
+			std::atomic<uint64_t> cacheMisses = 0;
+			std::atomic<uint64_t> bytesRead = 0;
+			std::atomic<uint64_t> bytesWritten = 0;
+			std::atomic<uint64_t> bytesWrittenUncompressed = 0;
+			std::atomic<uint64_t> chunksDeduped = 0;
+			std::atomic<uint64_t> bytesDeduped = 0;
+		};
+		size_t shardCount;
+		std::unique_ptr<std::atomic<Shard*>[]> shards; // null until first used
+
+		Shard& shard() const;
+
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		// Timer records the time from its creation to its destruction against |op|.
+		class Timer {
+			const StatsRecorder& recorder;
+			StoreOp op;
+			Clock::time_point start;
+		public:
+			uint64_t bytes = 0;
+
+			Timer(const StatsRecorder& recorder, StoreOp op) : recorder(recorder), op(op), start(Clock::now()) {}
+			Timer(const Timer&) = delete;
+			Timer& operator=(const Timer&) = delete;
+			~Timer() {
+				recorder.record(op, Clock::now() - start, bytes);
+			}
+		};
+
+		StatsRecorder();
+		~StatsRecorder();
+		StatsRecorder(const StatsRecorder&) = delete;
+		StatsRecorder& operator=(const StatsRecorder&) = delete;
+
+		Timer time(StoreOp op) const { return Timer(*this, op); }
+		void record(StoreOp op, Clock::duration latency, uint64_t bytes = 0) const;
+		void cacheHit() const;
+		void cacheMiss() const;
+		void read(uint64_t bytes) const;
+		void wrote(uint64_t bytes, uint64_t uncompressed) const;
+		void deduped(uint64_t chunks, uint64_t bytes) const;
+
+		StoreStats snapshot() const;
+	};
+}
@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+#include "stats.h"
+#include <thread>
+#include <vector>
+
+using namespace nomp;
+
+TEST(HistogramTest, TestBuckets) {
+	for (uint64_t v : { 0ULL, 1ULL, 15ULL, 16ULL, 17ULL, 1000ULL, 123456789ULL, (1ULL << 35) + 12345 }) {
+		const auto i = Histogram::bucketOf(v);
+		EXPECT_LE(Histogram::bucketLow(i), v);
+		EXPECT_GT(Histogram::bucketLow(i + 1), v);
+		// buckets are never wider than 1 / SubBucketCount of their values
+		EXPECT_LE(Histogram::bucketLow(i + 1) - Histogram::bucketLow(i), std::max<uint64_t>(1, v / Histogram::SubBucketCount));
+	}
+	for (size_t i = 0; i + 1 < Histogram::BucketCount; ++i) {
+		EXPECT_EQ(Histogram::bucketOf(Histogram::bucketLow(i)), i);
+	}
+	EXPECT_EQ(Histogram::bucketOf(~0ULL), Histogram::BucketCount - 1);
+}
+
+TEST(HistogramTest, TestPercentiles) {
+	Histogram h;
+	EXPECT_EQ(h.percentile(0.5), 0u);
+	for (uint64_t v = 1; v <= 10000; ++v) {
+		h.record(v);
+	}
+	EXPECT_EQ(h.count(), 10000u);
+	EXPECT_DOUBLE_EQ(h.mean(), 5000.5);
+	EXPECT_NEAR(double(h.percentile(0.5)), 5000, 5000 / double(Histogram::SubBucketCount));
+	EXPECT_NEAR(double(h.percentile(0.99)), 9900, 9900 / double(Histogram::SubBucketCount));
+	EXPECT_EQ(h.percentile(1), 10000u);
+
+	Histogram other;
+	other.record(1000000, 10000);
+	h.merge(other);
+	EXPECT_EQ(h.count(), 20000u);
+	EXPECT_EQ(h.max, 1000000u);
+	EXPECT_NEAR(double(h.percentile(0.5)), 10000, 10000 / double(Histogram::SubBucketCount));
+	EXPECT_EQ(h.percentile(0.75), 1000000u);
+}
+
+TEST(StatsRecorderTest, TestConcurrentRecording) {
+	StatsRecorder recorder;
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 8; ++t) {
+		threads.emplace_back([&] {
+			for (int i = 0; i < 1000; ++i) {
+				recorder.record(StoreOp::Get, std::chrono::microseconds(i % 100), 10);
+				recorder.cacheHit();
+			}
+			auto timer = recorder.time(StoreOp::Commit);
+		});
+	}
+	for (auto& t : threads) {
+		t.join();
+	}
+	auto stats = recorder.snapshot();
+	EXPECT_EQ(stats.op(StoreOp::Get).count, 8000u);
+	EXPECT_EQ(stats.op(StoreOp::Get).latency.count(), 8000u);
+	EXPECT_EQ(stats.op(StoreOp::Get).bytes, 80000u);
+	EXPECT_EQ(stats.op(StoreOp::Get).latency.max, 99000u);
+	EXPECT_EQ(stats.op(StoreOp::Commit).count, 8u);
+	EXPECT_EQ(stats.op(StoreOp::Put).count, 0u);
+	EXPECT_EQ(stats.cacheHits, 8000u);
+
+	auto summary = stats.summary();
+	EXPECT_NE(summary.find("get "), std::string::npos);
+	EXPECT_NE(summary.find("commit "), std::string::npos);
+	EXPECT_EQ(summary.find("put "), std::string::npos);
+}
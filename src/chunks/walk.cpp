@@ -0,0 +1,145 @@
+#include "walk.h"
+#include <stdexcept>
+#include <thread>
+
+namespace nomp {
+	RefWalker::RefWalker(interface::IRefDecoder& decoder, WalkOptions options) : decoder(decoder), options(options) {
+		if (options.batchSize == 0 || options.threads == 0) {
+			throw std::invalid_argument("Walk batch size and threads must be at least 1");
+		}
+	}
+
+	void RefWalker::add(const Hash& h) {
+		std::lock_guard lock(mtx);
+		if (!h.isEmpty() && added.insert(h).second) {
+			frontier.push_back(h);
+		}
+	}
+
+	void RefWalker::addRefs(const Chunk& chunk) {
+		std::vector<Hash> refs;
+		decoder->refs(chunk, refs);
+		for (const auto& r : refs) {
+			add(r);
+		}
+	}
+
+	WalkStats RefWalker::stats() {
+		std::lock_guard lock(mtx);
+		return totals;
+	}
+
+	void RefWalker::run(const Fetch& fetch, const Visit& visit, const Filter& filter, const Expand& expand) {
+		std::vector<std::thread> workers;
+		for (size_t t = 1; t < options.threads; ++t) {
+			workers.emplace_back([&, t] { work(fetch, visit, filter, expand, t); });
+		}
+		work(fetch, visit, filter, expand, 0);
+		for (auto& w : workers) {
+			w.join();
+		}
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
+
+	void RefWalker::work(const Fetch& fetch, const Visit& visit, const Filter& filter, const Expand& expand, size_t worker) {
+		std::vector<Hash> refs;
+		while (true) {
+			HashSet batch;
+			{
+				std::unique_lock lock(mtx);
+				// with nothing queued and nothing in flight, nothing more can turn up
+				cv.wait(lock, [this] { return !frontier.empty() || busy == 0 || error; });
+				if (error || frontier.empty()) {
+					return;
+				}
+				while (!frontier.empty() && batch.size() < options.batchSize) {
+					batch.insert(std::move(frontier.front()));
+					frontier.pop_front();
+				}
+				++busy;
+			}
+			try {
+				if (filter) {
+					filter(batch);
+				}
+				std::vector<Chunk> chunks;
+				if (!batch.empty()) {
+					chunks = fetch(batch);
+				}
+				if (chunks.size() != batch.size()) {
+					for (const auto& c : chunks) {
+						batch.erase(c.hash());
+					}
+					throw std::runtime_error("Walk found a ref to missing chunk " + batch.begin()->toString());
+				}
+				refs.clear();
+				uint64_t bytes = 0;
+				for (const auto& c : chunks) {
+					bytes += c.size();
+					if (visit(c)) {
+						const auto first = refs.size();
+						decoder->refs(c, refs);
+						if (expand) {
+							expand(c, std::span<const Hash>{ refs }.subspan(first), worker);
+						}
+					}
+				}
+				{
+					std::lock_guard lock(mtx);
+					for (auto& r : refs) {
+						if (!r.isEmpty() && added.insert(r).second) {
+							frontier.push_back(std::move(r));
+						}
+					}
+					totals.chunksVisited += chunks.size();
+					totals.bytesVisited += bytes;
+					totals.batches += chunks.empty() ? 0 : 1;
+					--busy;
+				}
+				cv.notify_all();
+			}
+			catch (...) {
+				{
+					std::lock_guard lock(mtx);
+					if (!error) {
+						error = std::current_exception();
+					}
+					--busy;
+				}
+				cv.notify_all();
+				return;
+			}
+		}
+	}
+
+	std::vector<Hash> depthFirstOrder(std::span<const Hash> roots, const RefsOf& refsOf) {
+		std::vector<Hash> order;
+		HashSet placed;
+		std::vector<Hash> stack(roots.rbegin(), roots.rend());
+		while (!stack.empty()) {
+			auto h = std::move(stack.back());
+			stack.pop_back();
+			const auto* refs = refsOf(h);
+			if (!refs || !placed.insert(h).second) {
+				continue;
+			}
+			order.push_back(h);
+			// pushed last to first so the first ref is taken next
+			stack.insert(stack.end(), refs->rbegin(), refs->rend());
+		}
+		return order;
+	}
+
+	WalkStats walk(interface::IChunkStore& store, std::span<const Hash> roots, interface::IRefDecoder& decoder,
+		const RefWalker::Visit& visit, const WalkOptions& options)
+	{
+		RefWalker walker(decoder, options);
+		for (const auto& h : roots) {
+			walker.add(h);
+		}
+		walker.run([&](const HashSet& hashes) { return store->getMany(hashes); }, visit);
+		return walker.stats();
+	}
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include "common.h"
+#include "chunk_store.h"
+#include "refs.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <vector>
+
+namespace nomp {
+	struct WalkOptions {
+		size_t batchSize = 256; // addresses per fetch
+		size_t threads = 4; // batches fetched and decoded at once
+	};
+
+	struct WalkStats {
+		uint64_t chunksVisited = 0;
+		uint64_t bytesVisited = 0;
+		uint64_t batches = 0; // fetches made
+	};
+
+	// RefWalker traverses a chunk graph breadth first: it fetches the addresses it
+	// has been given in batches on several threads, passes every chunk to a visitor
+	// and follows the refs a RefDecoder finds in it. No address is fetched twice over
+	// the life of a walker, so adding more roots and running it again only walks
+	// what is new.
+	class RefWalker {
+	public:
+		// Returns the chunks it finds among |hashes|.
+		using Fetch = std::function<std::vector<Chunk>(const HashSet& hashes)>;
+		// Called once per chunk, from several threads at once. Returns whether to
+		// follow the chunk's refs.
+		using Visit = std::function<bool(const Chunk& chunk)>;
+		// Removes from |hashes| the addresses not to fetch; nothing below them is
+		// walked either. Called on each batch before it is fetched.
+		using Filter = std::function<void(HashSet& hashes)>;
+		// Called with the refs of each chunk |visit| chose to follow, on the thread that
+		// visited it and before any of those refs is fetched. |worker| numbers that
+		// thread below WalkOptions::threads, for state kept per thread without locking.
+		using Expand = std::function<void(const Chunk& chunk, std::span<const Hash> refs, size_t worker)>;
+
+	private:
+		interface::IRefDecoder& decoder;
+		WalkOptions options;
+		std::mutex mtx; // guards everything below
+		std::condition_variable cv;
+		std::deque<Hash> frontier; // added but not yet fetched
+		HashSet added;
+		size_t busy = 0; // batches being fetched and decoded
+		std::exception_ptr error;
+		WalkStats totals;
+
+		void work(const Fetch& fetch, const Visit& visit, const Filter& filter, const Expand& expand, size_t worker);
+
+	public:
+		RefWalker(interface::IRefDecoder& decoder, WalkOptions options = {});
+
+		// Queues |h| for the next run, unless it has been added before or is empty.
+		void add(const Hash& h);
+		// Queues the refs of |chunk|.
+		void addRefs(const Chunk& chunk);
+		// Walks until everything added, and everything reachable from it, has been
+		// visited. Throws if a ref leads to a chunk |fetch| cannot find, and rethrows
+		// whatever the callbacks throw; the walker cannot be run again after that.
+		void run(const Fetch& fetch, const Visit& visit, const Filter& filter = nullptr, const Expand& expand = nullptr);
+
+		// Every address added so far, fetched or not. Not safe to call during run().
+		const HashSet& seen() const { return added; }
+		WalkStats stats();
+	};
+
+	// Returns the refs of |h|, or null if |h| is not part of the graph being ordered.
+	using RefsOf = std::function<const std::vector<Hash>*(const Hash& h)>;
+
+	// Returns the chunks reachable from |roots| in depth first preorder: each chunk
+	// comes before the chunks it refers to, and the subtree of each ref comes right
+	// after those of the refs before it, so a chunk's leaf children end up next to
+	// each other. A chunk reachable twice is placed under its first parent. Addresses
+	// |refsOf| does not know are left out, along with what only they lead to.
+	std::vector<Hash> depthFirstOrder(std::span<const Hash> roots, const RefsOf& refsOf);
+
+	// Visits every chunk reachable from |roots| in |store|.
+	WalkStats walk(interface::IChunkStore& store, std::span<const Hash> roots, interface::IRefDecoder& decoder,
+		const RefWalker::Visit& visit, const WalkOptions& options = {});
+}
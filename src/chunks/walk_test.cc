@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+#include "walk.h"
+#include "memory_store.h"
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace nomp;
+
+namespace {
+	Hash putNode(interface::IChunkStore& store, std::span<const Hash> children, const std::string& payload) {
+		auto chunk = RefListDecoder::encode(children, std::span{ (const std::byte*)payload.data(), payload.size() });
+		store->put(chunk);
+		return chunk.hash();
+	}
+}
+
+TEST(WalkTest, TestWalkVisitsEachChunkOnce) {
+	MemoryStoreFactory factory;
+	auto store = factory.createStore("walk");
+	interface::IRefDecoder decoder = pro::make_proxy<interface::RefDecoder, RefListDecoder>();
+
+	// 50 parents that all share one leaf besides their own
+	const auto shared = putNode(store, {}, "shared");
+	std::vector<Hash> parents;
+	for (int i = 0; i < 50; ++i) {
+		std::vector<Hash> children{ shared, putNode(store, {}, "leaf" + std::to_string(i)) };
+		parents.push_back(putNode(store, children, "parent" + std::to_string(i)));
+	}
+	std::vector<Hash> roots{ putNode(store, parents, "root") };
+
+	std::mutex mtx;
+	HashSet visited;
+	size_t repeats = 0;
+	auto stats = walk(store, roots, decoder, [&](const Chunk& c) {
+		std::lock_guard lock(mtx);
+		repeats += visited.insert(c.hash()).second ? 0 : 1;
+		return true;
+	}, WalkOptions{ 4, 3 });
+	EXPECT_EQ(repeats, 0u);
+	EXPECT_EQ(visited.size(), 102u);
+	EXPECT_EQ(stats.chunksVisited, 102u);
+	EXPECT_GE(stats.batches, 102u / 4);
+
+	// a visitor returning false keeps the walk out of that chunk's refs
+	std::atomic<size_t> count = 0;
+	walk(store, roots, decoder, [&](const Chunk& c) {
+		++count;
+		return c.hash() == roots[0];
+	});
+	EXPECT_EQ(count, 51u);
+
+	// a later run only walks what is new
+	RefWalker walker(decoder, WalkOptions{ 8, 2 });
+	walker.add(parents[0]);
+	const auto fetch = [&](const HashSet& hashes) { return store->getMany(hashes); };
+	walker.run(fetch, [](const Chunk&) { return true; });
+	EXPECT_EQ(walker.stats().chunksVisited, 3u);
+	walker.add(roots[0]);
+	walker.run(fetch, [](const Chunk&) { return true; });
+	EXPECT_EQ(walker.stats().chunksVisited, 102u);
+	EXPECT_EQ(walker.seen().size(), 102u);
+
+	// a filter prunes addresses before they are fetched
+	RefWalker filtered(decoder, WalkOptions{ 8, 2 });
+	filtered.add(roots[0]);
+	filtered.run(fetch, [](const Chunk&) { return true; }, [&](HashSet& hashes) { hashes.erase(shared); });
+	EXPECT_EQ(filtered.stats().chunksVisited, 101u);
+}
+
+TEST(WalkTest, TestWalkFailsOnMissingChunk) {
+	MemoryStoreFactory factory;
+	auto store = factory.createStore("walk");
+	interface::IRefDecoder decoder = pro::make_proxy<interface::RefDecoder, RefListDecoder>();
+
+	std::vector<Hash> children{ Chunk::FromString("never put").hash(), putNode(store, {}, "leaf") };
+	std::vector<Hash> roots{ putNode(store, children, "root") };
+	EXPECT_THROW(walk(store, roots, decoder, [](const Chunk&) { return true; }), std::runtime_error);
+	EXPECT_THROW(walk(store, roots, decoder, [](const Chunk&) -> bool { throw std::logic_error("visit"); }), std::logic_error);
+	EXPECT_THROW(RefWalker(decoder, WalkOptions{ 0, 1 }), std::invalid_argument);
+}
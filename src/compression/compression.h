@@ -1,3 +1,4 @@
+#pragma once
 #include "common.h"
 #include "proxy.h"
 
@@ -24,6 +25,7 @@ namespace nomp {
 			::add_convention<MemDecompressInplace, size_t(const ByteSlice& src, std::span<std::byte> dest)>
 			::build {
 		};
+		using IDecompresser = pro::proxy<Decompresser>;
 	}
 
 	class LZ4Compresser {
@@ -0,0 +1,42 @@
+#include <benchmark/benchmark.h>
+#include "compression/compression.h"
+#include <random>
+
+using namespace nomp;
+
+// Half random, half runs, so the compressor has something but not everything to find.
+static ByteSlice compressibleData(size_t n) {
+	ByteSlice data(n);
+	std::mt19937 rng(7);
+	auto span = data.span();
+	for (size_t i = 0; i < n; ++i) {
+		span[i] = (i / 64) % 2 == 0 ? std::byte(rng()) : std::byte(i / 64);
+	}
+	return data;
+}
+
+static void BM_LZ4Compress(benchmark::State& state) {
+	LZ4Compresser compresser;
+	const auto data = compressibleData(size_t(state.range(0)));
+	size_t compressed = 0;
+	for (auto _ : state) {
+		auto out = compresser.compress(data);
+		compressed = out.size();
+		benchmark::DoNotOptimize(out);
+	}
+	state.SetBytesProcessed(int64_t(state.iterations()) * state.range(0));
+	state.counters["ratio"] = double(data.size()) / double(compressed);
+}
+BENCHMARK(BM_LZ4Compress)->RangeMultiplier(4)->Range(256, 1 << 20);
+
+static void BM_LZ4Decompress(benchmark::State& state) {
+	LZ4Compresser compresser;
+	LZ4Decompresser decompresser;
+	const auto data = compressibleData(size_t(state.range(0)));
+	const auto compressed = compresser.compress(data);
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(decompresser.decompress(compressed, data.size()));
+	}
+	state.SetBytesProcessed(int64_t(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_LZ4Decompress)->RangeMultiplier(4)->Range(256, 1 << 20);
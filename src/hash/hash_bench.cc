@@ -0,0 +1,43 @@
+#include <benchmark/benchmark.h>
+#include "hash/all.h"
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace nomp;
+
+static std::vector<char> randomBytes(size_t n) {
+	std::mt19937_64 rng(n);
+	std::vector<char> data(n);
+	for (auto& c : data) {
+		c = char(rng());
+	}
+	return data;
+}
+
+static void BM_HashOf(benchmark::State& state) {
+	const auto data = randomBytes(size_t(state.range(0)));
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(Hash::Of(std::span<const char>(data)));
+	}
+	state.SetBytesProcessed(int64_t(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_HashOf)->RangeMultiplier(4)->Range(64, 1 << 20);
+
+static void BM_Encode32(benchmark::State& state) {
+	const auto data = randomBytes(ByteLen);
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(encode32(data));
+	}
+}
+BENCHMARK(BM_Encode32);
+
+static void BM_Decode32(benchmark::State& state) {
+	const auto encoded = encode32(randomBytes(ByteLen));
+	std::vector<char> out(ByteLen);
+	for (auto _ : state) {
+		decode32(encoded, out);
+		benchmark::DoNotOptimize(out.data());
+	}
+}
+BENCHMARK(BM_Decode32);
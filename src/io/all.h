@@ -0,0 +1,4 @@
+#pragma once
+#include "buffer.h"
+#include "file.h"
+#include "io_backend.h"
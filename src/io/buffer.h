@@ -0,0 +1,35 @@
+#pragma once
+
+#include "common.h"
+#include <algorithm>
+#include <span>
+#include <vector>
+
+namespace nomp {
+	// BufferWriter appends everything written to it to a byte vector.
+	class BufferWriter {
+		std::vector<std::byte>& buf;
+	public:
+		explicit BufferWriter(std::vector<std::byte>& buf) : buf(buf) {}
+		int write(std::span<const std::byte> data) {
+			buf.insert(buf.end(), data.begin(), data.end());
+			return (int)data.size();
+		}
+	};
+
+	// SpanReader reads sequentially from a span of bytes.
+	class SpanReader {
+		std::span<const std::byte> data;
+		size_t pos = 0;
+	public:
+		explicit SpanReader(std::span<const std::byte> data) : data(data) {}
+		int read(std::span<std::byte> buf) {
+			auto n = std::min(buf.size(), data.size() - pos);
+			std::copy_n(data.begin() + pos, n, buf.begin());
+			pos += n;
+			return (int)n;
+		}
+		size_t position() const { return pos; }
+		size_t remaining() const { return data.size() - pos; }
+	};
+}
@@ -0,0 +1,233 @@
+#include "file.h"
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <system_error>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace nomp {
+#ifdef _WIN32
+	static std::runtime_error lastError(const std::string& what, const std::string& path) {
+		return std::runtime_error(what + " " + path + ": " + std::system_category().message(GetLastError()));
+	}
+
+	File File::open(const std::string& path, FileMode mode, bool direct) {
+		DWORD access = mode == FileMode::Read ? GENERIC_READ : GENERIC_READ | GENERIC_WRITE;
+		DWORD disposition = mode == FileMode::Read ? OPEN_EXISTING : mode == FileMode::Create ? CREATE_ALWAYS : OPEN_ALWAYS;
+		DWORD flags = FILE_ATTRIBUTE_NORMAL | (direct ? FILE_FLAG_NO_BUFFERING | FILE_FLAG_WRITE_THROUGH : 0);
+		HANDLE h = CreateFileA(path.c_str(), access, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, disposition, flags, nullptr);
+		if (h == INVALID_HANDLE_VALUE) {
+			throw lastError("Failed to open", path);
+		}
+		return File(h, path);
+	}
+
+	void File::reset() noexcept {
+		if (handle != nullptr) {
+			CloseHandle(handle);
+			handle = nullptr;
+		}
+	}
+
+	File::File(File&& other) noexcept : handle(other.handle), filePath(std::move(other.filePath)) {
+		other.handle = nullptr;
+	}
+
+	File& File::operator=(File&& other) noexcept {
+		if (this != &other) {
+			reset();
+			handle = other.handle;
+			filePath = std::move(other.filePath);
+			other.handle = nullptr;
+		}
+		return *this;
+	}
+
+	uint64_t File::size() const {
+		LARGE_INTEGER sz;
+		if (!GetFileSizeEx(handle, &sz)) {
+			throw lastError("Failed to stat", filePath);
+		}
+		return uint64_t(sz.QuadPart);
+	}
+
+	size_t File::readAt(std::span<std::byte> buf, uint64_t offset) const {
+		size_t total = 0;
+		while (total < buf.size()) {
+			OVERLAPPED ov{};
+			ov.Offset = DWORD(offset + total);
+			ov.OffsetHigh = DWORD((offset + total) >> 32);
+			DWORD n = 0;
+			DWORD want = DWORD(std::min<size_t>(buf.size() - total, 1u << 30));
+			if (!ReadFile(handle, buf.data() + total, want, &n, &ov)) {
+				if (GetLastError() == ERROR_HANDLE_EOF) break;
+				throw lastError("Failed to read", filePath);
+			}
+			if (n == 0) break;
+			total += n;
+		}
+		return total;
+	}
+
+	void File::writeAt(std::span<const std::byte> data, uint64_t offset) const {
+		size_t total = 0;
+		while (total < data.size()) {
+			OVERLAPPED ov{};
+			ov.Offset = DWORD(offset + total);
+			ov.OffsetHigh = DWORD((offset + total) >> 32);
+			DWORD n = 0;
+			DWORD want = DWORD(std::min<size_t>(data.size() - total, 1u << 30));
+			if (!WriteFile(handle, data.data() + total, want, &n, &ov)) {
+				throw lastError("Failed to write", filePath);
+			}
+			total += n;
+		}
+	}
+
+	void File::truncate(uint64_t size) const {
+		FILE_END_OF_FILE_INFO info{};
+		info.EndOfFile.QuadPart = LONGLONG(size);
+		if (!SetFileInformationByHandle(handle, FileEndOfFileInfo, &info, sizeof(info))) {
+			throw lastError("Failed to truncate", filePath);
+		}
+	}
+
+	void File::sync() const {
+		if (!FlushFileBuffers(handle)) {
+			throw lastError("Failed to sync", filePath);
+		}
+	}
+
+	void renameDurable(const std::string& from, const std::string& to) {
+		if (!MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+			throw lastError("Failed to rename", from);
+		}
+	}
+
+	void syncDirectory(const std::string& dir) {
+		// NTFS journals directory updates, there is no directory handle to flush
+	}
+#else
+	static std::runtime_error lastError(const std::string& what, const std::string& path) {
+		return std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+	}
+
+	File File::open(const std::string& path, FileMode mode, bool direct) {
+		int flags = mode == FileMode::Read ? O_RDONLY : mode == FileMode::Create ? O_RDWR | O_CREAT | O_TRUNC : O_RDWR | O_CREAT;
+		flags |= O_CLOEXEC;
+#ifdef O_DIRECT
+		if (direct) {
+			flags |= O_DIRECT;
+		}
+#endif
+		int fd = ::open(path.c_str(), flags, 0644);
+		if (fd < 0) {
+			throw lastError("Failed to open", path);
+		}
+		return File(fd, path);
+	}
+
+	void File::reset() noexcept {
+		if (fd >= 0) {
+			::close(fd);
+			fd = -1;
+		}
+	}
+
+	File::File(File&& other) noexcept : fd(other.fd), filePath(std::move(other.filePath)) {
+		other.fd = -1;
+	}
+
+	File& File::operator=(File&& other) noexcept {
+		if (this != &other) {
+			reset();
+			fd = other.fd;
+			filePath = std::move(other.filePath);
+			other.fd = -1;
+		}
+		return *this;
+	}
+
+	uint64_t File::size() const {
+		struct stat st;
+		if (::fstat(fd, &st) != 0) {
+			throw lastError("Failed to stat", filePath);
+		}
+		return uint64_t(st.st_size);
+	}
+
+	size_t File::readAt(std::span<std::byte> buf, uint64_t offset) const {
+		size_t total = 0;
+		while (total < buf.size()) {
+			auto n = ::pread(fd, buf.data() + total, buf.size() - total, off_t(offset + total));
+			if (n < 0) {
+				if (errno == EINTR) continue;
+				throw lastError("Failed to read", filePath);
+			}
+			if (n == 0) break;
+			total += size_t(n);
+		}
+		return total;
+	}
+
+	void File::writeAt(std::span<const std::byte> data, uint64_t offset) const {
+		size_t total = 0;
+		while (total < data.size()) {
+			auto n = ::pwrite(fd, data.data() + total, data.size() - total, off_t(offset + total));
+			if (n < 0) {
+				if (errno == EINTR) continue;
+				throw lastError("Failed to write", filePath);
+			}
+			total += size_t(n);
+		}
+	}
+
+	void File::truncate(uint64_t size) const {
+		if (::ftruncate(fd, off_t(size)) != 0) {
+			throw lastError("Failed to truncate", filePath);
+		}
+	}
+
+	void File::sync() const {
+#if defined(__APPLE__)
+		if (::fcntl(fd, F_FULLFSYNC) != 0) {
+#else
+		if (::fdatasync(fd) != 0) {
+#endif
+			throw lastError("Failed to sync", filePath);
+		}
+	}
+
+	void renameDurable(const std::string& from, const std::string& to) {
+		if (::rename(from.c_str(), to.c_str()) != 0) {
+			throw lastError("Failed to rename", from);
+		}
+		syncDirectory(std::filesystem::path(to).parent_path().string());
+	}
+
+	void syncDirectory(const std::string& dir) {
+		int dfd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (dfd < 0) {
+			throw lastError("Failed to open directory", dir);
+		}
+		int rc = ::fsync(dfd);
+		::close(dfd);
+		if (rc != 0) {
+			throw lastError("Failed to sync directory", dir);
+		}
+	}
+#endif
+
+	File::~File() {
+		reset();
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "common.h"
+#include <cstdint>
+#include <span>
+#include <string>
+
+namespace nomp {
+	enum class FileMode {
+		Read, // open an existing file read-only
+		Create, // create or truncate a file for writing
+		ReadWrite, // open or create a file for reading and writing without truncating it
+	};
+
+	// File is a thin RAII wrapper over a platform file handle that only does
+	// positional I/O, so one File may be shared by concurrent readers.
+	class File {
+#ifdef _WIN32
+		void* handle;
+#else
+		int fd;
+#endif
+		std::string filePath;
+
+	public:
+		// |direct| asks the OS to bypass its page cache (O_DIRECT). Buffers, offsets
+		// and lengths passed to a direct file must then be aligned to DirectIoAlignment.
+		static File open(const std::string& path, FileMode mode, bool direct = false);
+
+		File(const File&) = delete;
+		File& operator=(const File&) = delete;
+		File(File&& other) noexcept;
+		File& operator=(File&& other) noexcept;
+		~File();
+
+		const std::string& path() const { return filePath; }
+#ifndef _WIN32
+		int nativeHandle() const { return fd; }
+#endif
+
+		uint64_t size() const;
+		// Reads until |buf| is full or end of file, returns the number of bytes read.
+		size_t readAt(std::span<std::byte> buf, uint64_t offset) const;
+		void writeAt(std::span<const std::byte> data, uint64_t offset) const;
+		void truncate(uint64_t size) const;
+		void sync() const;
+
+	private:
+#ifdef _WIN32
+		File(void* handle, std::string path) : handle(handle), filePath(std::move(path)) {}
+#else
+		File(int fd, std::string path) : fd(fd), filePath(std::move(path)) {}
+#endif
+		void reset() noexcept;
+	};
+
+	constexpr size_t DirectIoAlignment = 4096;
+
+	// Atomically replaces |to| with |from| and makes the rename durable.
+	void renameDurable(const std::string& from, const std::string& to);
+
+	// Makes the creation, deletion and renaming of entries in |dir| durable.
+	void syncDirectory(const std::string& dir);
+}
@@ -0,0 +1,238 @@
+#include "io_backend.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#ifdef NOMP_WITH_IO_URING
+#include <liburing.h>
+#include <sys/uio.h>
+#endif
+
+namespace nomp {
+	static void checkIoBackend() {
+		pro::make_proxy<interface::IoBackend, PortableIoBackend>();
+	}
+
+#ifdef NOMP_WITH_IO_URING
+	static size_t alignUp(size_t v) {
+		return (v + DirectIoAlignment - 1) & ~(DirectIoAlignment - 1);
+	}
+
+	static std::runtime_error uringError(const std::string& what, int err) {
+		return std::runtime_error(what + ": " + std::strerror(-err));
+	}
+
+	struct AlignedBuffer {
+		std::byte* data;
+		explicit AlignedBuffer(size_t size) :
+			data(static_cast<std::byte*>(std::aligned_alloc(DirectIoAlignment, alignUp(size)))) {
+			if (data == nullptr) {
+				throw std::bad_alloc();
+			}
+		}
+		AlignedBuffer(const AlignedBuffer&) = delete;
+		AlignedBuffer& operator=(const AlignedBuffer&) = delete;
+		~AlignedBuffer() {
+			std::free(data);
+		}
+	};
+
+	// A ring with |queueDepth| buffers of |registeredBufferSize| bytes each, registered
+	// with the kernel when it allows. Registration pins the buffers, which can exceed
+	// RLIMIT_MEMLOCK; the ring then reads into the same buffers unregistered.
+	// Rings are not thread safe, so every batch checks one out of the pool.
+	struct IoUringBackend::RingPool {
+		struct Ring {
+			io_uring ring;
+			AlignedBuffer buffers;
+			bool registered = false;
+			Ring(const IoOptions& options) : buffers(size_t(options.queueDepth) * options.registeredBufferSize) {
+				int rc = io_uring_queue_init(options.queueDepth, &ring, 0);
+				if (rc < 0) {
+					throw uringError("io_uring_queue_init failed", rc);
+				}
+				std::vector<iovec> iovecs(options.queueDepth);
+				for (unsigned i = 0; i < options.queueDepth; ++i) {
+					iovecs[i].iov_base = buffers.data + size_t(i) * options.registeredBufferSize;
+					iovecs[i].iov_len = options.registeredBufferSize;
+				}
+				registered = io_uring_register_buffers(&ring, iovecs.data(), options.queueDepth) == 0;
+			}
+			~Ring() {
+				io_uring_queue_exit(&ring);
+			}
+		};
+
+		IoOptions options;
+		std::mutex mtx;
+		std::vector<std::unique_ptr<Ring>> idle;
+
+		explicit RingPool(const IoOptions& options) : options(options) {}
+
+		std::unique_ptr<Ring> acquire() {
+			{
+				std::lock_guard lock(mtx);
+				if (!idle.empty()) {
+					auto ring = std::move(idle.back());
+					idle.pop_back();
+					return ring;
+				}
+			}
+			return std::make_unique<Ring>(options);
+		}
+
+		void release(std::unique_ptr<Ring> ring) {
+			std::lock_guard lock(mtx);
+			idle.push_back(std::move(ring));
+		}
+
+		// Submits everything queued on |ring| and reaps |count| completions into |results|,
+		// indexed by the sqe user data.
+		static void submitAndReap(io_uring& ring, unsigned count, std::vector<int>& results) {
+			int rc = io_uring_submit_and_wait(&ring, count);
+			if (rc < 0) {
+				throw uringError("io_uring_submit_and_wait failed", rc);
+			}
+			for (unsigned reaped = 0; reaped < count; ++reaped) {
+				io_uring_cqe* cqe;
+				rc = io_uring_wait_cqe(&ring, &cqe);
+				if (rc < 0) {
+					throw uringError("io_uring_wait_cqe failed", rc);
+				}
+				results[reinterpret_cast<uintptr_t>(io_uring_cqe_get_data(cqe))] = cqe->res;
+				io_uring_cqe_seen(&ring, cqe);
+			}
+		}
+	};
+
+	IoUringBackend::IoUringBackend(const IoOptions& options) : pool(std::make_shared<RingPool>(options)) {
+		if (options.queueDepth == 0 || options.registeredBufferSize % DirectIoAlignment != 0) {
+			throw std::invalid_argument("io_uring needs a non-zero queue depth and aligned registered buffers");
+		}
+	}
+
+	bool IoUringBackend::supported() {
+		io_uring ring;
+		if (io_uring_queue_init(1, &ring, 0) < 0) {
+			return false;
+		}
+		io_uring_queue_exit(&ring);
+		return true;
+	}
+
+	File IoUringBackend::openFile(const std::string& path, FileMode mode) {
+		// Only reads bypass the page cache; writes are synced explicitly by callers.
+		return File::open(path, mode, mode == FileMode::Read && pool->options.directIo);
+	}
+
+	void IoUringBackend::readBatch(const File& file, std::span<ReadRequest> requests) {
+		const auto& options = pool->options;
+		const bool direct = options.directIo;
+		auto ring = pool->acquire();
+		std::vector<int> results(options.queueDepth);
+		std::vector<std::unique_ptr<AlignedBuffer>> oversized(options.queueDepth);
+
+		for (size_t start = 0; start < requests.size(); start += options.queueDepth) {
+			const auto batch = requests.subspan(start, std::min<size_t>(options.queueDepth, requests.size() - start));
+			for (unsigned slot = 0; slot < batch.size(); ++slot) {
+				const auto& req = batch[slot];
+				// O_DIRECT reads must cover whole aligned blocks
+				const uint64_t readOffset = direct ? req.offset & ~uint64_t(DirectIoAlignment - 1) : req.offset;
+				const size_t head = size_t(req.offset - readOffset);
+				const size_t readLen = direct ? alignUp(head + req.buf.size()) : req.buf.size();
+
+				io_uring_sqe* sqe = io_uring_get_sqe(&ring->ring);
+				if (readLen <= options.registeredBufferSize) {
+					auto* dst = ring->buffers.data + size_t(slot) * options.registeredBufferSize;
+					if (ring->registered) {
+						io_uring_prep_read_fixed(sqe, file.nativeHandle(), dst, unsigned(readLen), readOffset, int(slot));
+					}
+					else {
+						io_uring_prep_read(sqe, file.nativeHandle(), dst, unsigned(readLen), readOffset);
+					}
+				}
+				else if (direct) {
+					oversized[slot] = std::make_unique<AlignedBuffer>(readLen);
+					io_uring_prep_read(sqe, file.nativeHandle(), oversized[slot]->data, unsigned(readLen), readOffset);
+				}
+				else {
+					io_uring_prep_read(sqe, file.nativeHandle(), req.buf.data(), unsigned(readLen), readOffset);
+				}
+				io_uring_sqe_set_data(sqe, reinterpret_cast<void*>(uintptr_t(slot)));
+			}
+
+			RingPool::submitAndReap(ring->ring, unsigned(batch.size()), results);
+
+			for (unsigned slot = 0; slot < batch.size(); ++slot) {
+				auto& req = batch[slot];
+				if (results[slot] < 0) {
+					pool->release(std::move(ring));
+					throw uringError("Failed to read " + file.path(), results[slot]);
+				}
+				const uint64_t readOffset = direct ? req.offset & ~uint64_t(DirectIoAlignment - 1) : req.offset;
+				const size_t head = size_t(req.offset - readOffset);
+				const size_t got = size_t(results[slot]) > head ? std::min(size_t(results[slot]) - head, req.buf.size()) : 0;
+				const std::byte* src = nullptr;
+				if (oversized[slot]) {
+					src = oversized[slot]->data;
+				}
+				else if ((direct ? alignUp(head + req.buf.size()) : req.buf.size()) <= options.registeredBufferSize) {
+					src = ring->buffers.data + size_t(slot) * options.registeredBufferSize;
+				}
+				if (src != nullptr) {
+					std::memcpy(req.buf.data(), src + head, got);
+				}
+				req.bytesRead = got;
+				oversized[slot].reset();
+			}
+		}
+		pool->release(std::move(ring));
+	}
+
+	void IoUringBackend::writeAt(const File& file, std::span<const std::byte> data, uint64_t offset) {
+		constexpr size_t WriteChunkSize = 1 << 20;
+		const auto& options = pool->options;
+		auto ring = pool->acquire();
+		std::vector<int> results(options.queueDepth);
+		size_t done = 0;
+		while (done < data.size()) {
+			// queue up to queueDepth chunk writes and submit them together
+			unsigned queued = 0;
+			std::vector<size_t> lengths;
+			for (size_t pos = done; pos < data.size() && queued < options.queueDepth; pos += WriteChunkSize, ++queued) {
+				const size_t len = std::min(WriteChunkSize, data.size() - pos);
+				io_uring_sqe* sqe = io_uring_get_sqe(&ring->ring);
+				io_uring_prep_write(sqe, file.nativeHandle(), data.data() + pos, unsigned(len), offset + pos);
+				io_uring_sqe_set_data(sqe, reinterpret_cast<void*>(uintptr_t(queued)));
+				lengths.push_back(len);
+			}
+			RingPool::submitAndReap(ring->ring, queued, results);
+			for (unsigned i = 0; i < queued; ++i) {
+				if (results[i] < 0) {
+					pool->release(std::move(ring));
+					throw uringError("Failed to write " + file.path(), results[i]);
+				}
+				if (size_t(results[i]) != lengths[i]) {
+					// short writes are rare, finish this piece synchronously
+					const size_t pos = done + size_t(i) * WriteChunkSize + size_t(results[i]);
+					file.writeAt(data.subspan(pos, lengths[i] - size_t(results[i])), offset + pos);
+				}
+			}
+			done += std::min(data.size() - done, size_t(queued) * WriteChunkSize);
+		}
+		pool->release(std::move(ring));
+	}
+#endif
+
+	interface::IIoBackend makeIoBackend(const IoOptions& options) {
+#ifdef NOMP_WITH_IO_URING
+		if (options.useIoUring && IoUringBackend::supported()) {
+			return pro::make_proxy<interface::IoBackend, IoUringBackend>(options);
+		}
+#endif
+		return pro::make_proxy<interface::IoBackend, PortableIoBackend>();
+	}
+}
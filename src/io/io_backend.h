@@ -0,0 +1,90 @@
+#pragma once
+
+#include "common.h"
+#include "file.h"
+#include <memory>
+#include <span>
+#include <string>
+
+namespace nomp {
+	struct ReadRequest {
+		uint64_t offset;
+		std::span<std::byte> buf;
+		size_t bytesRead; // filled in by the backend
+	};
+
+	struct IoOptions {
+		// Prefer io_uring when nomp was built with it and the kernel supports it.
+		bool useIoUring = true;
+		// Open table files with O_DIRECT, bypassing the page cache. Only honoured by io_uring.
+		bool directIo = false;
+		// Maximum number of requests in flight per submission.
+		unsigned queueDepth = 128;
+		// Size of each registered buffer; reads larger than this fall back to unregistered buffers.
+		size_t registeredBufferSize = 64 * 1024;
+	};
+
+	namespace interface {
+		PRO_DEF_MEM_DISPATCH(MemOpenFile, openFile);
+		PRO_DEF_MEM_DISPATCH(MemReadBatch, readBatch);
+		PRO_DEF_MEM_DISPATCH(MemWriteAt, writeAt);
+		PRO_DEF_MEM_DISPATCH(MemName, name);
+
+		// IoBackend performs file I/O on behalf of table readers and writers. Copies
+		// share the same underlying resources and are safe to use from many threads.
+		struct IoBackend : pro::facade_builder
+			::support_copy<pro::constraint_level::nontrivial>
+			// Opens |path| with whatever flags this backend needs.
+			::add_convention<MemOpenFile, File(const std::string& path, FileMode mode)>
+			// Performs every read in |requests|, returning once all have completed.
+			::add_convention<MemReadBatch, void(const File& file, std::span<ReadRequest> requests)>
+			// Writes all of |data| at |offset|.
+			::add_convention<MemWriteAt, void(const File& file, std::span<const std::byte> data, uint64_t offset)>
+			::add_convention<MemName, std::string_view()>
+			::build {
+		};
+		using IIoBackend = pro::proxy<IoBackend>;
+	}
+
+	// PortableIoBackend issues one positional read or write syscall per request.
+	class PortableIoBackend {
+	public:
+		File openFile(const std::string& path, FileMode mode) {
+			return File::open(path, mode);
+		}
+		void readBatch(const File& file, std::span<ReadRequest> requests) {
+			for (auto& req : requests) {
+				req.bytesRead = file.readAt(req.buf, req.offset);
+			}
+		}
+		void writeAt(const File& file, std::span<const std::byte> data, uint64_t offset) {
+			file.writeAt(data, offset);
+		}
+		std::string_view name() {
+			return "portable";
+		}
+	};
+
+#ifdef NOMP_WITH_IO_URING
+	// IoUringBackend submits a whole batch of reads with a single io_uring_enter call,
+	// reading into buffers registered with the kernel up front, or into the same
+	// buffers unregistered when the locked memory limit does not allow registering them.
+	class IoUringBackend {
+		struct RingPool;
+		std::shared_ptr<RingPool> pool;
+	public:
+		explicit IoUringBackend(const IoOptions& options);
+		File openFile(const std::string& path, FileMode mode);
+		void readBatch(const File& file, std::span<ReadRequest> requests);
+		void writeAt(const File& file, std::span<const std::byte> data, uint64_t offset);
+		std::string_view name() {
+			return "io_uring";
+		}
+		// Returns false if the running kernel does not support io_uring.
+		static bool supported();
+	};
+#endif
+
+	// Returns the fastest backend available in this build and on this kernel.
+	interface::IIoBackend makeIoBackend(const IoOptions& options = {});
+}
@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+
+#include "io_backend.h"
+#include <filesystem>
+#include <numeric>
+#include <vector>
+
+using namespace nomp;
+
+static std::string tempPath(const std::string& name) {
+	return (std::filesystem::temp_directory_path() / ("nomp_io_" + std::to_string(::testing::UnitTest::GetInstance()->random_seed()) + "_" + name)).string();
+}
+
+static void testBackend(interface::IIoBackend backend, const std::string& name) {
+	const auto path = tempPath(name);
+	std::vector<std::byte> data(300000);
+	for (size_t i = 0; i < data.size(); ++i) {
+		data[i] = std::byte(i * 7 + i / 251);
+	}
+	{
+		auto file = backend->openFile(path, FileMode::Create);
+		backend->writeAt(file, data, 0);
+		file.sync();
+		EXPECT_EQ(file.size(), data.size());
+	}
+
+	auto file = backend->openFile(path, FileMode::Read);
+	std::vector<std::pair<uint64_t, size_t>> ranges = {
+		{ 0, 10 }, { 4095, 2 }, { 12345, 70000 }, { 299990, 10 }, { 299995, 100 }, { 5, 0 }
+	};
+	std::vector<std::vector<std::byte>> bufs;
+	std::vector<ReadRequest> requests;
+	for (const auto& [offset, len] : ranges) {
+		bufs.emplace_back(len);
+	}
+	for (size_t i = 0; i < ranges.size(); ++i) {
+		requests.emplace_back(ReadRequest{ ranges[i].first, bufs[i], 0 });
+	}
+	backend->readBatch(file, requests);
+	for (size_t i = 0; i < ranges.size(); ++i) {
+		const auto [offset, len] = ranges[i];
+		const size_t expected = std::min<size_t>(len, data.size() - offset);
+		ASSERT_EQ(requests[i].bytesRead, expected) << "request " << i;
+		EXPECT_TRUE(std::equal(bufs[i].begin(), bufs[i].begin() + expected, data.begin() + offset)) << "request " << i;
+	}
+	std::filesystem::remove(path);
+}
+
+TEST(IoBackendTest, TestPortableReadBatch) {
+	testBackend(pro::make_proxy<interface::IoBackend, PortableIoBackend>(), "portable");
+}
+
+TEST(IoBackendTest, TestDefaultReadBatch) {
+	testBackend(makeIoBackend(), "default");
+}
+
+#ifdef NOMP_WITH_IO_URING
+TEST(IoBackendTest, TestIoUringDirectReadBatch) {
+	if (!IoUringBackend::supported()) {
+		GTEST_SKIP() << "io_uring not supported by this kernel";
+	}
+	IoOptions options;
+	options.directIo = true;
+	options.queueDepth = 4;
+	testBackend(pro::make_proxy<interface::IoBackend, IoUringBackend>(options), "uring_direct");
+}
+#endif
+
+TEST(FileTest, TestTruncateAndReopen) {
+	const auto path = tempPath("truncate");
+	{
+		auto file = File::open(path, FileMode::Create);
+		std::vector<std::byte> data(100, std::byte{ 1 });
+		file.writeAt(data, 0);
+		file.truncate(40);
+		EXPECT_EQ(file.size(), 40);
+	}
+	{
+		auto file = File::open(path, FileMode::ReadWrite);
+		EXPECT_EQ(file.size(), 40);
+		std::vector<std::byte> buf(100);
+		EXPECT_EQ(file.readAt(buf, 0), 40);
+	}
+	std::filesystem::remove(path);
+	EXPECT_THROW(File::open(path, FileMode::Read), std::runtime_error);
+}
@@ -1,4 +1,12 @@
 #pragma once
 #include "table.h"
 #include "mem_table.h"
-#include "table_writer.h"
\ No newline at end of file
+#include "table_writer.h"
+#include "table_reader.h"
+#include "table_persister.h"
+#include "manifest.h"
+#include "journal.h"
+#include "global_index.h"
+#include "store.h"
+#include "sync.h"
+#include "bulk_load.h"
\ No newline at end of file
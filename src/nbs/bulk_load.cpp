@@ -0,0 +1,293 @@
+#include "bulk_load.h"
+#include "compression/compression.h"
+#include "io/file.h"
+#include <algorithm>
+#include <filesystem>
+#include <format>
+#include <stdexcept>
+
+namespace nomp {
+	namespace {
+		// RunReaderAt serves a finished in-memory run as a table: its records followed
+		// by the index and footer.
+		class RunReaderAt {
+			std::span<const std::byte> records;
+			std::span<const std::byte> tail;
+		public:
+			RunReaderAt(std::span<const std::byte> records, std::span<const std::byte> tail) :
+				records(records), tail(tail) {}
+
+			size_t readAt(std::span<std::byte> buf, uint64_t offset) {
+				size_t n = 0;
+				const uint64_t recordBytes = records.size();
+				if (offset < recordBytes) {
+					const auto want = size_t(std::min<uint64_t>(buf.size(), recordBytes - offset));
+					std::copy_n(records.begin() + offset, want, buf.begin());
+					n = want;
+				}
+				const uint64_t tailOffset = offset + n - recordBytes;
+				if (tailOffset < tail.size()) {
+					const auto rest = std::min<uint64_t>(buf.size() - n, tail.size() - tailOffset);
+					std::copy_n(tail.begin() + tailOffset, rest, buf.begin() + n);
+					n += size_t(rest);
+				}
+				return n;
+			}
+			void readManyAt(std::span<ReadRequest> requests) {
+				for (auto& req : requests) {
+					req.bytesRead = readAt(req.buf, req.offset);
+				}
+			}
+			uint64_t size() const { return records.size() + tail.size(); }
+		};
+	}
+
+	// Run is the table being built.
+	struct BulkLoader::Run {
+		TableIndexWriter index;
+		HashSet seen;
+		std::optional<File> file; // the spilled records, or
+		std::vector<std::byte> memory; // the records without a spill directory
+	};
+
+	BulkLoader::BulkLoader(NomsBlockStore& store, const BulkLoadOptions& options) :
+		store(store), options(options), encodeQueue(options.threads), writeQueue(2 * options.threads)
+	{
+		if (options.tableSize == 0 || options.threads == 0 || options.batchSize == 0) {
+			throw std::invalid_argument("Bulk load table size, threads and batch size must be at least 1");
+		}
+		if (!options.spillDir.empty()) {
+			std::filesystem::create_directories(options.spillDir);
+		}
+		for (size_t i = 0; i < options.threads; ++i) {
+			encoders.emplace_back([this] { guarded([this] { encode(); }); });
+		}
+		writer = std::thread([this] { guarded([this] { write(); }); });
+	}
+
+	BulkLoader::~BulkLoader() {
+		if (!finished) {
+			stop();
+		}
+		if (run && run->file) {
+			const auto path = run->file->path();
+			run->file.reset();
+			std::error_code ec;
+			std::filesystem::remove(path, ec);
+		}
+		if (!added) {
+			discard();
+		}
+	}
+
+	// Removes the tables persisted so far, which no manifest lists and nothing else
+	// would collect. A table can come out identical to one the store already has,
+	// which is left alone.
+	void BulkLoader::discard() noexcept {
+		try {
+			std::vector<Hash> names;
+			for (const auto& t : tables) {
+				names.push_back(t->name());
+			}
+			tables.clear();
+			HashSet listed;
+			for (const auto& spec : store.manifestContents().specs) {
+				listed.insert(spec.name);
+			}
+			for (const auto& name : names) {
+				if (!listed.contains(name)) {
+					store.removeTable(name);
+				}
+			}
+		}
+		catch (...) {
+		}
+	}
+
+	// Runs |f|, and on failure records the first error and shuts the threads down.
+	template <typename F>
+	void BulkLoader::guarded(F&& f) {
+		try {
+			f();
+		}
+		catch (...) {
+			{
+				std::lock_guard lock(mtx);
+				if (!error) {
+					error = std::current_exception();
+				}
+			}
+			encodeQueue.close();
+			writeQueue.close();
+		}
+	}
+
+	void BulkLoader::stop() noexcept {
+		encodeQueue.close();
+		for (auto& t : encoders) {
+			t.join();
+		}
+		encoders.clear();
+		writeQueue.close();
+		if (writer.joinable()) {
+			writer.join();
+		}
+	}
+
+	void BulkLoader::rethrow() {
+		std::lock_guard lock(mtx);
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
+
+	void BulkLoader::add(const Chunk& chunk) {
+		if (finished) {
+			throw std::runtime_error("BulkLoader is finished");
+		}
+		batch.push_back(Pending{ chunk.data(), chunk.hash() });
+		if (batch.size() == options.batchSize) {
+			send();
+		}
+	}
+
+	void BulkLoader::add(const ByteSlice& data) {
+		if (finished) {
+			throw std::runtime_error("BulkLoader is finished");
+		}
+		batch.push_back(Pending{ data, std::nullopt });
+		if (batch.size() == options.batchSize) {
+			send();
+		}
+	}
+
+	void BulkLoader::send() {
+		try {
+			encodeQueue.send(std::move(batch));
+		}
+		catch (...) {
+			rethrow();
+			throw;
+		}
+		batch = {};
+	}
+
+	void BulkLoader::encode() {
+		interface::ICompresser compressor = pro::make_proxy<interface::Compresser, LZ4Compresser>();
+		while (auto pending = encodeQueue.next()) {
+			Encoded encoded;
+			size_t bound = 0;
+			for (const auto& p : *pending) {
+				bound += maxRecordSize(p.data.size());
+			}
+			encoded.records.resize(bound);
+			size_t pos = 0;
+			for (auto& p : *pending) {
+				const auto length = writeChunkRecord(compressor, p.data, std::span{ encoded.records }.subspan(pos));
+				pos += length;
+				encoded.hashes.push_back(p.hash ? std::move(*p.hash) : Hash::Of(p.data));
+				encoded.lengths.push_back(uint32_t(length));
+				encoded.rawLengths.push_back(p.data.size());
+			}
+			encoded.records.resize(pos);
+			writeQueue.send(std::move(encoded));
+		}
+	}
+
+	void BulkLoader::write() {
+		while (auto encoded = writeQueue.next()) {
+			append(*encoded);
+			if (run->index.recordSize() >= options.tableSize) {
+				finishRun();
+			}
+		}
+	}
+
+	void BulkLoader::append(Encoded& encoded) {
+		if (!run) {
+			run = std::make_unique<Run>();
+			if (!options.spillDir.empty()) {
+				const auto path = std::filesystem::path(options.spillDir) / std::format("bulk-{:x}-{}.run", uintptr_t(this), runs++);
+				run->file.emplace(File::open(path.string(), FileMode::Create));
+			}
+		}
+		// drop duplicates by moving the records kept to the front
+		size_t from = 0, to = 0;
+		for (size_t i = 0; i < encoded.hashes.size(); ++i) {
+			const auto length = encoded.lengths[i];
+			if (run->seen.insert(encoded.hashes[i]).second) {
+				std::copy_n(encoded.records.begin() + from, length, encoded.records.begin() + to);
+				to += length;
+				run->index.add(encoded.hashes[i], length, encoded.rawLengths[i]);
+				++result.chunksAdded;
+			}
+			else {
+				++result.duplicates;
+			}
+			from += length;
+		}
+		const std::span<const std::byte> kept(encoded.records.data(), to);
+		if (run->file) {
+			run->file->writeAt(kept, run->index.recordSize() - to);
+		}
+		else {
+			run->memory.insert(run->memory.end(), kept.begin(), kept.end());
+		}
+	}
+
+	void BulkLoader::finishRun() {
+		if (!run) {
+			return;
+		}
+		auto done = std::move(run);
+		const auto spill = done->file ? done->file->path() : std::string();
+		try {
+			if (done->index.count() > 0) {
+				const auto version = done->index.version();
+				std::vector<std::byte> tail(done->index.tailSize(version));
+				const auto name = done->index.writeTail(tail, version);
+				if (done->file) {
+					// the spilled records are the start of the table, so finish it in place
+					done->file->writeAt(tail, done->index.recordSize());
+					done->file->sync();
+					done->file.reset();
+					tables.push_back(store.adoptTable(name, spill));
+				}
+				else {
+					interface::IReaderAt reader = pro::make_proxy<interface::ReaderAt, RunReaderAt>(done->memory, tail);
+					tables.push_back(store.copyTable(name, reader));
+				}
+				++result.tablesWritten;
+				result.bytesWritten += done->index.recordSize() + tail.size();
+			}
+		}
+		catch (...) {
+			if (!spill.empty()) {
+				done->file.reset();
+				std::error_code ec;
+				std::filesystem::remove(spill, ec);
+			}
+			throw;
+		}
+		if (done->file) {
+			done->file.reset();
+			std::filesystem::remove(spill);
+		}
+	}
+
+	BulkLoadResult BulkLoader::finish() {
+		if (finished) {
+			throw std::runtime_error("BulkLoader is finished");
+		}
+		if (!batch.empty()) {
+			send();
+		}
+		finished = true;
+		stop();
+		rethrow();
+		finishRun();
+		store.addTables(tables);
+		added = true;
+		return result;
+	}
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include "common.h"
+#include "channel.h"
+#include "store.h"
+#include "table_writer.h"
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace nomp {
+	struct BulkLoadOptions {
+		uint64_t tableSize = 1 << 30; // record bytes per table
+		size_t threads = 4; // batches hashed and compressed at once
+		size_t batchSize = 1024; // chunks per batch
+		// Where tables are built until they are complete. Empty builds them in memory,
+		// which holds up to tableSize bytes at a time. A directory on the same
+		// filesystem as a FileTablePersister's lets each table be renamed into place
+		// rather than copied.
+		std::string spillDir;
+	};
+
+	struct BulkLoadResult {
+		uint64_t chunksAdded = 0;
+		uint64_t duplicates = 0; // chunks dropped as already in the table being built
+		size_t tablesWritten = 0;
+		uint64_t bytesWritten = 0; // table bytes
+	};
+
+	// BulkLoader writes a stream of chunks straight into a few large tables of a
+	// NomsBlockStore, skipping the memtable. Chunks are hashed and compressed on
+	// several threads; one thread appends the records to the table being built,
+	// spilling it to a file in spillDir, and keeps its index in memory. Once a
+	// table reaches tableSize its index is sorted and written once, and the table is
+	// persisted: a spilled table is handed to the store's persister to adopt, an
+	// in-memory one is copied. finish() adds every table to the manifest at once.
+	//
+	// Chunks are not readable from the store before finish(), and a chunk is only
+	// deduplicated against the table it lands in. add() must be called from one
+	// thread at a time.
+	class BulkLoader {
+		struct Pending {
+			ByteSlice data;
+			std::optional<Hash> hash; // computed while encoding if not known
+		};
+		struct Encoded {
+			std::vector<Hash> hashes;
+			std::vector<uint32_t> lengths; // record bytes
+			std::vector<uint64_t> rawLengths; // chunk bytes
+			std::vector<std::byte> records;
+		};
+		struct Run;
+
+		NomsBlockStore& store;
+		BulkLoadOptions options;
+		std::vector<Pending> batch;
+		Channel<std::vector<Pending>> encodeQueue;
+		Channel<Encoded> writeQueue;
+		std::vector<std::thread> encoders;
+		std::thread writer;
+		std::mutex mtx; // guards error
+		std::exception_ptr error;
+		bool finished = false;
+		bool added = false; // the tables are the store's
+		// written on the writing thread, then by finish()
+		std::unique_ptr<Run> run;
+		uint64_t runs = 0;
+		std::vector<std::shared_ptr<TableReader>> tables;
+		BulkLoadResult result;
+
+		template <typename F>
+		void guarded(F&& f);
+		void encode();
+		void write();
+		void append(Encoded& encoded);
+		void finishRun();
+		void send();
+		void stop() noexcept;
+		void rethrow();
+		void discard() noexcept;
+
+	public:
+		explicit BulkLoader(NomsBlockStore& store, const BulkLoadOptions& options = {});
+		BulkLoader(const BulkLoader&) = delete;
+		BulkLoader& operator=(const BulkLoader&) = delete;
+		// Abandons the load if finish() was not called or failed, removing what it
+		// spilled and the tables it persisted.
+		~BulkLoader();
+
+		void add(const Chunk& chunk);
+		// Adds a chunk of |data|, hashed on the encoding threads.
+		void add(const ByteSlice& data);
+		// Writes the last table and adds the tables to the store's manifest. The
+		// store's root is left alone.
+		BulkLoadResult finish();
+	};
+}
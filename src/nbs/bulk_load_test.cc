@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+
+#include "bulk_load.h"
+#include "test_util.h"
+#include <filesystem>
+#include <string>
+#include <vector>
+
+using namespace nomp;
+
+namespace {
+	ByteSlice payload(size_t i) {
+		auto s = "chunk " + std::to_string(i);
+		s.resize(100 + i % 300, char('a' + i % 26));
+		return ByteSlice(s);
+	}
+}
+
+TEST(BulkLoadTest, TestBulkLoadWritesLargeTables) {
+	const auto dir = test::tempDir("nomp_bulk");
+	MemoryManifest manifest;
+	FileTablePersister persister(dir + "/tables");
+	NomsBlockStore store(pro::make_proxy<interface::Manifest, MemoryManifest>(manifest),
+		pro::make_proxy<interface::TablePersister, FileTablePersister>(persister));
+
+	BulkLoadOptions options;
+	options.tableSize = 64 << 10;
+	options.threads = 3;
+	options.batchSize = 50;
+	options.spillDir = dir + "/spill";
+	BulkLoader loader(store, options);
+	std::vector<Hash> hashes;
+	for (size_t i = 0; i < 3000; ++i) {
+		const auto data = payload(i);
+		if (i % 2 == 0) {
+			loader.add(data);
+		}
+		else {
+			loader.add(Chunk(data, Hash::Of(data)));
+		}
+		hashes.push_back(Hash::Of(data));
+	}
+	// a repeat within the table being built is dropped
+	loader.add(payload(2999));
+	const auto result = loader.finish();
+	EXPECT_EQ(result.chunksAdded, 3000u);
+	EXPECT_EQ(result.duplicates, 1u);
+	EXPECT_GT(result.tablesWritten, 1u);
+	EXPECT_EQ(store.manifestContents().specs.size(), result.tablesWritten);
+	EXPECT_TRUE(std::filesystem::is_empty(options.spillDir));
+	// spilled tables were renamed into place, nothing else is left among them
+	EXPECT_EQ(size_t(std::distance(std::filesystem::directory_iterator(dir + "/tables"), {})), result.tablesWritten);
+
+	for (size_t i = 0; i < hashes.size(); ++i) {
+		auto chunk = store.get(hashes[i]);
+		ASSERT_TRUE(chunk.has_value());
+		EXPECT_EQ(chunk->data(), payload(i));
+	}
+	// the tables are the store's from now on
+	ASSERT_TRUE(store.commit(hashes[0], store.root()));
+	NomsBlockStore reopened(pro::make_proxy<interface::Manifest, MemoryManifest>(manifest),
+		pro::make_proxy<interface::TablePersister, FileTablePersister>(persister));
+	EXPECT_TRUE(reopened.has(hashes.back()));
+	std::filesystem::remove_all(dir);
+}
+
+TEST(BulkLoadTest, TestBulkLoadInMemory) {
+	MemoryManifest manifest;
+	MemoryTablePersister persister;
+	NomsBlockStore store(pro::make_proxy<interface::Manifest, MemoryManifest>(manifest),
+		pro::make_proxy<interface::TablePersister, MemoryTablePersister>(persister));
+	{
+		// an abandoned load adds nothing
+		BulkLoader loader(store);
+		loader.add(payload(1));
+	}
+	EXPECT_FALSE(manifest.fetch().has_value());
+
+	BulkLoader loader(store, BulkLoadOptions{ 1 << 20, 2, 7 });
+	for (size_t i = 0; i < 100; ++i) {
+		loader.add(payload(i));
+	}
+	const auto result = loader.finish();
+	EXPECT_EQ(result.tablesWritten, 1u);
+	EXPECT_TRUE(store.has(Hash::Of(payload(42))));
+	EXPECT_THROW(loader.add(payload(1)), std::runtime_error);
+}
+
+TEST(BulkLoadTest, TestBulkLoadRemovesTablesItDoesNotAdd) {
+	const auto dir = test::tempDir("nomp_bulk_abandoned");
+	MemoryManifest manifest;
+	FileTablePersister persister(dir);
+	NomsBlockStore store(pro::make_proxy<interface::Manifest, MemoryManifest>(manifest),
+		pro::make_proxy<interface::TablePersister, FileTablePersister>(persister));
+	BulkLoadOptions options;
+	options.tableSize = 4 << 10;
+	options.batchSize = 50;
+	options.spillDir = dir;
+	auto load = [&](BulkLoader& loader) {
+		for (size_t i = 0; i < 1000; ++i) {
+			loader.add(payload(i));
+		}
+	};
+
+	// tables already persisted when the load is abandoned are removed with it
+	{
+		BulkLoader loader(store, options);
+		load(loader);
+	}
+	EXPECT_TRUE(std::filesystem::is_empty(dir));
+
+	// and so are those of a finish() that fails to add them
+	{
+		BulkLoader loader(store, options);
+		load(loader);
+		store.close();
+		EXPECT_THROW(loader.finish(), std::runtime_error);
+	}
+	EXPECT_TRUE(std::filesystem::is_empty(dir));
+	std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,99 @@
+#include "elias_fano.h"
+#include <bit>
+#include <stdexcept>
+
+namespace nomp {
+	EliasFano::EliasFano(std::span<const uint64_t> values) : count(values.size()) {
+		if (values.empty()) {
+			return;
+		}
+		const uint64_t universe = values.back();
+		if (universe > count) {
+			lowBits = unsigned(std::bit_width(universe / count) - 1);
+		}
+		low.assign((count * lowBits + 63) / 64 + 1, 0);
+		high.assign((count + (universe >> lowBits) + 1 + 63) / 64, 0);
+		samples.reserve(count / SampleRate + 1);
+		const uint64_t mask = lowBits == 0 ? 0 : ~0ULL >> (64 - lowBits);
+		uint64_t last = 0;
+		for (size_t i = 0; i < count; ++i) {
+			const auto v = values[i];
+			if (v < last) {
+				throw std::invalid_argument("EliasFano values must not decrease");
+			}
+			last = v;
+			const uint64_t pos = (v >> lowBits) + i;
+			high[pos / 64] |= 1ULL << (pos % 64);
+			if (i % SampleRate == 0) {
+				samples.push_back(pos);
+			}
+			if (lowBits > 0) {
+				const uint64_t bit = uint64_t(i) * lowBits;
+				low[bit / 64] |= (v & mask) << (bit % 64);
+				if (bit % 64 + lowBits > 64) {
+					low[bit / 64 + 1] |= (v & mask) >> (64 - bit % 64);
+				}
+			}
+		}
+	}
+
+	uint64_t EliasFano::lowAt(size_t i) const {
+		if (lowBits == 0) {
+			return 0;
+		}
+		const uint64_t bit = uint64_t(i) * lowBits;
+		uint64_t v = low[bit / 64] >> (bit % 64);
+		if (bit % 64 + lowBits > 64) {
+			v |= low[bit / 64 + 1] << (64 - bit % 64);
+		}
+		return v & (~0ULL >> (64 - lowBits));
+	}
+
+	// Returns the position of the i-th set bit of |high|.
+	uint64_t EliasFano::select(size_t i) const {
+		const uint64_t pos = samples[i / SampleRate];
+		size_t k = i % SampleRate;
+		size_t word = pos / 64;
+		uint64_t w = high[word] & (~0ULL << (pos % 64));
+		while (true) {
+			const auto ones = size_t(std::popcount(w));
+			if (k < ones) {
+				break;
+			}
+			k -= ones;
+			w = high[++word];
+		}
+		for (; k > 0; --k) {
+			w &= w - 1; // drop the lowest set bit
+		}
+		return word * 64 + std::countr_zero(w);
+	}
+
+	// Returns the position of the first set bit after |pos|.
+	uint64_t EliasFano::nextSetBit(uint64_t pos) const {
+		++pos;
+		size_t word = pos / 64;
+		uint64_t w = high[word] & (~0ULL << (pos % 64));
+		while (w == 0) {
+			w = high[++word];
+		}
+		return word * 64 + std::countr_zero(w);
+	}
+
+	uint64_t EliasFano::operator[](size_t i) const {
+		return ((select(i) - i) << lowBits) | lowAt(i);
+	}
+
+	std::pair<uint64_t, uint64_t> EliasFano::pair(size_t i) const {
+		const auto pos = select(i);
+		const auto next = nextSetBit(pos);
+		return {
+			((pos - i) << lowBits) | lowAt(i),
+			((next - i - 1) << lowBits) | lowAt(i + 1)
+		};
+	}
+
+	size_t EliasFano::memoryUsage() const {
+		return (low.capacity() + high.capacity() + samples.capacity()) * sizeof(uint64_t);
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "common.h"
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace nomp {
+	// EliasFano stores a non-decreasing sequence of n integers below U in about
+	// 2 + log2(U / n) bits each, with constant time random access. Each value is split
+	// into low bits, stored verbatim, and high bits, stored as a unary coded bitmap.
+	class EliasFano {
+		static constexpr size_t SampleRate = 256; // one select sample per this many values
+
+		size_t count = 0;
+		unsigned lowBits = 0;
+		std::vector<uint64_t> low; // count * lowBits bits, plus a padding word
+		std::vector<uint64_t> high; // bit (v >> lowBits) + i is set for the i-th value v
+		std::vector<uint64_t> samples; // position in |high| of every SampleRate-th value
+
+		uint64_t lowAt(size_t i) const;
+		uint64_t select(size_t i) const;
+		uint64_t nextSetBit(uint64_t pos) const;
+	public:
+		EliasFano() = default;
+		explicit EliasFano(std::span<const uint64_t> values);
+
+		size_t size() const { return count; }
+		uint64_t operator[](size_t i) const;
+		// Returns values i and i + 1, cheaper than two lookups.
+		std::pair<uint64_t, uint64_t> pair(size_t i) const;
+		// Returns the number of bytes held by this sequence.
+		size_t memoryUsage() const;
+	};
+}
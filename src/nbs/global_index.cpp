@@ -0,0 +1,178 @@
+#include "global_index.h"
+#include "binary/all.h"
+#include "io/file.h"
+#include "table_writer.h"
+#include <algorithm>
+#include <filesystem>
+
+namespace nomp {
+	/*
+		Global index file:
+			Magic // 8 bytes
+			Table count // 4 bytes
+			Table names // 20 bytes each
+			Entry count // 8 bytes
+			Prefixes // 8 bytes each, sorted
+			Table ids // 4 bytes each
+			Ordinals // 4 bytes each
+			Checksum // 4 bytes, crc32 of everything before it
+	*/
+	constexpr uint64_t GlobalIndexMagic = 0xFFB5D8C22463EE60;
+	constexpr size_t GlobalIndexEntrySize = PrefixSize + Uint32Size + OrdinalSize;
+
+	std::shared_ptr<const GlobalIndex> GlobalIndex::update(const std::shared_ptr<const GlobalIndex>& base,
+		std::span<const std::shared_ptr<TableReader>> readers)
+	{
+		size_t kept = 0;
+		if (base && base->names.size() <= readers.size() &&
+			std::equal(base->names.begin(), base->names.end(), readers.begin(),
+				[](const Hash& name, const std::shared_ptr<TableReader>& r) { return name == r->name(); }))
+		{
+			kept = base->names.size();
+			if (kept == readers.size()) {
+				return base;
+			}
+		}
+
+		// gather the new tables' entries and sort them, as a table writer sorts its prefixes
+		std::vector<Location> added;
+		std::vector<PrefixTuple> tuples;
+		for (size_t t = kept; t < readers.size(); ++t) {
+			const auto& index = readers[t]->tableIndex();
+			for (uint32_t i = 0; i < index.count(); ++i) {
+				if (added.size() == UINT32_MAX) {
+					throw std::runtime_error("Too many chunks added to the global index at once");
+				}
+				tuples.push_back(PrefixTuple{ index.prefixes[i], uint32_t(added.size()) });
+				added.push_back(Location{ uint32_t(t), index.ordinals[i] });
+			}
+		}
+		std::vector<PrefixTuple> scratch;
+		sortPrefixTuples(tuples, scratch);
+
+		auto result = std::make_shared<GlobalIndex>();
+		for (const auto& r : readers) {
+			result->names.push_back(r->name());
+		}
+		const size_t baseSize = kept > 0 ? base->size() : 0;
+		const size_t total = baseSize + tuples.size();
+		result->prefixes.reserve(total);
+		result->tables.reserve(total);
+		result->ordinals.reserve(total);
+		size_t i = 0, j = 0;
+		while (i < baseSize || j < tuples.size()) {
+			if (j == tuples.size() || (i < baseSize && base->prefixes[i] <= tuples[j].prefix)) {
+				result->prefixes.push_back(base->prefixes[i]);
+				result->tables.push_back(base->tables[i]);
+				result->ordinals.push_back(base->ordinals[i]);
+				++i;
+			}
+			else {
+				const auto& loc = added[tuples[j].ordinal];
+				result->prefixes.push_back(tuples[j].prefix);
+				result->tables.push_back(loc.table);
+				result->ordinals.push_back(loc.ordinal);
+				++j;
+			}
+		}
+		return result;
+	}
+
+	std::pair<size_t, size_t> GlobalIndex::range(uint64_t prefix) const {
+		auto [lo, hi] = std::equal_range(prefixes.begin(), prefixes.end(), prefix);
+		return { size_t(lo - prefixes.begin()), size_t(hi - prefixes.begin()) };
+	}
+
+	std::optional<GlobalIndex::Location> GlobalIndex::locate(const Hash& h, std::span<const std::shared_ptr<TableReader>> readers) const {
+		const auto [begin, end] = range(h.prefix());
+		for (size_t i = begin; i < end; ++i) {
+			const auto loc = at(i);
+			if (readers[loc.table]->hasAt(loc.ordinal, h)) {
+				return loc;
+			}
+		}
+		return std::nullopt;
+	}
+
+	size_t GlobalIndex::memoryUsage() const {
+		return names.capacity() * sizeof(Hash) + prefixes.capacity() * sizeof(uint64_t) +
+			tables.capacity() * sizeof(uint32_t) + ordinals.capacity() * sizeof(uint32_t);
+	}
+
+	void GlobalIndex::save(const std::string& path) const {
+		const size_t n = prefixes.size();
+		std::vector<std::byte> buf(MagicNumberSize + Uint32Size + names.size() * AddrSize + Uint64Size +
+			n * GlobalIndexEntrySize + CheckSumSize);
+		std::byte* p = buf.data();
+		BigEndian::storeUint64(p, GlobalIndexMagic);
+		p += MagicNumberSize;
+		BigEndian::storeUint32(p, uint32_t(names.size()));
+		p += Uint32Size;
+		for (const auto& name : names) {
+			const std::span<const std::byte> bytes(name);
+			p = std::copy(bytes.begin(), bytes.end(), p);
+		}
+		BigEndian::storeUint64(p, n);
+		p += Uint64Size;
+		BigEndian::writeUint64s({ p, n * PrefixSize }, prefixes);
+		p += n * PrefixSize;
+		BigEndian::writeUint32s({ p, n * Uint32Size }, tables);
+		p += n * Uint32Size;
+		BigEndian::writeUint32s({ p, n * OrdinalSize }, ordinals);
+		p += n * OrdinalSize;
+		BigEndian::storeUint32(p, crc32(buf.data(), size_t(p - buf.data())));
+
+		const auto tmpPath = path + ".tmp";
+		{
+			auto file = File::open(tmpPath, FileMode::Create);
+			file.writeAt(buf, 0);
+			file.sync();
+		}
+		renameDurable(tmpPath, path);
+	}
+
+	std::shared_ptr<const GlobalIndex> GlobalIndex::load(const std::string& path) {
+		if (!std::filesystem::exists(path)) {
+			return nullptr;
+		}
+		auto file = File::open(path, FileMode::Read);
+		std::vector<std::byte> buf(file.size());
+		if (file.readAt(buf, 0) != buf.size() || buf.size() < MagicNumberSize + Uint32Size + Uint64Size + CheckSumSize) {
+			return nullptr;
+		}
+		const std::byte* p = buf.data();
+		const size_t body = buf.size() - CheckSumSize;
+		if (BigEndian::loadUint64(p) != GlobalIndexMagic || crc32(p, body) != BigEndian::loadUint32(p + body)) {
+			return nullptr;
+		}
+		p += MagicNumberSize;
+		const uint64_t tableCount = BigEndian::loadUint32(p);
+		p += Uint32Size;
+		if (tableCount * AddrSize + Uint64Size > body - size_t(p - buf.data())) {
+			return nullptr;
+		}
+		auto index = std::make_shared<GlobalIndex>();
+		index->names.resize(tableCount);
+		for (auto& name : index->names) {
+			std::copy(p, p + AddrSize, std::span<std::byte>(name).begin());
+			p += AddrSize;
+		}
+		const uint64_t n = BigEndian::loadUint64(p);
+		p += Uint64Size;
+		if (n > (body - size_t(p - buf.data())) / GlobalIndexEntrySize || n * GlobalIndexEntrySize != body - size_t(p - buf.data())) {
+			return nullptr;
+		}
+		index->prefixes.resize(n);
+		index->tables.resize(n);
+		index->ordinals.resize(n);
+		BigEndian::readUint64s({ p, n * PrefixSize }, index->prefixes);
+		p += n * PrefixSize;
+		BigEndian::readUint32s({ p, n * Uint32Size }, index->tables);
+		p += n * Uint32Size;
+		BigEndian::readUint32s({ p, n * OrdinalSize }, index->ordinals);
+		if (std::any_of(index->tables.begin(), index->tables.end(), [&](uint32_t t) { return t >= tableCount; })) {
+			return nullptr;
+		}
+		return index;
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "common.h"
+#include "table_reader.h"
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace nomp {
+	// GlobalIndex maps chunk prefixes to the table and ordinal holding them, for every
+	// table of a store at once, so a lookup is one binary search instead of one per
+	// table. Like a table index it only keeps prefixes: the table's own suffixes
+	// confirm a match.
+	//
+	// A GlobalIndex is immutable. Table ids are positions in tableNames(), which
+	// follows the order of the manifest's table specs.
+	class GlobalIndex {
+		std::vector<Hash> names;
+		std::vector<uint64_t> prefixes; // sorted
+		std::vector<uint32_t> tables; // parallel to prefixes
+		std::vector<uint32_t> ordinals; // parallel to prefixes
+
+	public:
+		struct Location {
+			uint32_t table;
+			uint32_t ordinal;
+		};
+
+		GlobalIndex() = default;
+
+		// Returns an index over |readers|. When the tables of |base| are a prefix of
+		// |readers|, as after a commit appends tables, only the new tables are sorted and
+		// merged in. Otherwise, as after tables were compacted away, it is rebuilt.
+		static std::shared_ptr<const GlobalIndex> update(const std::shared_ptr<const GlobalIndex>& base,
+			std::span<const std::shared_ptr<TableReader>> readers);
+
+		const std::vector<Hash>& tableNames() const { return names; }
+		size_t size() const { return prefixes.size(); }
+
+		// Returns the [begin, end) positions of the entries with |prefix|.
+		std::pair<size_t, size_t> range(uint64_t prefix) const;
+		Location at(size_t i) const { return Location{ tables[i], ordinals[i] }; }
+
+		// Returns the location of |h| in |readers|, the tables this index was built over.
+		std::optional<Location> locate(const Hash& h, std::span<const std::shared_ptr<TableReader>> readers) const;
+
+		// Returns the number of bytes this index holds in memory.
+		size_t memoryUsage() const;
+
+		// Durably writes the index to |path|.
+		void save(const std::string& path) const;
+		// Reads an index written by save(), or returns nullptr if |path| does not exist or
+		// does not hold a valid index.
+		static std::shared_ptr<const GlobalIndex> load(const std::string& path);
+	};
+}
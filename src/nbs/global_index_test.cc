@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+
+#include "global_index.h"
+#include "table_writer.h"
+#include "store.h"
+#include "test_util.h"
+#include <filesystem>
+#include <string>
+#include <vector>
+
+using namespace nomp;
+
+static std::shared_ptr<TableReader> openTable(const std::vector<Chunk>& chunks) {
+	uint64_t totalData = 0;
+	for (const auto& c : chunks) {
+		totalData += c.size();
+	}
+	TableWriter tw(chunks.size(), totalData);
+	for (const auto& c : chunks) {
+		tw.addChunk(c.hash(), c.data());
+	}
+	auto [name, data] = tw.finish();
+	return std::make_shared<TableReader>(name, pro::make_proxy<interface::ReaderAt, ByteSliceReaderAt>(data));
+}
+
+TEST(GlobalIndexTest, TestIncrementalUpdate) {
+	std::vector<std::vector<Chunk>> chunks{ test::makeChunks(300, 32), test::makeChunks(50, 32, 300), test::makeChunks(400, 32, 350) };
+	std::vector<std::shared_ptr<TableReader>> readers;
+	for (const auto& cs : chunks) {
+		readers.push_back(openTable(cs));
+	}
+
+	auto first = GlobalIndex::update(nullptr, std::span{ readers }.first(1));
+	auto merged = GlobalIndex::update(first, readers);
+	auto rebuilt = GlobalIndex::update(nullptr, readers);
+	EXPECT_EQ(GlobalIndex::update(merged, readers), merged);
+	ASSERT_EQ(merged->size(), 750u);
+	ASSERT_EQ(merged->tableNames(), rebuilt->tableNames());
+	for (size_t t = 0; t < chunks.size(); ++t) {
+		for (const auto& c : chunks[t]) {
+			auto loc = merged->locate(c.hash(), readers);
+			ASSERT_TRUE(loc.has_value());
+			EXPECT_EQ(loc->table, t);
+			EXPECT_TRUE(readers[t]->hasAt(loc->ordinal, c.hash()));
+			EXPECT_EQ(rebuilt->locate(c.hash(), readers)->ordinal, loc->ordinal);
+		}
+	}
+	EXPECT_FALSE(merged->locate(Chunk::FromString("absent").hash(), readers).has_value());
+
+	// dropping a table, as compaction would, rebuilds the index with new table ids
+	std::vector<std::shared_ptr<TableReader>> compacted{ readers[0], readers[2] };
+	auto after = GlobalIndex::update(merged, compacted);
+	EXPECT_EQ(after->size(), 700u);
+	EXPECT_EQ(after->locate(chunks[2][0].hash(), compacted)->table, 1u);
+	EXPECT_FALSE(after->locate(chunks[1][0].hash(), compacted).has_value());
+}
+
+TEST(GlobalIndexTest, TestTableSetReportsMissingRecords) {
+	std::vector<std::shared_ptr<TableReader>> readers{ openTable(test::makeChunks(100, 32)), openTable(test::makeChunks(100, 32, 100)) };
+	const auto present = test::makeChunks(1, 32, 150)[0];
+	const auto missing = Chunk::FromString("absent");
+	for (bool indexed : { true, false }) {
+		TableSet tables{ {}, {}, readers, indexed ? GlobalIndex::update(nullptr, readers) : nullptr };
+		std::vector<getRecord> records{ { present.hash(), ByteSlice(), present.hash().prefix(), false } };
+		std::span<getRecord> span{ records };
+		EXPECT_FALSE(tables.getMany(span)) << indexed;
+		EXPECT_TRUE(records[0].found);
+		EXPECT_EQ(Chunk(records[0].data, present.hash()), present);
+
+		records.push_back({ missing.hash(), ByteSlice(), missing.hash().prefix(), false });
+		records[0].found = false;
+		span = records;
+		EXPECT_TRUE(tables.getMany(span)) << indexed;
+		EXPECT_TRUE(records[0].found);
+		EXPECT_FALSE(records[1].found);
+	}
+}
+
+TEST(GlobalIndexTest, TestSaveAndLoad) {
+	auto path = test::tempPath("nomp_global_index");
+	std::vector<std::shared_ptr<TableReader>> readers{ openTable(test::makeChunks(100, 32)), openTable(test::makeChunks(100, 32, 100)) };
+	auto index = GlobalIndex::update(nullptr, readers);
+	index->save(path);
+
+	auto loaded = GlobalIndex::load(path);
+	ASSERT_NE(loaded, nullptr);
+	EXPECT_EQ(loaded->tableNames(), index->tableNames());
+	ASSERT_EQ(loaded->size(), index->size());
+	for (size_t i = 0; i < index->size(); ++i) {
+		EXPECT_EQ(loaded->at(i).table, index->at(i).table);
+		EXPECT_EQ(loaded->at(i).ordinal, index->at(i).ordinal);
+	}
+
+	// a damaged file is ignored rather than trusted
+	{
+		auto file = File::open(path, FileMode::ReadWrite);
+		std::byte b{ 0x5a };
+		file.writeAt(std::span{ &b, 1 }, 20);
+	}
+	EXPECT_EQ(GlobalIndex::load(path), nullptr);
+	std::filesystem::remove(path);
+	EXPECT_EQ(GlobalIndex::load(path), nullptr);
+}
+
+TEST(GlobalIndexTest, TestStoreReopensWithSavedIndex) {
+	auto path = test::tempPath("nomp_store_global_index");
+	std::filesystem::remove(path);
+	MemoryManifest manifest;
+	MemoryTablePersister persister;
+	NbsOptions options{ 2048, 2 };
+	options.globalIndex = true;
+	options.globalIndexFile = path;
+	auto chunks = test::makeChunks(400, 32);
+	{
+		NomsBlockStore store(pro::make_proxy<interface::Manifest, MemoryManifest>(manifest),
+			pro::make_proxy<interface::TablePersister, MemoryTablePersister>(persister), options);
+		for (size_t i = 0; i < chunks.size(); ++i) {
+			store.put(chunks[i]);
+			if (i % 100 == 99) {
+				EXPECT_TRUE(store.commit(chunks[i].hash(), store.root()));
+			}
+		}
+	}
+	auto saved = GlobalIndex::load(path);
+	ASSERT_NE(saved, nullptr);
+	EXPECT_EQ(saved->tableNames().size(), manifest.fetch()->specs.size());
+	EXPECT_EQ(saved->size(), chunks.size());
+
+	NomsBlockStore reopened(pro::make_proxy<interface::Manifest, MemoryManifest>(manifest),
+		pro::make_proxy<interface::TablePersister, MemoryTablePersister>(persister), options);
+	HashSet hashes;
+	for (const auto& c : chunks) {
+		EXPECT_TRUE(reopened.has(c.hash()));
+		EXPECT_EQ(reopened.get(c.hash()).value(), c);
+		hashes.insert(c.hash());
+	}
+	EXPECT_EQ(reopened.getMany(hashes).size(), chunks.size());
+	EXPECT_FALSE(reopened.has(Chunk::FromString("absent").hash()));
+	reopened.close();
+	std::filesystem::remove(path);
+}
@@ -0,0 +1,230 @@
+#include "journal.h"
+#include "binary/all.h"
+#include "io/buffer.h"
+#include "table.h"
+#include <algorithm>
+#include <filesystem>
+
+namespace nomp {
+	/*
+		Journal segment:
+			Record 0
+			 ..
+			Record N
+
+		Record:
+			Type // 1 byte
+			Payload
+			Checksum // 4 bytes, crc32 of type and payload
+
+		Payload:
+			Chunk // Chunk::serialize: hash, length, data
+			Root // 20 bytes
+	*/
+	constexpr uint8_t JournalChunkRecord = 1;
+	constexpr uint8_t JournalRootRecord = 2;
+	constexpr size_t JournalChunkHeaderSize = ByteLen + Uint32Size;
+	const std::string JournalSegmentPrefix = "journal.";
+
+	static void checkJournal() {
+		std::vector<std::byte> buf;
+		pro::make_proxy<interface::Writer, BufferWriter>(buf);
+		pro::make_proxy<interface::Reader, SpanReader>(std::span<const std::byte>());
+	}
+
+	ChunkJournal::ChunkJournal(const std::string& dir) : dir(dir) {
+		std::filesystem::create_directories(dir);
+	}
+
+	std::string ChunkJournal::segmentPath(uint64_t id) const {
+		return (std::filesystem::path(dir) / (JournalSegmentPrefix + std::to_string(id))).string();
+	}
+
+	std::vector<uint64_t> ChunkJournal::listSegments() const {
+		std::vector<uint64_t> ids;
+		for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+			const auto name = entry.path().filename().string();
+			if (!name.starts_with(JournalSegmentPrefix)) {
+				continue;
+			}
+			const auto suffix = name.substr(JournalSegmentPrefix.size());
+			if (suffix.empty() || !std::all_of(suffix.begin(), suffix.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+				continue;
+			}
+			ids.push_back(std::stoull(suffix));
+		}
+		std::sort(ids.begin(), ids.end());
+		return ids;
+	}
+
+	void ChunkJournal::openSegment(uint64_t id) {
+		segment = std::make_unique<File>(File::open(segmentPath(id), FileMode::Create));
+		syncDirectory(dir);
+		segmentId = id;
+		segmentSize = 0;
+	}
+
+	// Parses the records of one segment, returns the length of its valid prefix.
+	static size_t parseSegment(std::span<const std::byte> data, ChunkJournal::ReplayedSegment& out) {
+		size_t pos = 0;
+		while (pos < data.size()) {
+			const auto rest = data.subspan(pos);
+			const auto type = uint8_t(rest[0]);
+			size_t payloadSize;
+			if (type == JournalChunkRecord) {
+				if (rest.size() < 1 + JournalChunkHeaderSize) break;
+				payloadSize = JournalChunkHeaderSize + BigEndian::uint32(rest.subspan(1 + ByteLen, Uint32Size));
+			}
+			else if (type == JournalRootRecord) {
+				payloadSize = ByteLen;
+			}
+			else {
+				break;
+			}
+			const size_t recordSize = 1 + payloadSize + Uint32Size;
+			if (rest.size() < recordSize) break;
+			if (crc32(rest.first(1 + payloadSize)) != BigEndian::uint32(rest.subspan(1 + payloadSize, Uint32Size))) break;
+
+			const auto payload = rest.subspan(1, payloadSize);
+			if (type == JournalChunkRecord) {
+				SpanReader reader(payload);
+				auto chunk = Chunk::deserialize(interface::IReader(&reader));
+				out.chunks.push_back(std::move(chunk.value()));
+			}
+			else {
+				Hash root;
+				std::copy(payload.begin(), payload.end(), std::span<std::byte>(root).begin());
+				out.root = root;
+			}
+			pos += recordSize;
+		}
+		return pos;
+	}
+
+	std::vector<ChunkJournal::ReplayedSegment> ChunkJournal::replay() {
+		std::lock_guard lock(mtx);
+		if (segment) {
+			throw std::logic_error("ChunkJournal::replay must be called before appending");
+		}
+		std::vector<ReplayedSegment> segments;
+		uint64_t lastId = 0;
+		for (auto id : listSegments()) {
+			auto file = File::open(segmentPath(id), FileMode::ReadWrite);
+			std::vector<std::byte> data(file.size());
+			data.resize(file.readAt(data, 0));
+			ReplayedSegment seg{ id, {}, std::nullopt };
+			const auto valid = parseSegment(data, seg);
+			if (valid < data.size()) {
+				// a crash interrupted the last write, drop the torn tail
+				file.truncate(valid);
+				file.sync();
+			}
+			segments.push_back(std::move(seg));
+			lastId = id;
+		}
+		openSegment(lastId + 1);
+		return segments;
+	}
+
+	// Appends the checksum of the record that starts at |start| in the pending buffer.
+	void ChunkJournal::sealRecord(size_t start) {
+		std::byte crc[Uint32Size];
+		BigEndian::writeUint32(std::span<std::byte>{ crc, Uint32Size }, crc32(std::span<const std::byte>(pending).subspan(start)));
+		pending.insert(pending.end(), crc, crc + Uint32Size);
+		appended += pending.size() - start;
+	}
+
+	void ChunkJournal::appendChunk(const Chunk& chunk) {
+		std::lock_guard lock(mtx);
+		if (!segment) {
+			throw std::logic_error("ChunkJournal::replay must be called before appending");
+		}
+		const auto start = pending.size();
+		pending.push_back(std::byte{ JournalChunkRecord });
+		BufferWriter writer(pending);
+		chunk.serialize(interface::IWriter(&writer));
+		sealRecord(start);
+	}
+
+	uint64_t ChunkJournal::appendRoot(const Hash& root) {
+		std::lock_guard lock(mtx);
+		if (!segment) {
+			throw std::logic_error("ChunkJournal::replay must be called before appending");
+		}
+		const auto start = pending.size();
+		pending.push_back(std::byte{ JournalRootRecord });
+		const std::span<const std::byte> bytes(root);
+		pending.insert(pending.end(), bytes.begin(), bytes.end());
+		sealRecord(start);
+		return appended;
+	}
+
+	void ChunkJournal::sync(uint64_t seq) {
+		std::unique_lock lock(mtx);
+		while (durable < seq) {
+			if (syncing) {
+				// someone else is writing, their fsync may well cover us
+				synced.wait(lock);
+				continue;
+			}
+			// become the leader: write out everything buffered so far, including the
+			// records of every caller that queued up behind us
+			syncing = true;
+			std::vector<std::byte> buf;
+			buf.swap(pending);
+			const auto target = appended;
+			// rotate() waits for us, so the segment and its size stay put until we are done
+			const auto offset = segmentSize;
+			File* file = segment.get();
+			lock.unlock();
+			try {
+				file->writeAt(buf, offset);
+				file->sync();
+			}
+			catch (...) {
+				// put the records back in front of what was appended meanwhile; the next
+				// sync writes them again at the same offset, over whatever got through
+				lock.lock();
+				buf.insert(buf.end(), pending.begin(), pending.end());
+				pending.swap(buf);
+				syncing = false;
+				synced.notify_all();
+				throw;
+			}
+			lock.lock();
+			segmentSize += buf.size();
+			durable = target;
+			syncing = false;
+			synced.notify_all();
+		}
+	}
+
+	uint64_t ChunkJournal::rotate() {
+		std::unique_lock lock(mtx);
+		synced.wait(lock, [this] { return !syncing; });
+		if (!pending.empty()) {
+			segment->writeAt(pending, segmentSize);
+			segmentSize += pending.size();
+			pending.clear();
+		}
+		segment->sync();
+		durable = appended;
+		synced.notify_all();
+		const auto closed = segmentId;
+		openSegment(segmentId + 1);
+		return closed;
+	}
+
+	void ChunkJournal::retire(uint64_t id) {
+		std::lock_guard lock(mtx);
+		if (id <= retired) {
+			return;
+		}
+		for (auto sid : listSegments()) {
+			if (sid <= id && sid != segmentId) {
+				std::filesystem::remove(segmentPath(sid));
+			}
+		}
+		retired = id;
+	}
+}
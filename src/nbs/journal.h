@@ -0,0 +1,67 @@
+#pragma once
+
+#include "common.h"
+#include "chunks/all.h"
+#include "io/file.h"
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace nomp {
+	// ChunkJournal is a write-ahead log for chunks that have been put but are not yet
+	// in a table. It is split into segments, one per memtable: when a memtable is
+	// rotated out the journal starts a new segment, and once the memtable's table is
+	// recorded in the manifest its segment is retired (deleted).
+	//
+	// Appends are buffered in memory. sync() makes everything appended so far durable,
+	// and concurrent callers share a single write + fsync (group commit).
+	class ChunkJournal {
+	public:
+		struct ReplayedSegment {
+			uint64_t id;
+			std::vector<Chunk> chunks;
+			std::optional<Hash> root; // last root committed in this segment
+		};
+
+		explicit ChunkJournal(const std::string& dir);
+
+		// Reads every segment left on disk, oldest first, and starts a fresh segment
+		// for new appends. A torn record at the tail of a segment ends that segment.
+		// Must be called once, before anything is appended.
+		std::vector<ReplayedSegment> replay();
+
+		void appendChunk(const Chunk& chunk);
+		// Returns the sequence number to pass to sync() to make this root durable.
+		uint64_t appendRoot(const Hash& root);
+		// Blocks until everything up to |seq| is durable.
+		void sync(uint64_t seq);
+
+		// Writes out and syncs the current segment, starts a new one and returns the id
+		// of the segment that was closed.
+		uint64_t rotate();
+		// Deletes every segment with an id <= |id|.
+		void retire(uint64_t id);
+
+		std::string segmentPath(uint64_t id) const;
+
+	private:
+		std::string dir;
+		std::mutex mtx;
+		std::condition_variable synced;
+		std::unique_ptr<File> segment;
+		uint64_t segmentId = 0;
+		uint64_t segmentSize = 0;
+		std::vector<std::byte> pending;
+		uint64_t appended = 0; // bytes appended over the journal's lifetime
+		uint64_t durable = 0; // bytes known to be durable
+		bool syncing = false;
+		uint64_t retired = 0;
+
+		void openSegment(uint64_t id);
+		void sealRecord(size_t start);
+		std::vector<uint64_t> listSegments() const;
+	};
+}
@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+
+#include "journal.h"
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace nomp;
+
+static std::string journalDir(const std::string& name) {
+	auto dir = (std::filesystem::temp_directory_path() / ("nomp_journal_" + std::to_string(::testing::UnitTest::GetInstance()->random_seed()) + "_" + name)).string();
+	std::filesystem::remove_all(dir);
+	return dir;
+}
+
+TEST(ChunkJournalTest, TestReplay) {
+	const auto dir = journalDir("replay");
+	std::vector<Chunk> chunks;
+	for (int i = 0; i < 20; ++i) {
+		chunks.push_back(Chunk::FromString("chunk " + std::to_string(i)));
+	}
+	{
+		ChunkJournal journal(dir);
+		EXPECT_TRUE(journal.replay().empty());
+		for (int i = 0; i < 10; ++i) {
+			journal.appendChunk(chunks[i]);
+		}
+		journal.sync(journal.appendRoot(chunks[0].hash()));
+		EXPECT_EQ(journal.rotate(), 1);
+		for (int i = 10; i < 20; ++i) {
+			journal.appendChunk(chunks[i]);
+		}
+		journal.sync(journal.appendRoot(chunks[10].hash()));
+		// never synced, so it may be lost
+		journal.appendChunk(Chunk::FromString("lost"));
+	}
+	ChunkJournal journal(dir);
+	auto segments = journal.replay();
+	ASSERT_EQ(segments.size(), 2);
+	EXPECT_EQ(segments[0].id, 1);
+	EXPECT_EQ(segments[0].chunks, std::vector<Chunk>(chunks.begin(), chunks.begin() + 10));
+	EXPECT_EQ(segments[0].root, chunks[0].hash());
+	EXPECT_EQ(segments[1].id, 2);
+	EXPECT_EQ(segments[1].chunks, std::vector<Chunk>(chunks.begin() + 10, chunks.end()));
+	EXPECT_EQ(segments[1].root, chunks[10].hash());
+
+	journal.retire(2);
+	EXPECT_FALSE(std::filesystem::exists(journal.segmentPath(1)));
+	EXPECT_FALSE(std::filesystem::exists(journal.segmentPath(2)));
+	EXPECT_TRUE(std::filesystem::exists(journal.segmentPath(3)));
+	std::filesystem::remove_all(dir);
+}
+
+TEST(ChunkJournalTest, TestTornTail) {
+	const auto dir = journalDir("torn");
+	auto a = Chunk::FromString("first");
+	auto b = Chunk::FromString("second");
+	std::string path;
+	{
+		ChunkJournal journal(dir);
+		journal.replay();
+		journal.appendChunk(a);
+		journal.appendChunk(b);
+		journal.sync(journal.appendRoot(b.hash()));
+		path = journal.segmentPath(1);
+	}
+	// cut the root record and the end of the second chunk
+	std::filesystem::resize_file(path, std::filesystem::file_size(path) - 30);
+	{
+		ChunkJournal journal(dir);
+		auto segments = journal.replay();
+		ASSERT_EQ(segments.size(), 1);
+		EXPECT_EQ(segments[0].chunks, std::vector<Chunk>{ a });
+		EXPECT_FALSE(segments[0].root.has_value());
+	}
+	// a corrupt byte ends the segment as well
+	{
+		auto file = File::open(path, FileMode::ReadWrite);
+		std::byte junk{ 0xff };
+		file.writeAt(std::span{ &junk, 1 }, 10);
+	}
+	ChunkJournal journal(dir);
+	auto segments = journal.replay();
+	ASSERT_EQ(segments.size(), 2);
+	EXPECT_TRUE(segments[0].chunks.empty());
+	EXPECT_EQ(std::filesystem::file_size(path), 0);
+	std::filesystem::remove_all(dir);
+}
+
+TEST(ChunkJournalTest, TestConcurrentSync) {
+	const auto dir = journalDir("sync");
+	std::vector<Hash> roots;
+	{
+		ChunkJournal journal(dir);
+		journal.replay();
+		std::vector<std::thread> committers;
+		for (int w = 0; w < 8; ++w) {
+			committers.emplace_back([&, w] {
+				for (int i = 0; i < 50; ++i) {
+					auto c = Chunk::FromString(std::to_string(w) + "/" + std::to_string(i));
+					journal.appendChunk(c);
+					journal.sync(journal.appendRoot(c.hash()));
+				}
+			});
+		}
+		for (auto& t : committers) {
+			t.join();
+		}
+	}
+	ChunkJournal journal(dir);
+	auto segments = journal.replay();
+	ASSERT_EQ(segments.size(), 1);
+	EXPECT_EQ(segments[0].chunks.size(), 400);
+	EXPECT_TRUE(segments[0].root.has_value());
+	std::filesystem::remove_all(dir);
+}
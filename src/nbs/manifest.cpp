@@ -0,0 +1,31 @@
+#include "manifest.h"
+#include "binary/all.h"
+
+namespace nomp {
+	static void checkManifest() {
+		pro::make_proxy<interface::Manifest, MemoryManifest>();
+	}
+
+	Hash generateLockHash(const Hash& root, std::span<const TableSpec> specs) {
+		Hasher hasher;
+		hasher.update(std::span<const std::byte>(root));
+		for (const auto& spec : specs) {
+			hasher.update(std::span<const std::byte>(spec.name));
+		}
+		return hasher.final();
+	}
+
+	std::optional<ManifestContents> MemoryManifest::fetch() {
+		std::lock_guard lock(state->mtx);
+		return state->contents;
+	}
+
+	ManifestContents MemoryManifest::update(const Hash& lastLock, const ManifestContents& newContents) {
+		std::lock_guard lock(state->mtx);
+		const Hash current = state->contents.has_value() ? state->contents->lock : Hash();
+		if (current == lastLock) {
+			state->contents = newContents;
+		}
+		return state->contents.value_or(ManifestContents{});
+	}
+}
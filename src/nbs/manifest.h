@@ -0,0 +1,56 @@
+#pragma once
+
+#include "common.h"
+#include "hash/all.h"
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace nomp {
+	struct TableSpec {
+		Hash name;
+		uint32_t chunkCount;
+	};
+
+	// ManifestContents is the ground truth of a store: the root hash and the set of
+	// tables that hold every chunk reachable from it. |lock| changes on every update
+	// and is used for optimistic concurrency control.
+	struct ManifestContents {
+		Hash lock;
+		Hash root;
+		std::vector<TableSpec> specs;
+	};
+
+	Hash generateLockHash(const Hash& root, std::span<const TableSpec> specs);
+
+	namespace interface {
+		PRO_DEF_MEM_DISPATCH(MemFetch, fetch);
+		PRO_DEF_MEM_DISPATCH(MemUpdate, update);
+
+		struct Manifest : pro::facade_builder
+			// Returns the persisted contents, or nullopt if the manifest has never been written.
+			::add_convention<MemFetch, std::optional<ManifestContents>()>
+			// Atomically replaces the persisted contents with |newContents| iff the persisted
+			// lock is |lastLock|. Returns whatever is persisted afterwards, so callers can tell
+			// whether they won by comparing locks.
+			::add_convention<MemUpdate, ManifestContents(const Hash& lastLock, const ManifestContents& newContents)>
+			::build {
+		};
+		using IManifest = pro::proxy<Manifest>;
+	}
+
+	// MemoryManifest keeps the manifest in memory. Copies share the same contents.
+	class MemoryManifest {
+		struct State {
+			std::optional<ManifestContents> contents;
+			std::mutex mtx;
+		};
+		std::shared_ptr<State> state;
+	public:
+		MemoryManifest() : state(std::make_shared<State>()) {}
+
+		std::optional<ManifestContents> fetch();
+		ManifestContents update(const Hash& lastLock, const ManifestContents& newContents);
+	};
+}
@@ -20,7 +20,7 @@ namespace nomp {
 		uint64_t maxData;
 		uint64_t totalData;
 	public:
-		MemTable(int maxData = 1LL << 20) : maxData(maxData), totalData(0) {
+		MemTable(uint64_t maxData = 1ULL << 20) : maxData(maxData), totalData(0) {
 		}
 		bool addChunk(const Hash& h, const ByteSlice &data);
 		bool has(const Hash& hash) {
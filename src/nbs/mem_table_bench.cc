@@ -0,0 +1,56 @@
+#include <benchmark/benchmark.h>
+#include "mem_table.h"
+#include "test_util.h"
+#include <string>
+#include <vector>
+
+using namespace nomp;
+using test::makeChunks;
+
+// Args: chunk count, chunk size
+static void BM_MemTableAddChunk(benchmark::State& state) {
+	const auto chunks = makeChunks(size_t(state.range(0)), size_t(state.range(1)));
+	for (auto _ : state) {
+		MemTable mt(~0ULL);
+		for (const auto& c : chunks) {
+			mt.addChunk(c.hash(), c.data());
+		}
+		benchmark::DoNotOptimize(mt.count());
+	}
+	state.SetItemsProcessed(int64_t(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_MemTableAddChunk)->ArgsProduct({ { 1 << 10, 1 << 14 }, { 256, 4096 } });
+
+static void BM_MemTableHas(benchmark::State& state) {
+	const auto chunks = makeChunks(size_t(state.range(0)), 256);
+	MemTable mt(~0ULL);
+	for (const auto& c : chunks) {
+		mt.addChunk(c.hash(), c.data());
+	}
+	size_t i = 0;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(mt.has(chunks[i++ % chunks.size()].hash()));
+	}
+}
+BENCHMARK(BM_MemTableHas)->Range(1 << 10, 1 << 16);
+
+static void BM_MemTableGetMany(benchmark::State& state) {
+	const auto chunks = makeChunks(size_t(state.range(0)), 256);
+	MemTable mt(~0ULL);
+	for (const auto& c : chunks) {
+		mt.addChunk(c.hash(), c.data());
+	}
+	std::vector<getRecord> records;
+	for (const auto& c : chunks) {
+		records.emplace_back(getRecord{ c.hash(), ByteSlice(), c.hash().prefix(), false });
+	}
+	for (auto _ : state) {
+		for (auto& rec : records) {
+			rec.found = false;
+		}
+		std::span<getRecord> span{ records };
+		benchmark::DoNotOptimize(mt.getMany(span));
+	}
+	state.SetItemsProcessed(int64_t(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_MemTableGetMany)->Range(1 << 10, 1 << 16);
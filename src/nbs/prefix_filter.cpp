@@ -0,0 +1,38 @@
+#include "prefix_filter.h"
+
+namespace nomp {
+	namespace {
+		// odd multipliers that spread the low half of a prefix over each word of a block
+		constexpr uint32_t Salts[8] = {
+			0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+			0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U,
+		};
+	}
+
+	PrefixFilter::PrefixFilter(std::span<const uint64_t> prefixes) {
+		if (prefixes.empty()) {
+			return;
+		}
+		blocks.assign((prefixes.size() * BitsPerKey + 255) / 256, Block{});
+		for (const auto prefix : prefixes) {
+			auto& block = blocks[blockOf(prefix)];
+			const auto key = uint32_t(prefix);
+			for (size_t i = 0; i < 8; ++i) {
+				block.words[i] |= 1U << ((key * Salts[i]) >> 27);
+			}
+		}
+	}
+
+	bool PrefixFilter::mayContain(uint64_t prefix) const {
+		if (blocks.empty()) {
+			return true;
+		}
+		const auto& block = blocks[blockOf(prefix)];
+		const auto key = uint32_t(prefix);
+		bool all = true;
+		for (size_t i = 0; i < 8; ++i) {
+			all &= (block.words[i] >> ((key * Salts[i]) >> 27)) & 1U;
+		}
+		return all;
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "common.h"
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace nomp {
+	// PrefixFilter is a split block bloom filter over chunk address prefixes. A key
+	// sets one bit in each of the eight words of a single 32-byte block, so a probe
+	// touches one cache line. At 10 bits per key about 1% of absent prefixes pass.
+	// Prefixes are already uniformly distributed, so they are used without hashing.
+	class PrefixFilter {
+		static constexpr size_t BitsPerKey = 10;
+
+		struct alignas(32) Block {
+			uint32_t words[8];
+		};
+		std::vector<Block> blocks;
+
+		size_t blockOf(uint64_t prefix) const {
+			return size_t(((prefix >> 32) * blocks.size()) >> 32);
+		}
+	public:
+		PrefixFilter() = default;
+		explicit PrefixFilter(std::span<const uint64_t> prefixes);
+
+		// Returns false only if no prefix the filter was built from equals |prefix|.
+		// An empty filter holds nothing back.
+		bool mayContain(uint64_t prefix) const;
+		// Returns the number of bytes held by this filter.
+		size_t memoryUsage() const {
+			return blocks.capacity() * sizeof(Block);
+		}
+	};
+}
@@ -0,0 +1,1023 @@
+#include "store.h"
+#include "parallel.h"
+#include "table_writer.h"
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace nomp {
+	static void checkStore() {
+		pro::make_proxy<interface::ChunkStore, NomsBlockStore>(
+			interface::IManifest(pro::make_proxy<interface::Manifest, MemoryManifest>()),
+			interface::ITablePersister(pro::make_proxy<interface::TablePersister, MemoryTablePersister>()));
+		pro::make_proxy<interface::ChunkStoreFactory, NbsMemoryStoreFactory>();
+	}
+
+	bool TableSet::has(const Hash& h) const {
+		for (const auto& mt : flushing) {
+			if (mt->has(h)) return true;
+		}
+		for (const auto& t : novel) {
+			if (t->has(h)) return true;
+		}
+		if (index) {
+			return index->locate(h, upstream).has_value();
+		}
+		for (const auto& t : upstream) {
+			if (t->has(h)) return true;
+		}
+		return false;
+	}
+
+	bool TableSet::hasMany(std::span<hasRecord>& records) const {
+		for (const auto& mt : flushing) {
+			if (!mt->hasMany(records)) return false;
+		}
+		for (const auto& t : novel) {
+			if (!t->hasMany(records)) return false;
+		}
+		if (index) {
+			bool remaining = false;
+			for (auto& rec : records) {
+				if (rec.has) continue;
+				rec.has = index->locate(rec.addr, upstream).has_value();
+				remaining |= !rec.has;
+			}
+			return remaining;
+		}
+		for (const auto& t : upstream) {
+			if (!t->hasMany(records)) return false;
+		}
+		return true;
+	}
+
+	bool TableSet::get(const Hash& h, ByteSlice& data) const {
+		for (const auto& mt : flushing) {
+			if (mt->get(h, data)) return true;
+		}
+		for (const auto& t : novel) {
+			if (t->get(h, data)) return true;
+		}
+		if (index) {
+			const auto loc = index->locate(h, upstream);
+			if (!loc.has_value()) return false;
+			getRecord rec{ h, ByteSlice(), h.prefix(), false };
+			TableReader::OrdinalRecord hit{ &rec, loc->ordinal };
+			upstream[loc->table]->getOrdinals(std::span{ &hit, 1 });
+			data = rec.data;
+			return true;
+		}
+		for (const auto& t : upstream) {
+			if (t->get(h, data)) return true;
+		}
+		return false;
+	}
+
+	bool TableSet::getMany(std::span<getRecord>& records) const {
+		for (const auto& mt : flushing) {
+			if (!mt->getMany(records)) return false;
+		}
+		for (const auto& t : novel) {
+			if (!t->getMany(records)) return false;
+		}
+		if (index) {
+			// locate everything first, then read each table's hits in one batch
+			std::vector<std::vector<TableReader::OrdinalRecord>> hits(upstream.size());
+			bool remaining = false;
+			for (auto& rec : records) {
+				if (rec.found) continue;
+				const auto loc = index->locate(rec.addr, upstream);
+				if (loc.has_value()) {
+					hits[loc->table].push_back(TableReader::OrdinalRecord{ &rec, loc->ordinal });
+				}
+				else {
+					remaining = true;
+				}
+			}
+			for (size_t t = 0; t < upstream.size(); ++t) {
+				upstream[t]->getOrdinals(hits[t]);
+			}
+			return remaining;
+		}
+		for (const auto& t : upstream) {
+			if (!t->getMany(records)) return false;
+		}
+		return true;
+	}
+
+	NomsBlockStore::NomsBlockStore(interface::IManifest manifest, interface::ITablePersister persister, NbsOptions options) :
+		manifest(std::move(manifest)),
+		persister(std::move(persister)),
+		options(options),
+		mt(std::make_shared<MemTable>(options.memTableSize)),
+		tables(std::make_shared<TableSet>())
+	{
+		if (options.maxPendingFlushes == 0) {
+			throw std::invalid_argument("maxPendingFlushes must be at least 1");
+		}
+		if (options.globalIndex && !options.globalIndexFile.empty()) {
+			// a stale index is fine, updateUpstream extends or rebuilds it
+			globalIndex = savedIndex = GlobalIndex::load(options.globalIndexFile);
+		}
+		auto contents = this->manifest->fetch();
+		if (contents.has_value()) {
+			updateUpstream(contents.value());
+		}
+		if (!options.journalDir.empty()) {
+			journal = std::make_unique<ChunkJournal>(options.journalDir);
+			replayJournal();
+		}
+		flusher = std::thread(&NomsBlockStore::flushLoop, this);
+		if (options.preloadIndexes) {
+			preloader = std::thread([this, readers = tables->upstream] {
+				try {
+					parallelFor(readers.size(), this->options.openThreads, [&](size_t i) {
+						if (!stopPreload.load(std::memory_order_relaxed)) readers[i]->loadIndex();
+					});
+				}
+				catch (const std::exception&) {
+					// a table that fails to parse here fails again, visibly, on first use
+				}
+			});
+		}
+	}
+
+	NomsBlockStore::~NomsBlockStore() {
+		close();
+	}
+
+	// must be called with mtx held
+	void NomsBlockStore::publishTables(std::vector<std::shared_ptr<TableReader>> upstreamTables) {
+		auto ts = std::make_shared<TableSet>();
+		for (auto it = flushing.rbegin(); it != flushing.rend(); ++it) {
+			ts->flushing.push_back(it->table);
+		}
+		ts->novel.assign(novel.rbegin(), novel.rend());
+		ts->upstream = std::move(upstreamTables);
+		ts->index = globalIndex;
+		tables = std::move(ts);
+	}
+
+	// must be called with mtx held
+	void NomsBlockStore::publishTables() {
+		publishTables(tables->upstream);
+	}
+
+	// must be called with mtx held
+	void NomsBlockStore::updateUpstream(const ManifestContents& contents) {
+		std::unordered_map<Hash, std::shared_ptr<TableReader>, Hash::Hasher> open;
+		for (const auto& t : tables->upstream) {
+			open[t->name()] = t;
+		}
+		for (const auto& t : novel) {
+			open[t->name()] = t;
+		}
+		std::vector<std::shared_ptr<TableReader>> upstreamTables(contents.specs.size());
+		std::vector<size_t> unopened;
+		for (size_t i = 0; i < contents.specs.size(); ++i) {
+			auto it = open.find(contents.specs[i].name);
+			if (it != open.end()) {
+				upstreamTables[i] = it->second;
+			}
+			else {
+				unopened.push_back(i);
+			}
+		}
+		// opening a table only reads its footer, its index is parsed on first use
+		parallelFor(unopened.size(), options.openThreads, [&](size_t i) {
+			auto timer = recorder.time(StoreOp::TableOpen);
+			upstreamTables[unopened[i]] = persister->open(contents.specs[unopened[i]].name);
+		});
+		if (options.globalIndex) {
+			// the tables the index does not cover yet are about to be read in full
+			HashSet indexed;
+			if (globalIndex) {
+				indexed.insert(globalIndex->tableNames().begin(), globalIndex->tableNames().end());
+			}
+			std::vector<std::shared_ptr<TableReader>> unindexed;
+			for (const auto& t : upstreamTables) {
+				if (!indexed.contains(t->name())) unindexed.push_back(t);
+			}
+			parallelFor(unindexed.size(), options.openThreads, [&](size_t i) { unindexed[i]->loadIndex(); });
+			// linear in the size of the index, and only done when the manifest changes
+			globalIndex = GlobalIndex::update(globalIndex, upstreamTables);
+		}
+		std::erase_if(novel, [&](const std::shared_ptr<TableReader>& t) {
+			return std::any_of(contents.specs.begin(), contents.specs.end(), [&](const TableSpec& s) { return s.name == t->name(); });
+		});
+		upstream = contents;
+		if (!journal) {
+			currentRoot = contents.root;
+		}
+		publishTables(std::move(upstreamTables));
+	}
+
+	void NomsBlockStore::checkFlushError() {
+		if (flushError) {
+			std::rethrow_exception(flushError);
+		}
+	}
+
+	// Reorders |records| depth first from the chunks no other record refers to, so a
+	// memtable written bottom up comes out top down with each subtree contiguous.
+	static void orderByGraph(std::vector<extractRecord>& records, interface::IRefDecoder& decoder) {
+		std::unordered_map<Hash, size_t, Hash::Hasher> position;
+		for (size_t i = 0; i < records.size(); ++i) {
+			position.emplace(records[i].addr, i);
+		}
+		std::vector<std::vector<Hash>> refs(records.size());
+		std::vector<bool> referenced(records.size());
+		for (size_t i = 0; i < records.size(); ++i) {
+			decoder->refs(Chunk(records[i].data, records[i].addr), refs[i]);
+			for (const auto& r : refs[i]) {
+				if (auto it = position.find(r); it != position.end()) {
+					referenced[it->second] = true;
+				}
+			}
+		}
+		std::vector<Hash> roots;
+		for (size_t i = 0; i < records.size(); ++i) {
+			if (!referenced[i]) roots.push_back(records[i].addr);
+		}
+		const auto order = depthFirstOrder(roots, [&](const Hash& h) -> const std::vector<Hash>* {
+			auto it = position.find(h);
+			return it == position.end() ? nullptr : &refs[it->second];
+		});
+		std::vector<extractRecord> sorted;
+		sorted.reserve(records.size());
+		std::vector<bool> taken(records.size());
+		for (const auto& h : order) {
+			const auto i = position[h];
+			taken[i] = true;
+			sorted.push_back(std::move(records[i]));
+		}
+		// only a ref cycle could leave anything out, keep it rather than lose it
+		for (size_t i = 0; i < records.size(); ++i) {
+			if (!taken[i]) sorted.push_back(std::move(records[i]));
+		}
+		records = std::move(sorted);
+	}
+
+	// Writes |table| out, leaving out the chunks |existing| already holds. Returns null
+	// if nothing is left to write.
+	std::shared_ptr<TableReader> NomsBlockStore::writeTable(MemTable& table, const TableSet* existing) {
+		auto timer = recorder.time(StoreOp::Flush);
+		std::vector<extractRecord> records;
+		records.reserve(table.count());
+		table.extract(records);
+		if (options.orderDecoder) {
+			orderByGraph(records, *options.orderDecoder);
+		}
+		uint64_t uncompressed = table.uncompressedLen();
+		if (existing) {
+			// one batched lookup in prefix order, then drop the hits keeping insertion order
+			std::vector<hasRecord> lookups;
+			lookups.reserve(records.size());
+			for (size_t i = 0; i < records.size(); ++i) {
+				lookups.push_back(hasRecord{ records[i].addr, records[i].addr.prefix(), int(i), false });
+			}
+			std::sort(lookups.begin(), lookups.end(), [](const hasRecord& a, const hasRecord& b) { return a.prefix < b.prefix; });
+			std::span<hasRecord> span{ lookups };
+			existing->hasMany(span);
+			std::vector<bool> found(records.size());
+			for (const auto& rec : lookups) {
+				found[rec.order] = rec.has;
+			}
+			uint64_t dupBytes = 0;
+			size_t kept = 0;
+			for (size_t i = 0; i < records.size(); ++i) {
+				if (found[i]) {
+					dupBytes += records[i].data.size();
+				}
+				else {
+					records[kept++] = std::move(records[i]);
+				}
+			}
+			recorder.deduped(records.size() - kept, dupBytes);
+			records.erase(records.begin() + kept, records.end());
+			uncompressed -= dupBytes;
+			if (records.empty()) {
+				return nullptr;
+			}
+		}
+		TableWriter tw(records.size(), uncompressed);
+		for (const auto& rec : records) {
+			tw.addChunk(rec.addr, rec.data);
+		}
+		auto [name, data] = tw.finish();
+		auto reader = persister->persist(name, data);
+		timer.bytes = data.size();
+		recorder.wrote(data.size(), uncompressed);
+		return reader;
+	}
+
+	// Queues whatever the journal holds for flushing, so it ends up in tables and the
+	// manifest as if the store had never gone away.
+	void NomsBlockStore::replayJournal() {
+		auto segments = journal->replay();
+		if (segments.empty()) {
+			return;
+		}
+		auto table = std::make_shared<MemTable>(options.memTableSize);
+		for (const auto& seg : segments) {
+			for (const auto& c : seg.chunks) {
+				while (!table->addChunk(c.hash(), c.data())) {
+					if (table->count() == 0) {
+						table = std::make_shared<MemTable>(c.size());
+						continue;
+					}
+					// everything reachable from the manifest root is already in a table, so
+					// it is safe to publish this one with it
+					flushing.push_back(PendingFlush{ std::move(table), 0, upstream.root });
+					table = std::make_shared<MemTable>(options.memTableSize);
+				}
+			}
+			if (seg.root.has_value()) {
+				currentRoot = seg.root.value();
+			}
+		}
+		// queued even when empty, so the replayed root reaches the manifest and the
+		// segments get retired
+		flushing.push_back(PendingFlush{ std::move(table), segments.back().id, currentRoot });
+		publishTables();
+	}
+
+	// Records a flushed table and the root it was rotated under in the manifest, then
+	// retires the journal segments the table covers. Journal mode only.
+	ManifestContents NomsBlockStore::publishFlush(const PendingFlush& flush, const std::shared_ptr<TableReader>& reader) {
+		ManifestContents newContents{ Hash(), flush.root.value(), {} };
+		Hash lastLock;
+		{
+			std::lock_guard lock(mtx);
+			newContents.specs = upstream.specs;
+			lastLock = upstream.lock;
+		}
+		if (reader) {
+			newContents.specs.push_back(TableSpec{ reader->name(), reader->count() });
+		}
+		newContents.lock = generateLockHash(newContents.root, newContents.specs);
+		auto actual = manifest->update(lastLock, newContents);
+		if (actual.lock != newContents.lock) {
+			throw std::runtime_error("Manifest was updated by another writer, a journaled NomsBlockStore must be its only writer");
+		}
+		journal->retire(flush.segment);
+		return actual;
+	}
+
+	void NomsBlockStore::flushLoop() {
+		std::unique_lock lock(mtx);
+		while (true) {
+			flushReady.wait(lock, [this] { return !flushing.empty() || closed; });
+			if (closed) {
+				return;
+			}
+			auto flush = flushing.front();
+			// flushes run in order, so every older memtable is in a table by now
+			std::optional<TableSet> existing;
+			if (options.dedupOnFlush) {
+				existing.emplace(TableSet{ {}, tables->novel, tables->upstream, tables->index });
+			}
+			lock.unlock();
+			std::shared_ptr<TableReader> reader;
+			ManifestContents published;
+			std::exception_ptr err;
+			try {
+				if (flush.table->count() > 0) {
+					reader = writeTable(*flush.table, existing ? &*existing : nullptr);
+				}
+				if (journal) {
+					published = publishFlush(flush, reader);
+				}
+			}
+			catch (...) {
+				err = std::current_exception();
+			}
+			lock.lock();
+			if (err) {
+				// leave the memtable where it is so its chunks stay readable
+				flushError = err;
+				flushDone.notify_all();
+				return;
+			}
+			if (reader) {
+				novel.push_back(reader);
+			}
+			flushing.pop_front();
+			if (journal) {
+				updateUpstream(published);
+			}
+			else {
+				publishTables();
+			}
+			flushDone.notify_all();
+		}
+	}
+
+	// Moves the active memtable to the flush queue, blocking while the queue is full.
+	void NomsBlockStore::rotateMemTable(std::unique_lock<std::mutex>& lock) {
+		flushDone.wait(lock, [this] { return flushing.size() < options.maxPendingFlushes || flushError || closed; });
+		checkFlushError();
+		if (closed) {
+			throw std::runtime_error("NomsBlockStore is closed");
+		}
+		if (mt->count() == 0) {
+			return; // another writer rotated while we were waiting
+		}
+		uint64_t segment = 0;
+		std::optional<Hash> root;
+		if (journal) {
+			segment = journal->rotate();
+			root = currentRoot;
+		}
+		flushing.push_back(PendingFlush{ std::move(mt), segment, root });
+		mt = std::make_shared<MemTable>(options.memTableSize);
+		publishTables();
+		flushReady.notify_one();
+	}
+
+	void NomsBlockStore::waitForFlushes(std::unique_lock<std::mutex>& lock) {
+		if (mt->count() > 0) {
+			rotateMemTable(lock);
+		}
+		flushDone.wait(lock, [this] { return flushing.empty() || flushError || closed; });
+		checkFlushError();
+		if (closed) {
+			throw std::runtime_error("NomsBlockStore is closed");
+		}
+	}
+
+	bool NomsBlockStore::has(const Hash& hash) {
+		auto timer = recorder.time(StoreOp::Has);
+		std::shared_ptr<const TableSet> ts;
+		{
+			std::lock_guard lock(mtx);
+			if (mt->has(hash)) {
+				recorder.cacheHit();
+				return true;
+			}
+			ts = tables;
+		}
+		recorder.cacheMiss();
+		return ts->has(hash);
+	}
+
+	std::unique_ptr<HashSet> NomsBlockStore::absent(const HashSet& hashes) {
+		auto absent = std::make_unique<HashSet>();
+		for (const auto& h : hashes) {
+			if (!has(h)) {
+				absent->insert(h);
+			}
+		}
+		return absent;
+	}
+
+	std::optional<Chunk> NomsBlockStore::get(const Hash& hash) {
+		auto timer = recorder.time(StoreOp::Get);
+		ByteSlice data;
+		std::shared_ptr<const TableSet> ts;
+		{
+			std::lock_guard lock(mtx);
+			if (mt->get(hash, data)) {
+				recorder.cacheHit();
+				timer.bytes = data.size();
+				return Chunk(data, hash);
+			}
+			ts = tables;
+		}
+		recorder.cacheMiss();
+		if (ts->get(hash, data)) {
+			timer.bytes = data.size();
+			recorder.read(data.size());
+			return Chunk(data, hash);
+		}
+		return std::nullopt;
+	}
+
+	std::vector<Chunk> NomsBlockStore::getMany(const HashSet& hashes) {
+		auto timer = recorder.time(StoreOp::GetMany);
+		std::vector<getRecord> records;
+		records.reserve(hashes.size());
+		for (const auto& h : hashes) {
+			records.emplace_back(getRecord{ h, ByteSlice(), h.prefix(), false });
+		}
+		std::span<getRecord> span{ records };
+		std::shared_ptr<const TableSet> ts;
+		bool remaining;
+		{
+			std::lock_guard lock(mtx);
+			remaining = mt->getMany(span);
+			ts = tables;
+		}
+		uint64_t memoryBytes = 0;
+		for (const auto& rec : records) {
+			if (rec.found) memoryBytes += rec.data.size();
+		}
+		if (remaining) {
+			recorder.cacheMiss();
+			ts->getMany(span);
+		}
+		else {
+			recorder.cacheHit();
+		}
+		std::vector<Chunk> chunks;
+		for (auto& rec : records) {
+			if (rec.found) {
+				timer.bytes += rec.data.size();
+				chunks.emplace_back(rec.data, rec.addr);
+			}
+		}
+		recorder.read(timer.bytes - memoryBytes);
+		return chunks;
+	}
+
+	void NomsBlockStore::put(const Chunk& chunk) {
+		auto timer = recorder.time(StoreOp::Put);
+		timer.bytes = chunk.size();
+		std::unique_lock lock(mtx);
+		checkFlushError();
+		if (mt->has(chunk.hash())) {
+			return;
+		}
+		while (!mt->addChunk(chunk.hash(), chunk.data())) {
+			if (mt->count() == 0) {
+				// the chunk is larger than a whole memtable, give it one of its own
+				mt = std::make_shared<MemTable>(chunk.size());
+				continue;
+			}
+			rotateMemTable(lock);
+		}
+		if (journal) {
+			// appended under mtx so each journal segment holds exactly its memtable's chunks
+			journal->appendChunk(chunk);
+		}
+		if (gc) {
+			gc->written.push_back(chunk);
+		}
+	}
+
+	void NomsBlockStore::rebase() {
+		auto contents = manifest->fetch();
+		std::lock_guard lock(mtx);
+		if (contents.has_value() && contents->lock != upstream.lock) {
+			updateUpstream(contents.value());
+		}
+	}
+
+	Hash NomsBlockStore::root() {
+		std::lock_guard lock(mtx);
+		return currentRoot;
+	}
+
+	bool NomsBlockStore::commit(const Hash& newRoot, const Hash& last) {
+		auto timer = recorder.time(StoreOp::Commit);
+		std::unique_lock lock(mtx);
+		checkFlushError();
+		if (journal) {
+			if (last != currentRoot) {
+				return false;
+			}
+			const auto seq = journal->appendRoot(newRoot);
+			currentRoot = newRoot;
+			lock.unlock();
+			// concurrent committers share the journal's write + fsync
+			journal->sync(seq);
+			return true;
+		}
+		if (gc) {
+			// kept even if the commit loses, the caller may retry it on a new base
+			gc->roots.push_back(newRoot);
+		}
+		CommitRequest request{ newRoot, last, std::nullopt, nullptr };
+		commitQueue.push_back(&request);
+		while (!request.result.has_value() && !request.error) {
+			if (committing) {
+				commitDone.wait(lock);
+				continue;
+			}
+			// lead a batch of everyone queued so far, later arrivals wait for the next one
+			committing = true;
+			auto batch = std::exchange(commitQueue, {});
+			try {
+				commitBatch(lock, batch);
+			}
+			catch (...) {
+				for (auto* req : batch) {
+					req->error = std::current_exception();
+				}
+			}
+			committing = false;
+			commitDone.notify_all();
+		}
+		if (request.error) {
+			std::rethrow_exception(request.error);
+		}
+		return request.result.value();
+	}
+
+	// must be called with mtx held
+	void NomsBlockStore::commitBatch(std::unique_lock<std::mutex>& lock, std::span<CommitRequest* const> batch) {
+		// every chunk put before these commits is in the memtable, so one flush covers them all
+		waitForFlushes(lock);
+		while (true) {
+			Hash root = upstream.root;
+			bool any = false;
+			for (auto* req : batch) {
+				req->result = req->last == root;
+				if (req->result.value()) {
+					root = req->newRoot;
+					any = true;
+				}
+			}
+			if (!any) {
+				return;
+			}
+			ManifestContents newContents{ Hash(), root, upstream.specs };
+			for (const auto& t : novel) {
+				newContents.specs.push_back(TableSpec{ t->name(), t->count() });
+			}
+			newContents.lock = generateLockHash(root, newContents.specs);
+			// commits arriving during the update queue up for the next batch
+			const auto lastLock = upstream.lock;
+			lock.unlock();
+			std::optional<ManifestContents> actual;
+			try {
+				actual = manifest->update(lastLock, newContents);
+			}
+			catch (...) {
+				lock.lock();
+				throw;
+			}
+			lock.lock();
+			// on success this moves every novel table upstream, otherwise it picks up
+			// whatever the winning writer committed and we try again on top of it. A
+			// rebase may have picked up something newer meanwhile, keep that instead.
+			if (upstream.lock == lastLock) {
+				updateUpstream(actual.value());
+			}
+			if (actual->lock == newContents.lock) {
+				return;
+			}
+		}
+	}
+
+	void NomsBlockStore::close() {
+		{
+			std::lock_guard lock(mtx);
+			if (closed) {
+				return;
+			}
+			closed = true;
+		}
+		flushReady.notify_all();
+		flushDone.notify_all();
+		if (flusher.joinable()) {
+			flusher.join();
+		}
+		stopPreload = true;
+		if (preloader.joinable()) {
+			preloader.join();
+		}
+		if (globalIndex && globalIndex != savedIndex && !options.globalIndexFile.empty()) {
+			try {
+				globalIndex->save(options.globalIndexFile);
+				savedIndex = globalIndex;
+			}
+			catch (const std::exception&) {
+				// the index only speeds up reads, the next open rebuilds it
+			}
+		}
+	}
+
+	interface::IChunkStore NbsMemoryStoreFactory::createStore(const std::string& path) {
+		std::lock_guard lock(mtx);
+		auto& backing = stores[path];
+		return pro::make_proxy<interface::ChunkStore, NomsBlockStore>(
+			interface::IManifest(pro::make_proxy<interface::Manifest, MemoryManifest>(backing.manifest)),
+			interface::ITablePersister(pro::make_proxy<interface::TablePersister, MemoryTablePersister>(backing.persister)),
+			options);
+	}
+
+	ManifestContents NomsBlockStore::manifestContents() const {
+		std::lock_guard lock(mtx);
+		return upstream;
+	}
+
+	std::shared_ptr<TableReader> NomsBlockStore::openTable(const Hash& name) {
+		auto timer = recorder.time(StoreOp::TableOpen);
+		return persister->open(name);
+	}
+
+	std::shared_ptr<TableReader> NomsBlockStore::copyTable(const Hash& name, interface::IReaderAt& src) {
+		auto reader = persister->persistFrom(name, src);
+		recorder.wrote(src->size(), reader->uncompressedLen());
+		return reader;
+	}
+
+	std::shared_ptr<TableReader> NomsBlockStore::adoptTable(const Hash& name, const std::string& path) {
+		auto reader = persister->adopt(name, path);
+		recorder.wrote(reader->bytes()->size(), reader->uncompressedLen());
+		return reader;
+	}
+
+	void NomsBlockStore::removeTable(const Hash& name) {
+		persister->remove(name);
+	}
+
+	void NomsBlockStore::addTables(std::span<const std::shared_ptr<TableReader>> readers) {
+		std::unique_lock lock(mtx);
+		// a journaled store's flusher updates the manifest without holding mtx, so wait
+		// until it is idle; it cannot start again while we hold the lock
+		flushDone.wait(lock, [this] { return flushing.empty() || flushError || closed; });
+		checkFlushError();
+		if (closed) {
+			throw std::runtime_error("NomsBlockStore is closed");
+		}
+		while (true) {
+			ManifestContents newContents{ Hash(), upstream.root, upstream.specs };
+			for (const auto& r : readers) {
+				const bool listed = std::any_of(newContents.specs.begin(), newContents.specs.end(),
+					[&](const TableSpec& s) { return s.name == r->name(); });
+				if (!listed) {
+					newContents.specs.push_back(TableSpec{ r->name(), r->count() });
+				}
+			}
+			if (newContents.specs.size() == upstream.specs.size()) {
+				return;
+			}
+			newContents.lock = generateLockHash(newContents.root, newContents.specs);
+			auto actual = manifest->update(upstream.lock, newContents);
+			updateUpstream(actual);
+			if (actual.lock == newContents.lock) {
+				return;
+			}
+		}
+	}
+
+	GcResult NomsBlockStore::collectGarbage(interface::IRefDecoder& decoder, const GcOptions& options) {
+		if (options.batchSize == 0 || options.threads == 0 || options.tableSize == 0) {
+			throw std::invalid_argument("Garbage collection batch size, threads and table size must be at least 1");
+		}
+		RefWalker marker(decoder, WalkOptions{ options.batchSize, options.threads });
+		std::vector<std::shared_ptr<TableReader>> old;
+		std::vector<std::shared_ptr<MemTable>> flushingTables;
+		std::vector<std::shared_ptr<TableReader>> novelTables;
+		std::vector<extractRecord> pending; // chunks not in the manifest yet
+		std::vector<Hash> roots; // what the mark started from, in order
+		{
+			std::lock_guard lock(mtx);
+			if (journal) {
+				throw std::runtime_error("Garbage collection is not supported on a journaled NomsBlockStore");
+			}
+			if (gc) {
+				throw std::runtime_error("A garbage collection is already running");
+			}
+			checkFlushError();
+			if (closed) {
+				throw std::runtime_error("NomsBlockStore is closed");
+			}
+			old = tables->upstream;
+			if (old.empty()) {
+				return GcResult{};
+			}
+			gc = std::make_unique<GcState>();
+			flushingTables = tables->flushing;
+			novelTables = tables->novel;
+			mt->extract(pending);
+			roots.push_back(currentRoot);
+		}
+		auto abandon = [this] {
+			std::lock_guard lock(mtx);
+			gc.reset();
+		};
+		try {
+			GcResult result;
+			// Mark. Chunks put but not committed yet may become reachable, so they count as
+			// roots too. They are kept themselves, not just their refs: a flush leaves out
+			// the chunks an old table already holds.
+			roots.insert(roots.end(), options.extraRoots.begin(), options.extraRoots.end());
+			for (const auto& t : flushingTables) {
+				t->extract(pending);
+			}
+			for (const auto& t : novelTables) {
+				t->extract(pending);
+			}
+			for (const auto& rec : pending) {
+				roots.push_back(rec.addr);
+			}
+			pending.clear();
+			for (const auto& h : roots) {
+				marker.add(h);
+			}
+			// the graph of live chunks, kept only to order them: each marking thread
+			// records the refs it decoded, merged once marking is done
+			using Edges = std::vector<std::pair<Hash, std::vector<Hash>>>;
+			std::vector<Edges> edges(options.threads);
+			const auto fetch = [this](const HashSet& hashes) { return getMany(hashes); };
+			const auto follow = [](const Chunk&) { return true; };
+			RefWalker::Expand record;
+			if (options.graphOrder) {
+				record = [&](const Chunk& c, std::span<const Hash> refs, size_t worker) {
+					edges[worker].emplace_back(c.hash(), std::vector<Hash>(refs.begin(), refs.end()));
+				};
+			}
+			marker.run(fetch, follow, nullptr, record);
+			// catch up with writers a few times, so there is little left to do under the lock
+			for (int round = 0; round < 3; ++round) {
+				GcState since;
+				{
+					std::lock_guard lock(mtx);
+					std::swap(since, *gc);
+				}
+				if (since.written.empty() && since.roots.empty()) {
+					break;
+				}
+				for (const auto& h : since.roots) {
+					roots.push_back(h);
+					marker.add(h);
+				}
+				for (const auto& c : since.written) {
+					roots.push_back(c.hash());
+					marker.add(c.hash());
+				}
+				marker.run(fetch, follow, nullptr, record);
+			}
+
+			// Copy the live chunks of the old tables as they are stored.
+			HashSet copied;
+			std::vector<std::shared_ptr<TableReader>> written;
+			std::vector<extractRecord> batch;
+			uint64_t batchBytes = 0;
+			auto writeBatch = [&] {
+				if (batch.empty()) {
+					return;
+				}
+				TableWriter tw(batch.size(), batchBytes);
+				for (const auto& rec : batch) {
+					tw.addRecord(rec.addr, rec.data.span());
+				}
+				auto [name, data] = tw.finish();
+				written.push_back(persister->persist(name, data));
+				recorder.wrote(data.size(), written.back()->uncompressedLen());
+				result.bytesAfter += batchBytes;
+				batch.clear();
+				batchBytes = 0;
+			};
+			auto keep = [&](extractRecord&& rec) {
+				batchBytes += rec.data.size();
+				batch.push_back(std::move(rec));
+				if (batchBytes >= options.tableSize) {
+					writeBatch();
+				}
+			};
+			std::vector<extractRecord> live; // held back to be written in graph order
+			for (const auto& t : old) {
+				t->extractRecords([&](extractRecord&& rec) {
+					result.bytesBefore += rec.data.size();
+					if (!marker.seen().contains(rec.addr) || !copied.insert(rec.addr).second) {
+						++result.chunksDropped;
+						return;
+					}
+					++result.chunksKept;
+					// held past its window, which would otherwise stay alive with it
+					rec.data = rec.data.copy();
+					if (options.graphOrder) {
+						live.push_back(std::move(rec));
+					}
+					else {
+						keep(std::move(rec));
+					}
+				});
+			}
+			if (options.graphOrder) {
+				std::unordered_map<Hash, std::vector<Hash>, Hash::Hasher> graph;
+				for (auto& e : edges) {
+					for (auto& [h, refs] : e) {
+						graph.emplace(h, std::move(refs));
+					}
+					e = {};
+				}
+				const auto order = depthFirstOrder(roots, [&](const Hash& h) -> const std::vector<Hash>* {
+					auto it = graph.find(h);
+					return it == graph.end() ? nullptr : &it->second;
+				});
+				std::unordered_map<Hash, size_t, Hash::Hasher> rank;
+				for (size_t i = 0; i < order.size(); ++i) {
+					rank.emplace(order[i], i);
+				}
+				// anything the order missed keeps its place after everything it covers
+				std::vector<std::pair<size_t, size_t>> byRank; // rank, index into live
+				byRank.reserve(live.size());
+				for (size_t i = 0; i < live.size(); ++i) {
+					auto it = rank.find(live[i].addr);
+					byRank.emplace_back(it == rank.end() ? order.size() : it->second, i);
+				}
+				std::sort(byRank.begin(), byRank.end());
+				for (const auto& [r, i] : byRank) {
+					keep(std::move(live[i]));
+				}
+				live.clear();
+			}
+			writeBatch();
+
+			// Finish marking with writers held off, then swap the manifest. A commit
+			// updates the manifest without holding mtx, so let one in flight land first.
+			std::unique_lock lock(mtx);
+			commitDone.wait(lock, [this] { return !committing; });
+			checkFlushError();
+			if (closed) {
+				throw std::runtime_error("NomsBlockStore is closed");
+			}
+			GcState since = std::move(*gc);
+			for (const auto& c : since.written) {
+				marker.add(c.hash());
+			}
+			for (const auto& h : since.roots) {
+				marker.add(h);
+			}
+			// getMany() would take mtx, so read the memtable and tables directly
+			const auto fetchLocked = [this](const HashSet& hashes) {
+				std::vector<getRecord> records;
+				for (const auto& h : hashes) {
+					records.emplace_back(getRecord{ h, ByteSlice(), h.prefix(), false });
+				}
+				std::span<getRecord> span{ records };
+				if (mt->getMany(span)) {
+					tables->getMany(span);
+				}
+				std::vector<Chunk> chunks;
+				for (const auto& rec : records) {
+					if (rec.found) chunks.emplace_back(rec.data, rec.addr);
+				}
+				return chunks;
+			};
+			std::mutex lateMtx;
+			std::vector<Chunk> late; // newly live chunks that only an old table holds
+			marker.run(fetchLocked, [&](const Chunk& c) {
+				if (!copied.contains(c.hash()) &&
+					std::any_of(old.begin(), old.end(), [&](const std::shared_ptr<TableReader>& t) { return t->has(c.hash()); }))
+				{
+					std::lock_guard lateLock(lateMtx);
+					late.push_back(c);
+				}
+				return true;
+			});
+			if (!late.empty()) {
+				uint64_t size = 0;
+				for (const auto& c : late) {
+					size += c.size();
+				}
+				TableWriter tw(late.size(), size);
+				for (const auto& c : late) {
+					tw.addChunk(c.hash(), c.data());
+				}
+				result.bytesAfter += tw.recordBytes();
+				auto [name, data] = tw.finish();
+				written.push_back(persister->persist(name, data));
+				result.chunksKept += late.size();
+				result.chunksDropped -= late.size();
+			}
+
+			HashSet oldNames;
+			for (const auto& t : old) {
+				oldNames.insert(t->name());
+			}
+			ManifestContents newContents{ Hash(), upstream.root, {} };
+			for (const auto& spec : upstream.specs) {
+				if (!oldNames.contains(spec.name)) {
+					newContents.specs.push_back(spec);
+				}
+			}
+			for (const auto& t : written) {
+				newContents.specs.push_back(TableSpec{ t->name(), t->count() });
+			}
+			newContents.lock = generateLockHash(newContents.root, newContents.specs);
+			auto actual = manifest->update(upstream.lock, newContents);
+			updateUpstream(actual);
+			gc.reset();
+			const bool won = actual.lock == newContents.lock;
+			lock.unlock();
+
+			// delete whichever set of tables lost, except any the manifest still lists: a
+			// rewritten table can come out identical to an old one
+			HashSet listed;
+			for (const auto& spec : actual.specs) {
+				listed.insert(spec.name);
+			}
+			for (const auto& t : won ? old : written) {
+				if (!listed.contains(t->name())) {
+					persister->remove(t->name());
+				}
+			}
+			if (!won) {
+				throw std::runtime_error("Manifest was updated by another writer during garbage collection");
+			}
+			result.tablesRemoved = old.size();
+			result.tablesWritten = written.size();
+			return result;
+		}
+		catch (...) {
+			abandon();
+			throw;
+		}
+	}
+}
@@ -0,0 +1,243 @@
+#pragma once
+
+#include "common.h"
+#include "chunks/all.h"
+#include "mem_table.h"
+#include "table_reader.h"
+#include "table_persister.h"
+#include "manifest.h"
+#include "journal.h"
+#include "global_index.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace nomp {
+	constexpr uint64_t DefaultMemTableSize = 1ULL << 26; // 64 MiB
+	constexpr size_t DefaultMaxPendingFlushes = 2;
+	constexpr size_t DefaultOpenThreads = 4;
+
+	struct NbsOptions {
+		// Uncompressed bytes a memtable may hold before it is rotated out for flushing.
+		uint64_t memTableSize = DefaultMemTableSize;
+		// Number of full memtables that may wait for the flusher before put() blocks.
+		size_t maxPendingFlushes = DefaultMaxPendingFlushes;
+		// Directory of the write-ahead chunk journal, empty to run without one. With a
+		// journal, commit() only has to fsync the journal; tables are written and the
+		// manifest is updated in the background as memtables fill up. The store must
+		// then be the only writer of its manifest.
+		std::string journalDir;
+		// Keep a GlobalIndex over the manifest's tables, so reads that miss the memtables
+		// do one index search instead of one per table.
+		bool globalIndex = false;
+		// File to load the global index from on open and save it to on close, usually
+		// next to the manifest. Empty keeps it in memory only, rebuilt on every open.
+		std::string globalIndexFile;
+		// Threads used to open a batch of tables, such as every table of the manifest
+		// when the store opens, and to parse their indexes when that is done eagerly.
+		size_t openThreads = DefaultOpenThreads;
+		// Parse every table index in the background once the store is open, instead of
+		// each one on its first lookup.
+		bool preloadIndexes = false;
+		// Look up every chunk of a full memtable in the tables the store already has
+		// before writing it out, and leave out the ones found, so rewriting mostly
+		// unchanged data does not store it again.
+		bool dedupOnFlush = true;
+		// When set, each flushed table lays its chunks out in depth first order of the
+		// chunk graph found with this decoder, parents before children, instead of in
+		// the order they were put. Tree scans then read runs of adjacent records. The
+		// decoder must outlive the store.
+		interface::IRefDecoder* orderDecoder = nullptr;
+	};
+
+	constexpr uint64_t DefaultGcTableSize = 1ULL << 28; // 256 MiB
+
+	struct GcOptions {
+		// Chunks reachable from these are kept along with those reachable from the root.
+		std::vector<Hash> extraRoots;
+		size_t batchSize = 256; // addresses per getMany() while marking
+		size_t threads = 4; // batches read and decoded at once while marking
+		uint64_t tableSize = DefaultGcTableSize; // record bytes per table written
+		// Write the live chunks in depth first order from the roots rather than in the
+		// order of the tables they come from. Holds every live record and ref list in
+		// memory until the copy is done.
+		bool graphOrder = false;
+	};
+
+	struct GcResult {
+		size_t tablesRemoved = 0;
+		size_t tablesWritten = 0;
+		uint64_t chunksKept = 0; // live chunks copied out of the removed tables
+		uint64_t chunksDropped = 0;
+		uint64_t bytesBefore = 0; // record bytes in the removed tables
+		uint64_t bytesAfter = 0; // record bytes in the tables written
+	};
+
+	// TableSet is an immutable snapshot of everything a store reads from besides
+	// its active memtable, newest first within each group.
+	struct TableSet {
+		std::vector<std::shared_ptr<MemTable>> flushing; // full memtables waiting for the flusher
+		std::vector<std::shared_ptr<TableReader>> novel; // flushed, but not yet in the manifest
+		std::vector<std::shared_ptr<TableReader>> upstream; // listed in the manifest
+		std::shared_ptr<const GlobalIndex> index; // over upstream, if the store keeps one
+
+		bool has(const Hash& h) const;
+		// Returns true if any record is still not found.
+		bool hasMany(std::span<hasRecord>& records) const;
+		bool get(const Hash& h, ByteSlice& data) const;
+		// Returns true if any record is still not found.
+		bool getMany(std::span<getRecord>& records) const;
+	};
+
+	// NomsBlockStore is a ChunkStore that buffers puts in a memtable and writes full
+	// memtables out as tables on a background thread. Rotated memtables keep serving
+	// reads until their table has been persisted; commit() waits for all pending
+	// flushes and then publishes the new tables and root in the manifest. Commits
+	// that arrive while another is in progress are batched: they share one flush and
+	// one manifest update, and are applied in arrival order, so each one still
+	// succeeds iff its |last| is the root left by the commits before it.
+	//
+	// When NbsOptions::journalDir is set, puts are also appended to a ChunkJournal and
+	// commit() just makes the new root durable there. The flusher publishes each table
+	// in the manifest together with the root that was current when its memtable was
+	// rotated, after which the memtable's journal segment is retired.
+	class NomsBlockStore {
+		struct PendingFlush {
+			std::shared_ptr<MemTable> table;
+			uint64_t segment; // journal segment holding the memtable's chunks
+			std::optional<Hash> root; // root to publish with the table, journal mode only
+		};
+
+		// What a running collection has to mark on top of its roots, guarded by mtx.
+		struct GcState {
+			std::vector<Chunk> written; // chunks put since the collection started
+			std::vector<Hash> roots; // roots committed since the collection started
+		};
+
+		struct CommitRequest {
+			Hash newRoot;
+			Hash last;
+			std::optional<bool> result;
+			std::exception_ptr error;
+		};
+
+
+		interface::IManifest manifest;
+		interface::ITablePersister persister;
+		NbsOptions options;
+
+		mutable std::mutex mtx;
+		std::condition_variable flushReady; // signals the flusher
+		std::condition_variable flushDone; // signals writers waiting on the flusher
+		std::condition_variable commitDone; // signals committers waiting on a batch
+		std::shared_ptr<MemTable> mt;
+		std::deque<PendingFlush> flushing; // oldest first
+		std::vector<std::shared_ptr<TableReader>> novel;
+		std::shared_ptr<const TableSet> tables;
+		std::shared_ptr<const GlobalIndex> globalIndex;
+		std::shared_ptr<const GlobalIndex> savedIndex; // what globalIndexFile holds
+		ManifestContents upstream;
+		Hash currentRoot;
+		std::unique_ptr<ChunkJournal> journal;
+		std::exception_ptr flushError;
+		std::vector<CommitRequest*> commitQueue; // waiting for the next batch
+		bool committing = false;
+		bool closed = false;
+		std::thread flusher;
+		std::unique_ptr<GcState> gc; // set while collectGarbage runs
+		std::atomic<bool> stopPreload = false;
+		std::thread preloader;
+		StatsRecorder recorder;
+
+		void replayJournal();
+		void flushLoop();
+		ManifestContents publishFlush(const PendingFlush& flush, const std::shared_ptr<TableReader>& reader);
+		std::shared_ptr<TableReader> writeTable(MemTable& table, const TableSet* existing);
+		void rotateMemTable(std::unique_lock<std::mutex>& lock);
+		void waitForFlushes(std::unique_lock<std::mutex>& lock);
+		void checkFlushError();
+		void publishTables(std::vector<std::shared_ptr<TableReader>> upstreamTables);
+		void publishTables();
+		void updateUpstream(const ManifestContents& contents);
+		void commitBatch(std::unique_lock<std::mutex>& lock, std::span<CommitRequest* const> batch);
+
+	public:
+		NomsBlockStore(interface::IManifest manifest, interface::ITablePersister persister, NbsOptions options = {});
+		~NomsBlockStore();
+
+		bool has(const Hash& hash);
+		std::unique_ptr<HashSet> absent(const HashSet& hashes);
+		std::optional<Chunk> get(const Hash& hash);
+		std::vector<Chunk> getMany(const HashSet& hashes);
+		void put(const Chunk& chunk);
+		std::string_view version() {
+			return nomp::NOMP_VERSION;
+		}
+		void rebase();
+		Hash root();
+		bool commit(const Hash& newRoot, const Hash& last);
+		StoreStats stats() const {
+			return recorder.snapshot();
+		}
+		std::string statsSummary() const {
+			return stats().summary();
+		}
+		void close();
+
+		// Returns the manifest as of the last commit, rebase or flush.
+		ManifestContents manifestContents() const;
+		// Opens table |name| of this store's persister.
+		std::shared_ptr<TableReader> openTable(const Hash& name);
+		// Writes a copy of the existing table |name| read from |src| to this store's
+		// persister. The copy is not part of the store until passed to addTables().
+		std::shared_ptr<TableReader> copyTable(const Hash& name, interface::IReaderAt& src);
+		// Moves the complete, synced table file at |path| into this store's persister
+		// as table |name|, see ITablePersister::adopt. Like a copy, the table is not
+		// part of the store until passed to addTables().
+		std::shared_ptr<TableReader> adoptTable(const Hash& name, const std::string& path);
+		// Deletes a table made by copyTable() or adoptTable() that is not to be passed
+		// to addTables().
+		void removeTable(const Hash& name);
+		// Adds persisted tables to the manifest, keeping its root. Tables the manifest
+		// already lists are skipped.
+		void addTables(std::span<const std::shared_ptr<TableReader>> readers);
+
+		// Removes the chunks of the manifest's tables that are not reachable from the
+		// root or options.extraRoots, using |decoder| to follow refs. Live chunks are
+		// copied into new tables as their compressed records, the manifest is switched
+		// over to them in one update and the old tables are deleted.
+		//
+		// Reads, puts and commits go on while it runs: chunks put in the meantime, and
+		// everything reachable from them or from newly committed roots, are kept. A
+		// chunk that was already unreachable when the collection started may be removed
+		// even if has() reported it during the collection, so writers must put, or
+		// reach from a committed root, every chunk they refer to. Not supported with a
+		// journal, and the store must be the only writer of its manifest meanwhile.
+		GcResult collectGarbage(interface::IRefDecoder& decoder, const GcOptions& options = {});
+	};
+
+	// NbsMemoryStoreFactory vends NomsBlockStores backed by an in-memory manifest and
+	// table persister per path, so stores created for the same path share state.
+	struct NbsMemoryStoreFactory {
+		struct Backing {
+			MemoryManifest manifest;
+			MemoryTablePersister persister;
+		};
+		std::unordered_map<std::string, Backing> stores;
+		NbsOptions options;
+		std::mutex mtx;
+
+		NbsMemoryStoreFactory() = default;
+		explicit NbsMemoryStoreFactory(NbsOptions options) : options(options) {}
+
+		interface::IChunkStore createStore(const std::string& path);
+		void shutdown() {
+		}
+	};
+}
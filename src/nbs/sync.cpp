@@ -0,0 +1,83 @@
+#include "sync.h"
+#include "parallel.h"
+#include <stdexcept>
+#include <vector>
+
+namespace nomp {
+	// A table's name is the hash of the address suffixes in its index, see
+	// TableWriter::finish.
+	static void verifyTable(TableReader& table, const TableSpec& spec, bool verifyChunks) {
+		const auto& index = table.tableIndex();
+		if (index.count() != spec.chunkCount) {
+			throw std::runtime_error("Copied table " + spec.name.toString() + " has " + std::to_string(index.count()) +
+				" chunks, the manifest lists " + std::to_string(spec.chunkCount));
+		}
+		if (Hash::Of(std::span<const std::byte>(index.suffixes)) != spec.name) {
+			throw std::runtime_error("Copied table " + spec.name.toString() + " does not match its name");
+		}
+		if (!verifyChunks) {
+			return;
+		}
+		std::vector<extractRecord> records;
+		table.extract(records);
+		for (const auto& rec : records) {
+			if (rec.err != 0 || Hash::Of(rec.data) != rec.addr) {
+				throw std::runtime_error("Copied table " + spec.name.toString() + " holds a corrupt chunk " + rec.addr.toString());
+			}
+		}
+	}
+
+	TableSyncResult syncTables(NomsBlockStore& src, NomsBlockStore& sink, const TableSyncOptions& options) {
+		const auto srcContents = src.manifestContents();
+		const auto sinkContents = sink.manifestContents();
+		HashSet present;
+		for (const auto& spec : sinkContents.specs) {
+			present.insert(spec.name);
+		}
+		std::vector<TableSpec> missing;
+		TableSyncResult result;
+		result.root = srcContents.root;
+		for (const auto& spec : srcContents.specs) {
+			if (present.contains(spec.name)) {
+				++result.tablesShared;
+			}
+			else {
+				missing.push_back(spec);
+			}
+		}
+
+		std::vector<std::shared_ptr<TableReader>> copies(missing.size());
+		std::atomic<uint64_t> bytes = 0;
+		parallelFor(missing.size(), options.copyThreads, [&](size_t i) {
+			auto original = src.openTable(missing[i].name);
+			copies[i] = sink.copyTable(missing[i].name, original->bytes());
+			try {
+				verifyTable(*copies[i], missing[i], options.verifyChunks);
+			}
+			catch (...) {
+				// the copy is already in place under the table's name, do not leave it
+				// for a later sync or open to pick up
+				copies[i].reset();
+				sink.removeTable(missing[i].name);
+				throw;
+			}
+			bytes += original->bytes()->size();
+		});
+		// only verified copies get here, a failure above leaves the manifest untouched
+		sink.addTables(copies);
+		result.tablesCopied = copies.size();
+		result.bytesCopied = bytes;
+		return result;
+	}
+
+	SyncResult sync(NomsBlockStore& src, NomsBlockStore& sink, const Hash& root,
+		interface::IRefDecoder& decoder, const SyncOptions& options)
+	{
+		SyncResult result;
+		result.tables = syncTables(src, sink, options.tables);
+		interface::IChunkStore srcStore = &src;
+		interface::IChunkStore sinkStore = &sink;
+		result.pull = pull(srcStore, sinkStore, root, decoder, options.pull);
+		return result;
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include "common.h"
+#include "chunks/all.h"
+#include "store.h"
+#include <cstdint>
+
+namespace nomp {
+	struct TableSyncOptions {
+		size_t copyThreads = 4; // tables copied at once
+		// Also rehash every chunk of a copied table. Without it a copy is checked
+		// against its name, which covers the addresses in its index but not the data.
+		bool verifyChunks = false;
+	};
+
+	struct TableSyncResult {
+		size_t tablesCopied = 0;
+		size_t tablesShared = 0; // source tables the sink already had
+		uint64_t bytesCopied = 0;
+		Hash root; // the source manifest's root, whose chunks the sink now holds
+	};
+
+	// Copies the tables in |src|'s manifest that |sink|'s lacks, file by file,
+	// verifies each copy and adds them to |sink|'s manifest. The sink's root is left
+	// alone. Run it while the sink is empty or far behind: it moves whole tables, so
+	// it also copies chunks the sink already has in other tables.
+	TableSyncResult syncTables(NomsBlockStore& src, NomsBlockStore& sink, const TableSyncOptions& options = {});
+
+	struct SyncOptions {
+		TableSyncOptions tables;
+		PullOptions pull;
+	};
+
+	struct SyncResult {
+		TableSyncResult tables;
+		PullProgress pull;
+	};
+
+	// Brings |sink| up to |root| of |src|: syncTables() first, then a chunk-level
+	// pull of whatever |root| reaches that the tables did not cover, such as chunks
+	// committed to |src| after its manifest was read. As with pull, the caller
+	// commits |root| to the sink afterwards.
+	SyncResult sync(NomsBlockStore& src, NomsBlockStore& sink, const Hash& root,
+		interface::IRefDecoder& decoder, const SyncOptions& options = {});
+}
@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+
+#include "sync.h"
+#include "test_util.h"
+#include <filesystem>
+#include <string>
+#include <vector>
+
+using namespace nomp;
+
+namespace {
+	// Puts a root over |n| leaves of |size| bytes into |store| and returns its hash.
+	Hash putTree(NomsBlockStore& store, size_t n, size_t size, const std::string& salt, std::vector<Hash>& all) {
+		std::vector<Hash> leaves;
+		for (size_t i = 0; i < n; ++i) {
+			auto payload = salt + std::to_string(i);
+			payload.resize(size, 'x');
+			auto leaf = RefListDecoder::encode({}, std::span{ (const std::byte*)payload.data(), payload.size() });
+			store.put(leaf);
+			leaves.push_back(leaf.hash());
+			all.push_back(leaf.hash());
+		}
+		auto root = RefListDecoder::encode(leaves);
+		store.put(root);
+		all.push_back(root.hash());
+		return root.hash();
+	}
+}
+
+TEST(SyncTest, TestSyncCopiesTablesThenPullsTheRest) {
+	const auto srcDir = test::tempDir("nomp_sync_src");
+	const auto sinkDir = test::tempDir("nomp_sync_sink");
+	MemoryManifest srcManifest, sinkManifest;
+	FileTablePersister srcPersister(srcDir), sinkPersister(sinkDir);
+	NomsBlockStore src(pro::make_proxy<interface::Manifest, MemoryManifest>(srcManifest),
+		pro::make_proxy<interface::TablePersister, FileTablePersister>(srcPersister), NbsOptions{ 8192, 2 });
+	interface::IRefDecoder decoder = pro::make_proxy<interface::RefDecoder, RefListDecoder>();
+
+	std::vector<Hash> committed;
+	const auto root = putTree(src, 200, 200, "a", committed);
+	ASSERT_TRUE(src.commit(root, src.root()));
+	const auto tables = src.manifestContents().specs.size();
+	ASSERT_GT(tables, 1u);
+
+	// chunks put after the commit are not in any listed table and have to be pulled
+	std::vector<Hash> added;
+	const auto newRoot = putTree(src, 10, 100, "b", added);
+
+	{
+		NomsBlockStore sink(pro::make_proxy<interface::Manifest, MemoryManifest>(sinkManifest),
+			pro::make_proxy<interface::TablePersister, FileTablePersister>(sinkPersister));
+		SyncOptions options;
+		options.tables.verifyChunks = true;
+		auto result = sync(src, sink, newRoot, decoder, options);
+		EXPECT_EQ(result.tables.tablesCopied, tables);
+		EXPECT_EQ(result.tables.tablesShared, 0u);
+		EXPECT_EQ(result.tables.root, root);
+		EXPECT_GT(result.tables.bytesCopied, 0u);
+		EXPECT_EQ(result.pull.chunksWritten, added.size());
+		ASSERT_TRUE(sink.commit(newRoot, sink.root()));
+
+		// a second sync has nothing to copy
+		auto again = syncTables(src, sink);
+		EXPECT_EQ(again.tablesCopied, 0u);
+		EXPECT_EQ(again.tablesShared, tables);
+		sink.close();
+	}
+
+	NomsBlockStore reopened(pro::make_proxy<interface::Manifest, MemoryManifest>(sinkManifest),
+		pro::make_proxy<interface::TablePersister, FileTablePersister>(sinkPersister));
+	EXPECT_EQ(reopened.root(), newRoot);
+	for (const auto& h : committed) {
+		EXPECT_TRUE(reopened.has(h));
+	}
+	for (const auto& h : added) {
+		EXPECT_TRUE(reopened.has(h));
+	}
+	src.close();
+	reopened.close();
+	std::filesystem::remove_all(srcDir);
+	std::filesystem::remove_all(sinkDir);
+}
+
+TEST(SyncTest, TestSyncRejectsMisnamedTable) {
+	MemoryManifest srcManifest, sinkManifest;
+	MemoryTablePersister srcPersister, sinkPersister;
+	NomsBlockStore src(pro::make_proxy<interface::Manifest, MemoryManifest>(srcManifest),
+		pro::make_proxy<interface::TablePersister, MemoryTablePersister>(srcPersister));
+	std::vector<Hash> all;
+	const auto root = putTree(src, 20, 50, "c", all);
+	ASSERT_TRUE(src.commit(root, src.root()));
+
+	// list a good table under the wrong name
+	auto contents = srcManifest.fetch().value();
+	auto table = srcPersister.open(contents.specs[0].name);
+	const auto wrongName = Hash::Of(std::span<const std::byte>{});
+	srcPersister.persistFrom(wrongName, table->bytes());
+	ManifestContents tampered{ Hash(), contents.root, { TableSpec{ wrongName, contents.specs[0].chunkCount } } };
+	tampered.lock = generateLockHash(tampered.root, tampered.specs);
+	srcManifest.update(contents.lock, tampered);
+	src.rebase();
+
+	NomsBlockStore sink(pro::make_proxy<interface::Manifest, MemoryManifest>(sinkManifest),
+		pro::make_proxy<interface::TablePersister, MemoryTablePersister>(sinkPersister));
+	EXPECT_THROW(syncTables(src, sink), std::runtime_error);
+	EXPECT_TRUE(sink.manifestContents().specs.empty());
+	EXPECT_THROW(sinkPersister.open(wrongName), std::runtime_error);
+	EXPECT_FALSE(sink.has(root));
+	src.close();
+	sink.close();
+}
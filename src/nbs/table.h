@@ -18,8 +18,20 @@ namespace nomp {
 	constexpr uint64_t MagicNumber = 0xFFB5D8C22463EE50;
 	constexpr size_t MagicNumberSize = 8; // bytes
 	constexpr size_t FooterSize = Uint32Size + Uint64Size + MagicNumberSize;
+
+	// Format v2 widens offsets to 64 bits and records the format version, codec and
+	// feature flags in the footer. Writers only use it when a table needs it.
+	constexpr uint64_t MagicNumberV2 = 0xFFB5D8C22463EE52;
+	constexpr size_t OffsetSizeV2 = Uint64Size; // bytes
+	constexpr size_t FormatInfoSize = 4; // [version u8][codec u8][flags u16]
+	constexpr size_t FooterSizeV2 = Uint32Size + Uint64Size + FormatInfoSize + MagicNumberSize;
+	constexpr uint8_t TableFormatV1 = 1;
+	constexpr uint8_t TableFormatV2 = 2;
+	constexpr uint8_t TableCodecLZ4 = 1;
+	constexpr uint16_t TableFlagsSupported = 0; // readers reject tables with any other flag set
 	constexpr size_t PrefixTupleSize = PrefixSize + OrdinalSize;
 	constexpr size_t CheckSumSize = Uint32Size;
+	constexpr size_t RawLengthSize = Uint32Size; // uncompressed length prefix of each chunk record
 	constexpr size_t MaxChunkSize = 0xffffffff;
 
 
@@ -0,0 +1,133 @@
+#include "table_persister.h"
+#include <algorithm>
+#include <filesystem>
+#include <vector>
+
+namespace nomp {
+	static void checkTablePersister() {
+		pro::make_proxy<interface::TablePersister, MemoryTablePersister>();
+		pro::make_proxy<interface::TablePersister, FileTablePersister>(std::string());
+	}
+
+	std::shared_ptr<TableReader> MemoryTablePersister::persist(const Hash& name, const ByteSlice& data) {
+		{
+			std::lock_guard lock(tables->mtx);
+			tables->data[name] = data;
+		}
+		return std::make_shared<TableReader>(name, pro::make_proxy<interface::ReaderAt, ByteSliceReaderAt>(data), layout);
+	}
+
+	std::shared_ptr<TableReader> MemoryTablePersister::open(const Hash& name) {
+		ByteSlice data;
+		{
+			std::lock_guard lock(tables->mtx);
+			auto it = tables->data.find(name);
+			if (it == tables->data.end()) {
+				throw std::runtime_error("Table not found: " + name.toString());
+			}
+			data = it->second;
+		}
+		return std::make_shared<TableReader>(name, pro::make_proxy<interface::ReaderAt, ByteSliceReaderAt>(data), layout);
+	}
+
+	std::shared_ptr<TableReader> MemoryTablePersister::persistFrom(const Hash& name, interface::IReaderAt& src) {
+		ByteSlice data(src->size());
+		if (src->readAt(data.span(), 0) != data.size()) {
+			throw std::runtime_error("Short read copying table " + name.toString());
+		}
+		return persist(name, data);
+	}
+
+	std::shared_ptr<TableReader> MemoryTablePersister::adopt(const Hash& name, const std::string& path) {
+		ByteSlice data;
+		{
+			auto file = File::open(path, FileMode::Read);
+			data = ByteSlice(size_t(file.size()));
+			if (file.readAt(data.span(), 0) != data.size()) {
+				throw std::runtime_error("Short read adopting table " + name.toString() + " from " + path);
+			}
+		}
+		std::filesystem::remove(path);
+		return persist(name, data);
+	}
+
+	void MemoryTablePersister::remove(const Hash& name) {
+		std::lock_guard lock(tables->mtx);
+		tables->data.erase(name);
+	}
+
+	FileTablePersister::FileTablePersister(const std::string& dir, interface::IIoBackend backend, IndexLayout layout) :
+		dir(dir), backend(std::move(backend)), layout(layout)
+	{
+		if (!dir.empty()) {
+			std::filesystem::create_directories(dir);
+		}
+	}
+
+	std::string FileTablePersister::tablePath(const Hash& name) const {
+		return (std::filesystem::path(dir) / name.toString()).string();
+	}
+
+	std::shared_ptr<TableReader> FileTablePersister::persist(const Hash& name, const ByteSlice& data) {
+		const auto path = tablePath(name);
+		const auto tmpPath = path + ".tmp";
+		{
+			auto file = backend->openFile(tmpPath, FileMode::Create);
+			backend->writeAt(file, data.span(), 0);
+			file.sync();
+		}
+		renameDurable(tmpPath, path);
+		return open(name);
+	}
+
+	std::shared_ptr<TableReader> FileTablePersister::open(const Hash& name) {
+		auto file = std::make_shared<File>(backend->openFile(tablePath(name), FileMode::Read));
+		return std::make_shared<TableReader>(name, pro::make_proxy<interface::ReaderAt, FileReaderAt>(std::move(file), backend), layout);
+	}
+
+	std::shared_ptr<TableReader> FileTablePersister::persistFrom(const Hash& name, interface::IReaderAt& src) {
+		const auto path = tablePath(name);
+		const auto tmpPath = path + ".tmp";
+		{
+			auto file = backend->openFile(tmpPath, FileMode::Create);
+			const uint64_t size = src->size();
+			std::vector<std::byte> block(std::min<uint64_t>(size, CopyBlockSize));
+			for (uint64_t offset = 0; offset < size;) {
+				const auto n = std::min<uint64_t>(block.size(), size - offset);
+				const std::span<std::byte> buf(block.data(), n);
+				if (src->readAt(buf, offset) != n) {
+					throw std::runtime_error("Short read copying table " + name.toString() + " at offset " + std::to_string(offset));
+				}
+				backend->writeAt(file, buf, offset);
+				offset += n;
+			}
+			file.sync();
+		}
+		renameDurable(tmpPath, path);
+		return open(name);
+	}
+
+	std::shared_ptr<TableReader> FileTablePersister::adopt(const Hash& name, const std::string& path) {
+		const auto to = tablePath(name);
+		std::error_code ec;
+		std::filesystem::rename(path, to, ec);
+		if (!ec) {
+			syncDirectory(std::filesystem::path(to).parent_path().string());
+			return open(name);
+		}
+		// most likely on another filesystem
+		std::shared_ptr<TableReader> reader;
+		{
+			auto file = std::make_shared<File>(backend->openFile(path, FileMode::Read));
+			interface::IReaderAt src = pro::make_proxy<interface::ReaderAt, FileReaderAt>(std::move(file), backend);
+			reader = persistFrom(name, src);
+		}
+		std::filesystem::remove(path);
+		return reader;
+	}
+
+	void FileTablePersister::remove(const Hash& name) {
+		std::error_code ec;
+		std::filesystem::remove(tablePath(name), ec);
+	}
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "common.h"
+#include "table_reader.h"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace nomp {
+	namespace interface {
+		PRO_DEF_MEM_DISPATCH(MemPersist, persist);
+		PRO_DEF_MEM_DISPATCH(MemOpen, open);
+		PRO_DEF_MEM_DISPATCH(MemPersistFrom, persistFrom);
+		PRO_DEF_MEM_DISPATCH(MemAdopt, adopt);
+		PRO_DEF_MEM_DISPATCH(MemRemove, remove);
+
+		// TablePersister is where a store keeps its immutable table files.
+		// Implementations must be safe to call from multiple threads at once.
+		struct TablePersister : pro::facade_builder
+			// Durably writes the table |data| named |name| and returns a reader over it.
+			::add_convention<MemPersist, std::shared_ptr<TableReader>(const Hash& name, const ByteSlice& data)>
+			// Opens the previously persisted table |name|.
+			::add_convention<MemOpen, std::shared_ptr<TableReader>(const Hash& name)>
+			// Durably writes a copy of the existing table |name| read from |src|, and
+			// returns a reader over the copy.
+			::add_convention<MemPersistFrom, std::shared_ptr<TableReader>(const Hash& name, interface::IReaderAt& src)>
+			// Takes over the complete, synced table file at |path| as table |name| and
+			// returns a reader over it. The file is gone afterwards.
+			::add_convention<MemAdopt, std::shared_ptr<TableReader>(const Hash& name, const std::string& path)>
+			// Deletes table |name|. Readers already open on it keep working.
+			::add_convention<MemRemove, void(const Hash& name)>
+			::build {
+		};
+		using ITablePersister = pro::proxy<TablePersister>;
+	}
+
+	// MemoryTablePersister keeps tables in memory. Copies share the same tables,
+	// so several stores can be opened against one set of "files".
+	class MemoryTablePersister {
+		struct Tables {
+			std::unordered_map<Hash, ByteSlice, Hash::Hasher> data;
+			std::mutex mtx;
+		};
+		std::shared_ptr<Tables> tables;
+		IndexLayout layout;
+	public:
+		explicit MemoryTablePersister(IndexLayout layout = IndexLayout::Dense) : tables(std::make_shared<Tables>()), layout(layout) {}
+
+		std::shared_ptr<TableReader> persist(const Hash& name, const ByteSlice& data);
+		std::shared_ptr<TableReader> open(const Hash& name);
+		std::shared_ptr<TableReader> persistFrom(const Hash& name, interface::IReaderAt& src);
+		std::shared_ptr<TableReader> adopt(const Hash& name, const std::string& path);
+		void remove(const Hash& name);
+	};
+
+	constexpr size_t CopyBlockSize = 4 << 20; // 4 MiB
+
+	// FileTablePersister keeps each table in its own file in |dir|, named after the
+	// table hash. Tables are written to a temporary file, synced and renamed into place.
+	class FileTablePersister {
+		std::string dir;
+		interface::IIoBackend backend;
+		IndexLayout layout;
+	public:
+		FileTablePersister(const std::string& dir, interface::IIoBackend backend, IndexLayout layout = IndexLayout::Dense);
+		explicit FileTablePersister(const std::string& dir, IndexLayout layout = IndexLayout::Dense) :
+			FileTablePersister(dir, makeIoBackend(), layout) {}
+
+		std::shared_ptr<TableReader> persist(const Hash& name, const ByteSlice& data);
+		std::shared_ptr<TableReader> open(const Hash& name);
+		// Streams |src| into the file in CopyBlockSize pieces, so tables of any size
+		// are copied without being held in memory.
+		std::shared_ptr<TableReader> persistFrom(const Hash& name, interface::IReaderAt& src);
+		// Renames the file into place when it is on the same filesystem as |dir|, and
+		// copies it otherwise.
+		std::shared_ptr<TableReader> adopt(const Hash& name, const std::string& path);
+		// On Windows a table cannot be deleted while it is open; such tables are left
+		// behind.
+		void remove(const Hash& name);
+		std::string tablePath(const Hash& name) const;
+	};
+}
@@ -0,0 +1,342 @@
+#include "table_reader.h"
+#include "binary/all.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace nomp {
+	static void checkTableReader() {
+		pro::make_proxy<interface::ReaderAt, ByteSliceReaderAt>(ByteSlice());
+		pro::make_proxy<interface::RawChunkReader, TableReader>(Hash(),
+			interface::IReaderAt(pro::make_proxy<interface::ReaderAt, ByteSliceReaderAt>(ByteSlice())));
+	}
+
+	size_t ByteSliceReaderAt::readAt(std::span<std::byte> buf, uint64_t offset) {
+		if (offset >= data.size()) {
+			return 0;
+		}
+		auto n = std::min<uint64_t>(buf.size(), data.size() - offset);
+		auto src = data.subSpan(offset, n);
+		std::copy(src.begin(), src.end(), buf.begin());
+		return n;
+	}
+
+	static void readFull(interface::IReaderAt& reader, std::span<std::byte> buf, uint64_t offset) {
+		auto n = reader->readAt(buf, offset);
+		if (n != buf.size()) {
+			throw std::runtime_error("Short table read at offset " + std::to_string(offset) + ", expected " + std::to_string(buf.size()) + " bytes, got " + std::to_string(n));
+		}
+	}
+
+	// out[0] = 0, out[i + 1] = out[i] + lengths[i]
+	static void prefixSum(std::span<const uint32_t> lengths, std::span<uint64_t> out) {
+		out[0] = 0;
+		size_t i = 0;
+#if defined(__AVX2__)
+		const __m256i zero = _mm256_setzero_si256();
+		__m256i carry = zero;
+		for (; i + 4 <= lengths.size(); i += 4) {
+			// in-register scan of four lengths, widened to 64 bits: [a, a+b, a+b+c, a+b+c+d]
+			__m256i x = _mm256_cvtepu32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(lengths.data() + i)));
+			x = _mm256_add_epi64(x, _mm256_blend_epi32(_mm256_permute4x64_epi64(x, _MM_SHUFFLE(2, 1, 0, 0)), zero, 0x03));
+			x = _mm256_add_epi64(x, _mm256_blend_epi32(_mm256_permute4x64_epi64(x, _MM_SHUFFLE(1, 0, 0, 0)), zero, 0x0F));
+			x = _mm256_add_epi64(x, carry);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(out.data() + i + 1), x);
+			carry = _mm256_permute4x64_epi64(x, _MM_SHUFFLE(3, 3, 3, 3));
+		}
+#endif
+		for (; i < lengths.size(); ++i) {
+			out[i + 1] = out[i] + lengths[i];
+		}
+	}
+
+	TableFooter TableFooter::read(interface::IReaderAt& reader) {
+		const uint64_t tableSize = reader->size();
+		if (tableSize < FooterSize) {
+			throw std::runtime_error("Table too small to contain a footer");
+		}
+		// both footers end in a magic number that tells them apart
+		std::byte buf[FooterSizeV2];
+		const size_t tail = size_t(std::min<uint64_t>(tableSize, FooterSizeV2));
+		readFull(reader, std::span{ buf + FooterSizeV2 - tail, tail }, tableSize - tail);
+		std::span<const std::byte> fs{ buf, FooterSizeV2 };
+		const uint64_t magic = BigEndian::uint64(fs.subspan(FooterSizeV2 - MagicNumberSize));
+
+		TableFooter footer;
+		if (magic == MagicNumber) {
+			fs = fs.subspan(FooterSizeV2 - FooterSize);
+		}
+		else if (magic == MagicNumberV2 && tail == FooterSizeV2) {
+			const auto info = fs.subspan(Uint32Size + Uint64Size);
+			footer.version = uint8_t(info[0]);
+			footer.codec = uint8_t(info[1]);
+			footer.flags = BigEndian::uint16(info.subspan(2));
+			if (footer.version != TableFormatV2) {
+				throw std::runtime_error("Unsupported table format version " + std::to_string(footer.version));
+			}
+			if ((footer.flags & ~TableFlagsSupported) != 0) {
+				throw std::runtime_error("Unsupported table feature flags " + std::to_string(footer.flags));
+			}
+		}
+		else {
+			throw std::runtime_error("Invalid table magic number");
+		}
+		footer.count = BigEndian::uint32(fs);
+		footer.totalUncompressed = BigEndian::uint64(fs.subspan(Uint32Size));
+		if (TableIndex::indexSize(footer.count, footer.version) > tableSize) {
+			throw std::runtime_error("Table index larger than table, chunk count " + std::to_string(footer.count));
+		}
+		return footer;
+	}
+
+	TableIndex TableIndex::parse(interface::IReaderAt& reader, IndexLayout layout) {
+		return parse(reader, TableFooter::read(reader), layout);
+	}
+
+	TableIndex TableIndex::parse(interface::IReaderAt& reader, const TableFooter& footer, IndexLayout layout) {
+		const uint64_t tableSize = reader->size();
+		TableIndex index;
+		index.version = footer.version;
+		index.codec = footer.codec;
+		index.flags = footer.flags;
+		index.totalUncompressed = footer.totalUncompressed;
+		const uint32_t count = footer.count;
+		const size_t footerSize = index.version == TableFormatV1 ? FooterSize : FooterSizeV2;
+		const size_t offsetSize = index.version == TableFormatV1 ? OffsetSize : OffsetSizeV2;
+		const uint64_t size = indexSize(count, index.version);
+		std::vector<std::byte> buf(size - footerSize);
+		readFull(reader, buf, tableSize - size);
+		std::span<const std::byte> is{ buf };
+
+		index.prefixes.resize(count);
+		index.ordinals.resize(count);
+		// the buffer is exactly the index size, so the per-tuple loads need no checks
+		for (uint32_t i = 0; i < count; ++i) {
+			index.prefixes[i] = BigEndian::loadUint64(is.data() + size_t(i) * PrefixTupleSize);
+			index.ordinals[i] = BigEndian::loadUint32(is.data() + size_t(i) * PrefixTupleSize + PrefixSize);
+		}
+		auto lengthSection = is.subspan(count * PrefixTupleSize);
+		std::vector<uint32_t> lengths(count);
+		BigEndian::readUint32s(lengthSection, lengths);
+		std::vector<uint64_t> offsets(size_t(count) + 1);
+		prefixSum(lengths, offsets);
+		if (offsets.back() > tableSize - size) {
+			throw std::runtime_error("Table records overlap the index, chunk count " + std::to_string(count));
+		}
+		index.layout = layout;
+		if (layout == IndexLayout::Dense) {
+			index.offsets = std::move(offsets);
+		}
+		else {
+			index.packedOffsets = EliasFano(offsets);
+		}
+		auto suffixes = lengthSection.subspan(count * (LengthSize + offsetSize), count * SuffixSize);
+		index.suffixes.assign(suffixes.begin(), suffixes.end());
+		index.filter = PrefixFilter(index.prefixes);
+		return index;
+	}
+
+	std::optional<uint32_t> TableIndex::lookup(const Hash& h) const {
+		const auto prefix = h.prefix();
+		if (!filter.mayContain(prefix)) {
+			return std::nullopt;
+		}
+		auto it = std::lower_bound(prefixes.begin(), prefixes.end(), prefix);
+		for (; it != prefixes.end() && *it == prefix; ++it) {
+			const auto ordinal = ordinals[it - prefixes.begin()];
+			if (matches(ordinal, h)) {
+				return ordinal;
+			}
+		}
+		return std::nullopt;
+	}
+
+	bool TableIndex::matches(uint32_t ordinal, const Hash& h) const {
+		std::span<const std::byte> addr = h;
+		return std::memcmp(suffixes.data() + size_t(ordinal) * SuffixSize, addr.data() + PrefixSize, SuffixSize) == 0;
+	}
+
+	size_t TableIndex::memoryUsage() const {
+		return prefixes.capacity() * sizeof(uint64_t) + ordinals.capacity() * sizeof(uint32_t) + suffixes.capacity() +
+			offsets.capacity() * sizeof(uint64_t) + packedOffsets.memoryUsage() + filter.memoryUsage();
+	}
+
+	TableReader::TableReader(const Hash& name, interface::IReaderAt reader, interface::IDecompresser decomp, IndexLayout layout) :
+		tableName(name),
+		footer(TableFooter::read(reader)),
+		layout(layout),
+		reader(std::move(reader)),
+		decompresser(std::move(decomp))
+	{
+		if (footer.codec != TableCodecLZ4) {
+			throw std::runtime_error("Unsupported codec " + std::to_string(footer.codec) + " in table " + name.toString());
+		}
+	}
+
+	void TableReader::loadIndex() const {
+		std::lock_guard lock(indexMtx);
+		if (indexReady.load(std::memory_order_relaxed)) {
+			return;
+		}
+		parsedIndex = TableIndex::parse(reader, footer, layout);
+		indexReady.store(true, std::memory_order_release);
+	}
+
+	ByteSlice TableReader::readChunk(uint32_t ordinal) {
+		const auto [offset, length] = index().record(ordinal);
+		ByteSlice record(length);
+		readFull(reader, record.span(), offset);
+		return decodeChunk(ordinal, record);
+	}
+
+	// verifies and decompresses the record [uncompressed length][compressed data][crc32] of |ordinal|
+	ByteSlice TableReader::decodeChunk(uint32_t ordinal, const ByteSlice& record) {
+		const auto length = index().record(ordinal).second;
+		if (length < RawLengthSize + CheckSumSize || record.size() != length) {
+			throw std::runtime_error("Corrupt chunk record in table " + tableName.toString());
+		}
+		const auto body = record.subSpan(0, length - CheckSumSize);
+		if (crc32(body) != BigEndian::uint32(record.subSpan(length - CheckSumSize))) {
+			throw std::runtime_error("Checksum mismatch in table " + tableName.toString());
+		}
+		ByteSlice data(BigEndian::uint32(body));
+		auto n = decompresser->decompressInplace(record.subSlice(RawLengthSize, length - RawLengthSize - CheckSumSize), data.span());
+		if (n != data.size()) {
+			throw std::runtime_error("Chunk length mismatch in table " + tableName.toString());
+		}
+		return data;
+	}
+
+	bool TableReader::hasMany(std::span<hasRecord>& records) {
+		bool remaining = false;
+		for (auto& rec : records) {
+			if (rec.has) {
+				continue;
+			}
+			if (has(rec.addr)) {
+				rec.has = true;
+			}
+			else {
+				remaining = true;
+			}
+		}
+		return remaining;
+	}
+
+	bool TableReader::get(const Hash& hash, ByteSlice& data) {
+		auto ordinal = index().lookup(hash);
+		if (!ordinal.has_value()) {
+			return false;
+		}
+		data = readChunk(ordinal.value());
+		return true;
+	}
+
+	// Looks up every record first, then fetches all the chunks this table holds with
+	// a single batched read, in file order.
+	bool TableReader::getMany(std::span<getRecord>& records) {
+		bool remaining = false;
+		std::vector<OrdinalRecord> hits;
+		for (auto& rec : records) {
+			if (rec.found) {
+				continue;
+			}
+			auto ordinal = index().lookup(rec.addr);
+			if (ordinal.has_value()) {
+				hits.push_back(OrdinalRecord{ &rec, ordinal.value() });
+			}
+			else {
+				remaining = true;
+			}
+		}
+		getOrdinals(hits);
+		return remaining;
+	}
+
+	void TableReader::getOrdinals(std::span<OrdinalRecord> hits) {
+		if (hits.empty()) {
+			return;
+		}
+		// records are laid out in ordinal order
+		std::sort(hits.begin(), hits.end(), [](const OrdinalRecord& a, const OrdinalRecord& b) {
+			return a.ordinal < b.ordinal;
+		});
+		std::vector<ByteSlice> buffers;
+		std::vector<ReadRequest> requests;
+		buffers.reserve(hits.size());
+		requests.reserve(hits.size());
+		for (const auto& hit : hits) {
+			const auto [offset, length] = index().record(hit.ordinal);
+			buffers.emplace_back(size_t(length));
+			requests.emplace_back(ReadRequest{ offset, buffers.back().span(), 0 });
+		}
+		reader->readManyAt(requests);
+		for (size_t i = 0; i < hits.size(); ++i) {
+			if (requests[i].bytesRead != requests[i].buf.size()) {
+				throw std::runtime_error("Short table read at offset " + std::to_string(requests[i].offset) + " in table " + tableName.toString());
+			}
+			hits[i].rec->data = decodeChunk(hits[i].ordinal, buffers[i]);
+			hits[i].rec->found = true;
+		}
+	}
+
+	// Calls f(ordinal, address) for every chunk in ordinal order.
+	template <typename F>
+	static void forEachAddress(const TableIndex& idx, F&& f) {
+		const uint32_t count = idx.count();
+		std::vector<uint64_t> prefixByOrdinal(count);
+		for (uint32_t i = 0; i < count; ++i) {
+			prefixByOrdinal[idx.ordinals[i]] = idx.prefixes[i];
+		}
+		std::array<char, AddrSize> addr;
+		for (uint32_t ordinal = 0; ordinal < count; ++ordinal) {
+			BigEndian::writeUint64(std::span<std::byte>{ (std::byte*)addr.data(), PrefixSize }, prefixByOrdinal[ordinal]);
+			std::memcpy(addr.data() + PrefixSize, idx.suffixes.data() + size_t(ordinal) * SuffixSize, SuffixSize);
+			f(ordinal, Hash(addr));
+		}
+	}
+
+	void TableReader::extract(std::vector<extractRecord>& out) {
+		forEachAddress(index(), [&](uint32_t ordinal, Hash addr) {
+			out.emplace_back(extractRecord{
+				std::move(addr),
+				readChunk(ordinal),
+				0
+			});
+		});
+	}
+
+	void TableReader::extractRecords(const std::function<void(extractRecord&& rec)>& f, size_t window) {
+		const auto& idx = index();
+		const uint32_t count = idx.count();
+		// records are back to back in ordinal order, so each window is one read of the
+		// records that fit, or of a single record larger than the window
+		ByteSlice records;
+		uint64_t start = 0;
+		uint32_t next = 0; // first ordinal past the window
+		forEachAddress(idx, [&](uint32_t ordinal, Hash addr) {
+			const auto [offset, length] = idx.record(ordinal);
+			if (ordinal == next) {
+				uint64_t end = offset + length;
+				for (next = ordinal + 1; next < count; ++next) {
+					const auto [o, l] = idx.record(next);
+					if (o + l - offset > window) {
+						break;
+					}
+					end = o + l;
+				}
+				start = offset;
+				records = ByteSlice{ size_t(end - start) };
+				readFull(reader, records.span(), start);
+			}
+			f(extractRecord{
+				std::move(addr),
+				records.subSlice(size_t(offset - start), length),
+				0
+			});
+		});
+	}
+}
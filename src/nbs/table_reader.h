@@ -0,0 +1,218 @@
+#pragma once
+
+#include "common.h"
+#include "table.h"
+#include "compression/compression.h"
+#include "io/io_backend.h"
+#include "elias_fano.h"
+#include "prefix_filter.h"
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace nomp {
+	namespace interface {
+		PRO_DEF_MEM_DISPATCH(MemReadAt, readAt);
+		PRO_DEF_MEM_DISPATCH(MemReadManyAt, readManyAt);
+		PRO_DEF_MEM_DISPATCH(MemSize, size);
+
+		// ReaderAt gives random access to the bytes of an immutable table.
+		// Implementations must be safe to call from multiple threads at once.
+		struct ReaderAt : pro::facade_builder
+			// Reads up to buf.size() bytes starting at |offset|, returns the number of bytes read.
+			::add_convention<MemReadAt, size_t(std::span<std::byte> buf, uint64_t offset)>
+			// Performs every read in |requests|, ideally as a single batch.
+			::add_convention<MemReadManyAt, void(std::span<ReadRequest> requests)>
+			// Returns the total size of the table in bytes.
+			::add_convention<MemSize, uint64_t()>
+			::build {
+		};
+		using IReaderAt = pro::proxy<ReaderAt>;
+	}
+
+	// ByteSliceReaderAt serves a table that is entirely in memory.
+	class ByteSliceReaderAt {
+		ByteSlice data;
+	public:
+		explicit ByteSliceReaderAt(const ByteSlice& data) : data(data) {}
+		size_t readAt(std::span<std::byte> buf, uint64_t offset);
+		void readManyAt(std::span<ReadRequest> requests) {
+			for (auto& req : requests) {
+				req.bytesRead = readAt(req.buf, req.offset);
+			}
+		}
+		uint64_t size() const { return data.size(); }
+	};
+
+	// FileReaderAt serves a table file through an IoBackend.
+	class FileReaderAt {
+		std::shared_ptr<File> file;
+		interface::IIoBackend backend;
+		uint64_t fileSize;
+	public:
+		FileReaderAt(std::shared_ptr<File> file, interface::IIoBackend backend) :
+			file(std::move(file)), backend(std::move(backend)), fileSize(this->file->size()) {}
+		size_t readAt(std::span<std::byte> buf, uint64_t offset) {
+			ReadRequest req{ offset, buf, 0 };
+			backend->readBatch(*file, std::span{ &req, 1 });
+			return req.bytesRead;
+		}
+		void readManyAt(std::span<ReadRequest> requests) {
+			backend->readBatch(*file, requests);
+		}
+		uint64_t size() const { return fileSize; }
+	};
+
+	// IndexLayout chooses how an open table keeps its record offsets in memory.
+	enum class IndexLayout {
+		Dense, // 8 bytes per chunk, one array load per lookup
+		EliasFano, // typically under 2 bytes per chunk, a short bitmap scan per lookup
+	};
+
+	// TableFooter is the fixed-size tail of a table: enough to know its shape
+	// without reading the index.
+	struct TableFooter {
+		uint32_t count = 0;
+		uint64_t totalUncompressed = 0;
+		uint8_t version = TableFormatV1;
+		uint8_t codec = TableCodecLZ4;
+		uint16_t flags = 0;
+
+		static TableFooter read(interface::IReaderAt& reader);
+	};
+
+	// TableIndex is the parsed form of the index and footer written by TableWriter.
+	// Prefixes are sorted, every other array is addressed by chunk ordinal.
+	//
+	// Records are stored back to back, so only the on-disk lengths are read: offsets
+	// are rebuilt from them with a prefix sum, and a record's length is the distance
+	// to the next offset.
+	struct TableIndex {
+		std::vector<uint64_t> prefixes;
+		std::vector<uint32_t> ordinals; // parallel to prefixes
+		std::vector<std::byte> suffixes; // SuffixSize bytes per chunk
+		uint64_t totalUncompressed = 0;
+		uint8_t version = TableFormatV1;
+		uint8_t codec = TableCodecLZ4;
+		uint16_t flags = 0;
+		IndexLayout layout = IndexLayout::Dense;
+		std::vector<uint64_t> offsets; // count + 1 record boundaries, Dense layout
+		EliasFano packedOffsets; // the same boundaries, EliasFano layout
+		PrefixFilter filter; // turns most lookups of absent chunks away before the search
+
+		static TableIndex parse(interface::IReaderAt& reader, IndexLayout layout = IndexLayout::Dense);
+		static TableIndex parse(interface::IReaderAt& reader, const TableFooter& footer, IndexLayout layout);
+
+		uint32_t count() const { return uint32_t(prefixes.size()); }
+
+		// Returns the offset and length of the record of |ordinal|.
+		std::pair<uint64_t, uint32_t> record(uint32_t ordinal) const {
+			const auto [begin, end] = layout == IndexLayout::Dense ?
+				std::pair{ offsets[ordinal], offsets[ordinal + 1] } :
+				packedOffsets.pair(ordinal);
+			return { begin, uint32_t(end - begin) };
+		}
+
+		// Returns the number of bytes this index holds in memory.
+		size_t memoryUsage() const;
+
+		// Returns the ordinal of |h| if the table contains it.
+		std::optional<uint32_t> lookup(const Hash& h) const;
+		// Returns true if the chunk at |ordinal| has the suffix of |h|.
+		bool matches(uint32_t ordinal, const Hash& h) const;
+
+		// Returns the size in bytes of the index and footer section of a table.
+		static uint64_t indexSize(uint32_t count, uint8_t version = TableFormatV1) {
+			if (version == TableFormatV1) {
+				return uint64_t(count) * (PrefixTupleSize + LengthSize + OffsetSize + SuffixSize) + FooterSize;
+			}
+			return uint64_t(count) * (PrefixTupleSize + LengthSize + OffsetSizeV2 + SuffixSize) + FooterSizeV2;
+		}
+	};
+
+	constexpr size_t ExtractWindowSize = 4 << 20; // 4 MiB
+
+	// TableReader serves chunks out of a table written by TableWriter. Opening one
+	// only reads the footer; the index is parsed on first use, or up front by
+	// loadIndex(), so a store with many tables opens quickly.
+	class TableReader {
+	public:
+		// OrdinalRecord is a getRecord whose chunk has already been located in this table.
+		struct OrdinalRecord {
+			getRecord* rec;
+			uint32_t ordinal;
+		};
+	private:
+		Hash tableName;
+		TableFooter footer;
+		IndexLayout layout;
+		mutable interface::IReaderAt reader; // the lazy index load reads through it
+		interface::IDecompresser decompresser;
+		mutable std::mutex indexMtx;
+		mutable std::atomic<bool> indexReady = false;
+		mutable TableIndex parsedIndex; // guarded by indexMtx until indexReady
+
+		const TableIndex& index() const {
+			if (!indexReady.load(std::memory_order_acquire)) {
+				loadIndex();
+			}
+			return parsedIndex;
+		}
+
+		ByteSlice readChunk(uint32_t ordinal);
+		ByteSlice decodeChunk(uint32_t ordinal, const ByteSlice& record);
+	public:
+		TableReader(const Hash& name, interface::IReaderAt reader, interface::IDecompresser decomp, IndexLayout layout = IndexLayout::Dense);
+		TableReader(const Hash& name, interface::IReaderAt reader, IndexLayout layout = IndexLayout::Dense) :
+			TableReader(name, std::move(reader),
+				interface::IDecompresser(pro::make_proxy<interface::Decompresser, LZ4Decompresser>()), layout)
+		{
+		}
+
+		const Hash& name() const { return tableName; }
+		// Returns the raw bytes of the table, to copy it elsewhere as is.
+		interface::IReaderAt& bytes() const { return reader; }
+
+		// Parses the index now rather than on first use. Safe to call from any thread.
+		void loadIndex() const;
+		bool indexLoaded() const {
+			return indexReady.load(std::memory_order_acquire);
+		}
+
+		bool has(const Hash& hash) const {
+			return index().lookup(hash).has_value();
+		}
+		// Returns true if |hash| is the chunk at |ordinal|, for callers that found the
+		// ordinal by prefix in an index of their own.
+		bool hasAt(uint32_t ordinal, const Hash& hash) const {
+			return index().matches(ordinal, hash);
+		}
+		bool hasMany(std::span<hasRecord>& records);
+		bool get(const Hash& hash, ByteSlice& data);
+		bool getMany(std::span<getRecord>& records);
+		// Fetches the chunk of every hit with a single batched read, and marks them found.
+		void getOrdinals(std::span<OrdinalRecord> hits);
+		const TableIndex& tableIndex() const {
+			return index();
+		}
+		uint32_t count() const {
+			return footer.count;
+		}
+		uint64_t uncompressedLen() const {
+			return footer.totalUncompressed;
+		}
+		// Returns 0 until the index is loaded.
+		size_t indexMemoryUsage() const {
+			return indexLoaded() ? parsedIndex.memoryUsage() : 0;
+		}
+		void extract(std::vector<extractRecord>& out);
+		// Like extract, but calls |f| with each chunk's record as stored, still
+		// compressed and checksummed, for copying into another table with
+		// TableWriter::addRecord. Records are read sequentially, |window| bytes of whole
+		// records at a time, and share their window's buffer: copy a record held on to
+		// while the rest of its window is not.
+		void extractRecords(const std::function<void(extractRecord&& rec)>& f, size_t window = ExtractWindowSize);
+	};
+}
@@ -5,6 +5,8 @@
 #include <lz4frame.h>
 #include "binary/all.h"
 #include <algorithm>
+#include <array>
+#include <limits>
 
 namespace nomp
 {
@@ -13,15 +15,25 @@ namespace nomp
 	* 
 	* Chunks: Chunk 0, Chunk 1, ..., Chunk N-1
 	* 
-	* Chunk: [compressed data][crc32]
+	* Chunk: [uncompressed length][compressed data][crc32]
+	* The crc32 covers the uncompressed length and the compressed data.
 	* 
 	* Index: PrefixTuples, Lengths, Offsets,  Suffixes
 	* PrefixTuples: [prefix0][order0][prefix1][order1]...[prefixN-1][orderN-1]
 	* Lengths: [len0][len1]...[lenN-1]
-	* Offsets: [offset0][offset1]...[offsetN-1]
+	* Offsets: [offset0][offset1]...[offsetN-1], u32 in v1, u64 in v2
 	* Suffixes: [suffix0][suffix1]...[suffixN-1]
+	*
+	* Footer v1: [chunk count u32][total uncompressed u64][MagicNumber]
+	* Footer v2: [chunk count u32][total uncompressed u64][version u8][codec u8][flags u16][MagicNumberV2]
 	*/
 
+	// size of the index without its footer
+	static size_t indexSectionSize(size_t count, size_t offsetSize)
+	{
+		return count * (PrefixTupleSize + LengthSize + offsetSize + SuffixSize);
+	}
+
 	uint64_t maxTableSize(uint64_t numChunks, uint64_t totalData)
 	{
 		auto avgChunkSize = totalData / numChunks;
@@ -29,88 +41,197 @@ namespace nomp
 			throw std::runtime_error("Average chunk size exceeds maximum chunk size");
 		}
 		auto maxLZ4Size = LZ4_compressBound((int)avgChunkSize);
-		return numChunks * (PrefixTupleSize + LengthSize + OffsetSize + SuffixSize + CheckSumSize + maxLZ4Size) + FooterSize;
+		// sized for v2, the format is only chosen once all chunks are in
+		return numChunks * (PrefixTupleSize + LengthSize + OffsetSizeV2 + SuffixSize + RawLengthSize + CheckSumSize + maxLZ4Size) + FooterSizeV2;
 	}
 
 	
-	// append [compressed data][crc32] and update prefixes
-	void TableWriter::addChunk(const Hash& h, const ByteSlice& data)
+	size_t maxRecordSize(size_t dataSize)
+	{
+		return RawLengthSize + size_t(LZ4_compressBound(int(dataSize))) + CheckSumSize;
+	}
+
+	// [uncompressed length][compressed data][crc32]
+	size_t writeChunkRecord(interface::ICompresser& compressor, const ByteSlice& data, std::span<std::byte> out)
 	{
 		if (data.size() == 0) {
 			throw std::runtime_error("NBS blocks cannont be zero length");
 		}
+		BigEndian::writeUint32(out, uint32_t(data.size()));
+		size_t pos = RawLengthSize;
+		pos += compressor->compressInplace(data, out.subspan(pos));
+		BigEndian::writeUint32(out.subspan(pos), crc32(out.first(pos)));
+		return pos + CheckSumSize;
+	}
 
-		const auto compressedSize = compressor->compressInplace(data, buff.subSpan(pos, buff.size() - pos));
-		const std::span<std::byte> compressedSpan = buff.subSpan(pos, compressedSize);
-		pos += compressedSize;
+	void TableWriter::addChunk(const Hash& h, const ByteSlice& data)
+	{
+		const auto length = writeChunkRecord(compressor, data, buff.subSpan(pos, buff.size() - pos));
+		pos += length;
+		totalCompressed += length - RawLengthSize - CheckSumSize;
+		index.add(h, uint32_t(length), data.size());
+	}
 
-		totalCompressed += compressedSize;
-		totalUncompressed += data.size();
+	void TableWriter::addRecord(const Hash& h, std::span<const std::byte> record)
+	{
+		if (record.size() <= RawLengthSize + CheckSumSize) {
+			throw std::runtime_error("Corrupt chunk record for " + h.toString());
+		}
+		const auto body = record.first(record.size() - CheckSumSize);
+		if (crc32(body) != BigEndian::loadUint32(record.data() + body.size())) {
+			throw std::runtime_error("Checksum mismatch in chunk record for " + h.toString());
+		}
+		if (record.size() > buff.size() - pos) {
+			throw std::runtime_error("Table buffer too small for chunk record");
+		}
+		std::copy(record.begin(), record.end(), buff.subSpan(pos).begin());
+		pos += record.size();
+		totalCompressed += record.size() - RawLengthSize - CheckSumSize;
+		index.add(h, uint32_t(record.size()), BigEndian::loadUint32(record.data()));
+	}
 
-		BigEndian::writeUint32(buff.subSpan(pos), crc32(compressedSpan));
-		pos += CheckSumSize;
+	TableIndexWriter::TableIndexWriter(uint8_t codec, size_t numChunks) : codec(codec)
+	{
+		prefixes.reserve(numChunks);
+		lengths.reserve(numChunks);
+		suffixes.reserve(numChunks * SuffixSize);
+	}
 
-		prefixes.emplace_back(
-			std::make_shared<PrefixIndexRec>(h, prefixes.size(), uint32_t(compressedSize + CheckSumSize))
-		);
+	void TableIndexWriter::add(const Hash& h, uint32_t recordLength, uint64_t uncompressedLength)
+	{
+		const std::span<const std::byte> addr = h;
+		prefixes.push_back(h.prefix());
+		lengths.push_back(recordLength);
+		suffixes.insert(suffixes.end(), addr.begin() + PrefixSize, addr.end());
+		recordBytes += recordLength;
+		totalUncompressed += uncompressedLength;
 	}
 
-	void TableWriter::writeIndex()
+	void sortPrefixTuples(std::vector<PrefixTuple>& tuples, std::vector<PrefixTuple>& scratch)
 	{
-		std::sort(prefixes.begin(), prefixes.end(), [](const std::shared_ptr<PrefixIndexRec>& a, const std::shared_ptr<PrefixIndexRec>& b) {
-			return a->prefix < b->prefix;
-			});
-		auto lenOffset = pos + (PrefixSize + OrdinalSize) * prefixes.size();
-		auto offsetOffset = lenOffset + LengthSize * prefixes.size();
-		auto suffixOffset = offsetOffset + OffsetSize * prefixes.size();
-		for (const auto& rec : prefixes) {
-			// prefix
-			BigEndian::writeUint64(buff.subSpan(pos), rec->prefix);
-			pos += PrefixSize;
-			// order
-			BigEndian::writeUint32(buff.subSpan(pos), rec->order);
-			pos += OrdinalSize;
-			// length
-			BigEndian::writeUint32(buff.subSpan(lenOffset + rec->order * LengthSize), rec->size);
-			// suffix
-			auto suffixPos = suffixOffset + rec->order * SuffixSize;
-			std::copy(rec->suffix.begin(), rec->suffix.end(), buff.subSpan(suffixPos).begin());
+		constexpr size_t RadixThreshold = 256;
+		if (tuples.size() < RadixThreshold) {
+			std::sort(tuples.begin(), tuples.end(), [](const PrefixTuple& a, const PrefixTuple& b) {
+				return a.prefix < b.prefix || (a.prefix == b.prefix && a.ordinal < b.ordinal);
+				});
+			return;
 		}
-		// offsets
-		uint32_t currentOffset = 0;
-		for (size_t i = 0; i < prefixes.size(); ++i) {
-			BigEndian::writeUint32(buff.subSpan(offsetOffset + i * OffsetSize), currentOffset);
-			currentOffset += BigEndian::uint32(buff.subSpan(lenOffset + i * LengthSize));
+		// one counting pass for all eight digits
+		std::array<std::array<uint32_t, 256>, PrefixSize> counts{};
+		for (const auto& t : tuples) {
+			for (size_t d = 0; d < PrefixSize; ++d) {
+				++counts[d][(t.prefix >> (d * 8)) & 0xFF];
+			}
+		}
+		scratch.resize(tuples.size());
+		auto* src = &tuples;
+		auto* dst = &scratch;
+		for (size_t d = 0; d < PrefixSize; ++d) {
+			auto& count = counts[d];
+			if (std::find(count.begin(), count.end(), uint32_t(tuples.size())) != count.end()) {
+				continue; // every key has the same digit here
+			}
+			uint32_t sum = 0;
+			for (auto& c : count) {
+				const auto n = c;
+				c = sum;
+				sum += n;
+			}
+			const auto shift = d * 8;
+			for (const auto& t : *src) {
+				(*dst)[count[(t.prefix >> shift) & 0xFF]++] = t;
+			}
+			std::swap(src, dst);
+		}
+		if (src != &tuples) {
+			tuples.swap(scratch);
 		}
-
-		auto suffixLen = SuffixSize * prefixes.size();
-		blockHasher.update(buff.subSpan(suffixOffset, suffixLen));
-		pos = suffixOffset + suffixLen;
 	}
 
-	void TableWriter::writeFooter()
+	uint8_t TableIndexWriter::version() const
 	{
-		// chunk count
-		BigEndian::writeUint32(buff.subSpan(pos), prefixes.size());
-		pos += CheckSumSize;
-		// total uncompressed length
-		BigEndian::writeUint64(buff.subSpan(pos), totalUncompressed);
-		pos += Uint64Size;
-		// magic number
-		BigEndian::writeUint64(buff.subSpan(pos), MagicNumber);
-		pos += MagicNumberSize;
+		// v1 offsets are 32 bits, so the last chunk must start below 4 GiB
+		const bool needsV2 = codec != TableCodecLZ4 ||
+			(!lengths.empty() && recordBytes - lengths.back() > std::numeric_limits<uint32_t>::max());
+		return needsV2 ? std::max(minVersion, TableFormatV2) : minVersion;
 	}
 
-
-	std::pair<Hash, ByteSlice> TableWriter::finish()
+	size_t TableIndexWriter::tailSize(uint8_t version) const
 	{
-		writeIndex();
-		writeFooter();
-		const auto tableSize = pos;
-		const Hash tableHash = blockHasher.final();
-		return { tableHash, buff.subSlice(0, tableSize) };
+		return indexSectionSize(count(), version == TableFormatV1 ? OffsetSize : OffsetSizeV2) +
+			(version == TableFormatV1 ? FooterSize : FooterSizeV2);
 	}
 
+	Hash TableIndexWriter::writeTail(std::span<std::byte> out, uint8_t version) const
+	{
+		const size_t count = prefixes.size();
+		const size_t offsetSize = version == TableFormatV1 ? OffsetSize : OffsetSizeV2;
 
+		std::vector<PrefixTuple> tuples(count);
+		for (size_t i = 0; i < count; ++i) {
+			tuples[i] = PrefixTuple{ prefixes[i], uint32_t(i) };
+		}
+		std::vector<PrefixTuple> scratch;
+		sortPrefixTuples(tuples, scratch);
 
-}
\ No newline at end of file
+		// each section is encoded in one sequential pass
+		auto p = out.data();
+		for (const auto& t : tuples) {
+			BigEndian::storeUint64(p, t.prefix);
+			BigEndian::storeUint32(p + PrefixSize, t.ordinal);
+			p += PrefixTupleSize;
+		}
+		BigEndian::writeUint32s(out.subspan(p - out.data(), count * LengthSize), lengths);
+		p += count * LengthSize;
+		if (version == TableFormatV1) {
+			std::vector<uint32_t> offsets(count);
+			uint32_t currentOffset = 0;
+			for (size_t i = 0; i < count; ++i) {
+				offsets[i] = currentOffset;
+				currentOffset += lengths[i];
+			}
+			BigEndian::writeUint32s(out.subspan(p - out.data(), count * OffsetSize), offsets);
+		}
+		else {
+			std::vector<uint64_t> offsets(count);
+			uint64_t currentOffset = 0;
+			for (size_t i = 0; i < count; ++i) {
+				offsets[i] = currentOffset;
+				currentOffset += lengths[i];
+			}
+			BigEndian::writeUint64s(out.subspan(p - out.data(), count * OffsetSizeV2), offsets);
+		}
+		p += count * offsetSize;
+		p = std::copy(suffixes.begin(), suffixes.end(), p);
+
+		// footer: chunk count, total uncompressed length
+		BigEndian::storeUint32(p, uint32_t(count));
+		p += Uint32Size;
+		BigEndian::storeUint64(p, totalUncompressed);
+		p += Uint64Size;
+		if (version == TableFormatV1) {
+			BigEndian::storeUint64(p, MagicNumber);
+		}
+		else {
+			// format info
+			p[0] = std::byte{ version };
+			p[1] = std::byte{ codec };
+			BigEndian::storeUint16(p + 2, 0); // flags
+			p += FormatInfoSize;
+			BigEndian::storeUint64(p, MagicNumberV2);
+		}
+
+		Hasher hasher;
+		hasher.update(std::span<const std::byte>(suffixes));
+		return hasher.final();
+	}
+
+	std::pair<Hash, ByteSlice> TableWriter::finish()
+	{
+		const uint8_t version = index.version();
+		const auto tail = index.tailSize(version);
+		const Hash tableHash = index.writeTail(buff.subSpan(pos, tail), version);
+		pos += tail;
+		return { tableHash, buff.subSlice(0, pos) };
+	}
+}
@@ -3,47 +3,78 @@
 #include "common.h"
 #include "table.h"
 #include "compression/compression.h"
-#include <array>
 #include <utility>
+#include <vector>
 
 namespace nomp {
 	namespace interface {
 	}
 
 
-	struct PrefixIndexRec {
+	// PrefixTuple is one entry of the PrefixTuples section of a table index.
+	struct PrefixTuple {
 		uint64_t prefix;
-		std::array<std::byte, SuffixSize> suffix;
-		uint32_t order;
-		uint32_t size;
-		PrefixIndexRec(const Hash& h, uint32_t order, uint32_t size) :
-			prefix(h.prefix()), order(order), size(size) {
-			std::span<const byte> sp = h;
-			std::copy(sp.begin() + PrefixSize, sp.end(), suffix.begin());
-		}
+		uint32_t ordinal;
 	};
+
+	// Sorts |tuples| by prefix, ties stay in ordinal order. Large inputs use an LSD
+	// radix sort on the prefix bytes, with |scratch| as its second buffer.
+	void sortPrefixTuples(std::vector<PrefixTuple>& tuples, std::vector<PrefixTuple>& scratch);
 	
 	uint64_t maxTableSize(uint64_t numChunks, uint64_t totalData);
+	// Upper bound of the record of a chunk of |dataSize| bytes.
+	size_t maxRecordSize(size_t dataSize);
+	// Encodes |data| as a chunk record into |out|, which must hold
+	// maxRecordSize(data.size()) bytes, and returns the record's length.
+	size_t writeChunkRecord(interface::ICompresser& compressor, const ByteSlice& data, std::span<std::byte> out);
+
+	// TableIndexWriter collects the index of a table as its records are written,
+	// and encodes the index and footer once they all are. The records themselves
+	// can be written anywhere; TableWriter keeps them in memory.
+	class TableIndexWriter {
+		// struct-of-arrays addressed by chunk ordinal
+		std::vector<uint64_t> prefixes;
+		std::vector<uint32_t> lengths;
+		std::vector<std::byte> suffixes; // SuffixSize bytes per chunk
+		uint64_t recordBytes = 0;
+		uint64_t totalUncompressed = 0;
+		uint8_t codec;
+		uint8_t minVersion = TableFormatV1;
+	public:
+		explicit TableIndexWriter(uint8_t codec = TableCodecLZ4, size_t numChunks = 0);
+
+		void setMinFormat(uint8_t version) { minVersion = version; }
+		void add(const Hash& h, uint32_t recordLength, uint64_t uncompressedLength);
+
+		size_t count() const { return prefixes.size(); }
+		uint64_t recordSize() const { return recordBytes; }
+		// The format the table needs: at least the minimum, v2 when offsets overflow
+		// 32 bits or the codec is not LZ4.
+		uint8_t version() const;
+		// Bytes of index and footer in format |version|.
+		size_t tailSize(uint8_t version) const;
+		// Writes the index and footer in format |version| to |out|, which must hold
+		// tailSize(version) bytes, and returns the table's name.
+		Hash writeTail(std::span<std::byte> out, uint8_t version) const;
+	};
+
 	class TableWriter {
 		ByteSlice buff;
 		uint64_t pos;
 		uint64_t totalCompressed;
-		uint64_t totalUncompressed;
-		std::vector<std::shared_ptr<PrefixIndexRec>> prefixes;
-		Hasher blockHasher;
+		TableIndexWriter index;
 
 		interface::ICompresser compressor;
-		
-		void writeIndex();
-		void writeFooter();
 	public:
-		TableWriter(uint64_t numChunks, uint64_t totalData, interface::ICompresser comp):
-			compressor(comp),
+		// |codec| identifies |comp| in the footer of the table.
+		TableWriter(uint64_t numChunks, uint64_t totalData, interface::ICompresser comp, uint8_t codec = TableCodecLZ4):
 			buff(maxTableSize(numChunks, totalData)),
 			pos(0),
 			totalCompressed(0),
-			totalUncompressed(0)
-		{}
+			index(codec, numChunks),
+			compressor(comp)
+		{
+		}
 
 		TableWriter(uint64_t numChunks, uint64_t totalData) :
 			TableWriter(numChunks, totalData, 
@@ -51,7 +82,17 @@ namespace nomp {
 		{
 		}
 
+		// Writes at least format |version|, the writer picks v2 by itself when offsets
+		// overflow 32 bits or the codec is not LZ4.
+		void setMinFormat(uint8_t version) { index.setMinFormat(version); }
+
 		void addChunk(const Hash& h, const ByteSlice& data);
+		// Appends a record read by TableReader::extractRecords from a table of the same
+		// codec as is, without decompressing and compressing it again. When sizing the
+		// writer, count record bytes as |totalData|.
+		void addRecord(const Hash& h, std::span<const std::byte> record);
+		// Returns the bytes of the records added so far, leaving out index and footer.
+		uint64_t recordBytes() const { return pos; }
 		std::pair<Hash, ByteSlice> finish();
 	};
 	
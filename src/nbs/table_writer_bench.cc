@@ -0,0 +1,56 @@
+#include <benchmark/benchmark.h>
+#include "table_writer.h"
+#include "table_reader.h"
+#include "test_util.h"
+#include <vector>
+
+using namespace nomp;
+using test::makeCompressibleChunks;
+
+static std::pair<Hash, ByteSlice> writeTable(const std::vector<Chunk>& chunks) {
+	uint64_t totalData = 0;
+	for (const auto& c : chunks) {
+		totalData += c.size();
+	}
+	TableWriter tw(chunks.size(), totalData);
+	for (const auto& c : chunks) {
+		tw.addChunk(c.hash(), c.data());
+	}
+	return tw.finish();
+}
+
+// Args: chunk count, chunk size
+static void BM_TableWriter(benchmark::State& state) {
+	const auto chunks = makeCompressibleChunks(size_t(state.range(0)), size_t(state.range(1)));
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(writeTable(chunks));
+	}
+	state.SetItemsProcessed(int64_t(state.iterations()) * state.range(0));
+	state.SetBytesProcessed(int64_t(state.iterations()) * state.range(0) * state.range(1));
+}
+BENCHMARK(BM_TableWriter)->ArgsProduct({ { 1 << 10, 1 << 14 }, { 256, 4096 } })->Unit(benchmark::kMillisecond);
+
+// Opening a table and parsing its index, Args: chunk count, index layout
+static void BM_TableIndexParse(benchmark::State& state) {
+	const auto [name, data] = writeTable(makeCompressibleChunks(size_t(state.range(0)), 128));
+	const auto layout = IndexLayout(state.range(1));
+	for (auto _ : state) {
+		TableReader reader(name, pro::make_proxy<interface::ReaderAt, ByteSliceReaderAt>(data), layout);
+		reader.loadIndex();
+		benchmark::DoNotOptimize(reader.indexMemoryUsage());
+	}
+	state.SetItemsProcessed(int64_t(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_TableIndexParse)->ArgsProduct({ { 1 << 10, 1 << 16 }, { int64_t(IndexLayout::Dense), int64_t(IndexLayout::EliasFano) } });
+
+static void BM_TableReaderGet(benchmark::State& state) {
+	const auto chunks = makeCompressibleChunks(size_t(state.range(0)), 1024);
+	const auto [name, data] = writeTable(chunks);
+	TableReader reader(name, pro::make_proxy<interface::ReaderAt, ByteSliceReaderAt>(data));
+	size_t i = 0;
+	ByteSlice out;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(reader.get(chunks[i++ % chunks.size()].hash(), out));
+	}
+}
+BENCHMARK(BM_TableReaderGet)->Range(1 << 10, 1 << 14);
@@ -0,0 +1,326 @@
+#include <gtest/gtest.h>
+
+#include "table_writer.h"
+#include "table_reader.h"
+#include "binary/all.h"
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace nomp;
+
+static std::vector<Chunk> makeChunks(size_t n) {
+	std::vector<Chunk> chunks;
+	for (size_t i = 0; i < n; ++i) {
+		chunks.emplace_back(Chunk::FromString("chunk data " + std::to_string(i) + std::string(i % 50, 'x')));
+	}
+	return chunks;
+}
+
+static std::pair<Hash, ByteSlice> writeTable(const std::vector<Chunk>& chunks, uint8_t version = TableFormatV1) {
+	uint64_t totalData = 0;
+	for (const auto& c : chunks) {
+		totalData += c.size();
+	}
+	TableWriter tw(chunks.size(), totalData);
+	tw.setMinFormat(version);
+	for (const auto& c : chunks) {
+		tw.addChunk(c.hash(), c.data());
+	}
+	return tw.finish();
+}
+
+static TableReader writeAndOpen(const std::vector<Chunk>& chunks, uint8_t version = TableFormatV1) {
+	auto [name, data] = writeTable(chunks, version);
+	return TableReader(name, pro::make_proxy<interface::ReaderAt, ByteSliceReaderAt>(data));
+}
+
+TEST(TableWriterTest, TestRoundTrip) {
+	auto chunks = makeChunks(200);
+	auto reader = writeAndOpen(chunks);
+	EXPECT_EQ(reader.count(), chunks.size());
+
+	uint64_t totalData = 0;
+	for (const auto& c : chunks) {
+		totalData += c.size();
+		EXPECT_TRUE(reader.has(c.hash()));
+		ByteSlice data;
+		ASSERT_TRUE(reader.get(c.hash(), data));
+		EXPECT_EQ(data, c.data());
+	}
+	EXPECT_EQ(reader.uncompressedLen(), totalData);
+
+	auto absent = Chunk::FromString("not in the table");
+	EXPECT_FALSE(reader.has(absent.hash()));
+	ByteSlice out;
+	EXPECT_FALSE(reader.get(absent.hash(), out));
+}
+
+TEST(TableWriterTest, TestGetManyAndExtract) {
+	auto chunks = makeChunks(32);
+	auto reader = writeAndOpen(chunks);
+
+	std::vector<getRecord> records;
+	for (const auto& c : chunks) {
+		records.emplace_back(getRecord{ c.hash(), ByteSlice(), c.hash().prefix(), false });
+	}
+	auto absent = Chunk::FromString("absent");
+	records.emplace_back(getRecord{ absent.hash(), ByteSlice(), absent.hash().prefix(), false });
+	std::span<getRecord> span{ records };
+	EXPECT_TRUE(reader.getMany(span));
+	for (size_t i = 0; i < chunks.size(); ++i) {
+		EXPECT_TRUE(records[i].found);
+		EXPECT_EQ(records[i].data, chunks[i].data());
+	}
+	EXPECT_FALSE(records.back().found);
+
+	std::vector<extractRecord> extracted;
+	reader.extract(extracted);
+	ASSERT_EQ(extracted.size(), chunks.size());
+	for (size_t i = 0; i < chunks.size(); ++i) {
+		EXPECT_EQ(extracted[i].addr, chunks[i].hash());
+		EXPECT_EQ(extracted[i].data, chunks[i].data());
+	}
+}
+
+TEST(TableWriterTest, TestCopyRecords) {
+	auto chunks = makeChunks(40);
+	auto reader = writeAndOpen(chunks);
+	std::vector<extractRecord> records;
+	reader.extractRecords([&](extractRecord&& rec) { records.push_back(std::move(rec)); });
+	ASSERT_EQ(records.size(), chunks.size());
+
+	// a window smaller than any record still reads every record whole
+	for (size_t window : { size_t{ 1 }, size_t{ 100 } }) {
+		size_t i = 0;
+		reader.extractRecords([&](extractRecord&& rec) {
+			ASSERT_LT(i, records.size());
+			EXPECT_EQ(rec.addr, records[i].addr);
+			EXPECT_TRUE(std::ranges::equal(rec.data.span(), records[i].data.span()));
+			++i;
+		}, window);
+		EXPECT_EQ(i, records.size());
+	}
+
+	// copy every other record into a new table without recompressing
+	uint64_t bytes = 0;
+	for (size_t i = 0; i < records.size(); i += 2) {
+		bytes += records[i].data.size();
+	}
+	TableWriter tw(records.size() / 2, bytes);
+	for (size_t i = 0; i < records.size(); i += 2) {
+		EXPECT_EQ(records[i].addr, chunks[i].hash());
+		tw.addRecord(records[i].addr, records[i].data.span());
+	}
+	auto [name, data] = tw.finish();
+	TableReader copy(name, pro::make_proxy<interface::ReaderAt, ByteSliceReaderAt>(data));
+	EXPECT_EQ(copy.count(), records.size() / 2);
+	for (size_t i = 0; i < chunks.size(); ++i) {
+		ByteSlice out;
+		EXPECT_EQ(copy.get(chunks[i].hash(), out), i % 2 == 0);
+		if (i % 2 == 0) {
+			EXPECT_EQ(out, chunks[i].data());
+		}
+	}
+
+	auto corrupt = records[1].data.copy();
+	corrupt.edit()[RawLengthSize] ^= std::byte{ 0xFF };
+	TableWriter bad(1, corrupt.size());
+	EXPECT_THROW(bad.addRecord(records[1].addr, corrupt.span()), std::runtime_error);
+}
+
+TEST(TableWriterTest, TestCorruptChunkDetected) {
+	auto chunks = makeChunks(1);
+	TableWriter tw(1, chunks[0].size());
+	tw.addChunk(chunks[0].hash(), chunks[0].data());
+	auto [name, data] = tw.finish();
+	data.edit()[RawLengthSize] ^= std::byte{ 0xFF };
+	TableReader reader(name, pro::make_proxy<interface::ReaderAt, ByteSliceReaderAt>(data));
+	ByteSlice out;
+	EXPECT_THROW(reader.get(chunks[0].hash(), out), std::runtime_error);
+}
+
+TEST(TableWriterTest, TestFormatV2) {
+	auto chunks = makeChunks(100);
+	auto [v1Name, v1] = writeTable(chunks, TableFormatV1);
+	auto [v2Name, v2] = writeTable(chunks, TableFormatV2);
+	EXPECT_EQ(v1Name, v2Name);
+	EXPECT_EQ(v2.size() - v1.size(), chunks.size() * (OffsetSizeV2 - OffsetSize) + FooterSizeV2 - FooterSize);
+
+	auto reader = pro::make_proxy<interface::ReaderAt, ByteSliceReaderAt>(v2);
+	auto index = TableIndex::parse(reader);
+	EXPECT_EQ(index.version, TableFormatV2);
+	EXPECT_EQ(index.codec, TableCodecLZ4);
+	EXPECT_EQ(index.count(), chunks.size());
+
+	TableReader table(v2Name, pro::make_proxy<interface::ReaderAt, ByteSliceReaderAt>(v2));
+	for (const auto& c : chunks) {
+		ByteSlice data;
+		ASSERT_TRUE(table.get(c.hash(), data));
+		EXPECT_EQ(data, c.data());
+	}
+
+	// flags this reader does not know about make the table unreadable
+	auto flagged = v2.subSlice(0, v2.size());
+	flagged.edit()[v2.size() - MagicNumberSize - 1] = std::byte{ 0x80 };
+	auto flaggedReader = pro::make_proxy<interface::ReaderAt, ByteSliceReaderAt>(flagged);
+	EXPECT_THROW(TableIndex::parse(flaggedReader), std::runtime_error);
+}
+
+// HoleReaderAt serves a table with |shift| bytes that are never read inserted at
+// |holeStart|, so a small table can pose as one that is many gigabytes long.
+class HoleReaderAt {
+	ByteSlice table;
+	uint64_t holeStart;
+	uint64_t shift;
+public:
+	HoleReaderAt(ByteSlice table, uint64_t holeStart, uint64_t shift) : table(table), holeStart(holeStart), shift(shift) {}
+	size_t readAt(std::span<std::byte> buf, uint64_t offset) {
+		if (offset < holeStart) {
+			return ByteSliceReaderAt(table).readAt(buf, offset);
+		}
+		if (offset < holeStart + shift) {
+			throw std::runtime_error("read from the hole");
+		}
+		return ByteSliceReaderAt(table).readAt(buf, offset - shift);
+	}
+	void readManyAt(std::span<ReadRequest> requests) {
+		for (auto& req : requests) {
+			req.bytesRead = readAt(req.buf, req.offset);
+		}
+	}
+	uint64_t size() const { return shift + table.size(); }
+};
+
+TEST(TableWriterTest, TestLargeOffsets) {
+	auto chunks = makeChunks(3);
+	for (auto layout : { IndexLayout::Dense, IndexLayout::EliasFano }) {
+		auto [name, data] = writeTable(chunks, TableFormatV2);
+		// grow the first two records by 3 GiB each, so the third starts past 6 GiB
+		const uint64_t grow = 3ULL << 30;
+		const auto recordsEnd = data.size() - TableIndex::indexSize(3, TableFormatV2);
+		auto lengths = data.subSpan(recordsEnd + 3 * PrefixTupleSize, 3 * LengthSize);
+		const auto len0 = BigEndian::uint32(lengths);
+		const auto len1 = BigEndian::uint32(lengths.subspan(LengthSize));
+		BigEndian::writeUint32(lengths, uint32_t(len0 + grow));
+		BigEndian::writeUint32(lengths.subspan(LengthSize), uint32_t(len1 + grow));
+
+		TableReader reader(name, pro::make_proxy<interface::ReaderAt, HoleReaderAt>(data, len0 + len1, 2 * grow), layout);
+		ByteSlice out;
+		ASSERT_TRUE(reader.get(chunks[2].hash(), out));
+		EXPECT_EQ(out, chunks[2].data());
+		EXPECT_THROW(reader.get(chunks[0].hash(), out), std::runtime_error);
+	}
+}
+
+TEST(TableWriterTest, TestLazyIndex) {
+	auto chunks = makeChunks(500);
+	auto [name, data] = writeTable(chunks);
+	TableReader reader(name, pro::make_proxy<interface::ReaderAt, ByteSliceReaderAt>(data));
+	EXPECT_EQ(reader.count(), chunks.size());
+	EXPECT_FALSE(reader.indexLoaded());
+	EXPECT_EQ(reader.indexMemoryUsage(), 0u);
+
+	// the first lookups race to parse the index, all of them must see it whole
+	std::vector<std::thread> threads;
+	std::atomic<size_t> found = 0;
+	for (size_t t = 0; t < 4; ++t) {
+		threads.emplace_back([&, t] {
+			for (size_t i = t; i < chunks.size(); i += 4) {
+				found += reader.has(chunks[i].hash());
+			}
+		});
+	}
+	for (auto& t : threads) {
+		t.join();
+	}
+	EXPECT_EQ(found, chunks.size());
+	EXPECT_TRUE(reader.indexLoaded());
+	EXPECT_GT(reader.indexMemoryUsage(), 0u);
+}
+
+TEST(TableWriterTest, TestEliasFanoIndex) {
+	auto chunks = makeChunks(2000);
+	auto [name, data] = writeTable(chunks);
+	TableReader dense(name, pro::make_proxy<interface::ReaderAt, ByteSliceReaderAt>(data), IndexLayout::Dense);
+	TableReader packed(name, pro::make_proxy<interface::ReaderAt, ByteSliceReaderAt>(data), IndexLayout::EliasFano);
+	dense.loadIndex();
+	packed.loadIndex();
+	EXPECT_LT(packed.indexMemoryUsage(), dense.indexMemoryUsage());
+	std::vector<getRecord> records;
+	for (const auto& c : chunks) {
+		records.emplace_back(getRecord{ c.hash(), ByteSlice(), c.hash().prefix(), false });
+	}
+	std::span<getRecord> span{ records };
+	EXPECT_FALSE(packed.getMany(span));
+	for (size_t i = 0; i < chunks.size(); ++i) {
+		EXPECT_EQ(records[i].data, chunks[i].data());
+	}
+}
+
+TEST(EliasFanoTest, TestRandomAccess) {
+	for (size_t n : { 1, 2, 255, 256, 257, 3000 }) {
+		std::vector<uint64_t> values;
+		uint64_t v = 0;
+		for (size_t i = 0; i < n; ++i) {
+			values.push_back(v);
+			v += (i * 7919) % 5000; // includes repeats
+		}
+		EliasFano ef(values);
+		ASSERT_EQ(ef.size(), n);
+		for (size_t i = 0; i < n; ++i) {
+			ASSERT_EQ(ef[i], values[i]) << "n " << n << " i " << i;
+			if (i + 1 < n) {
+				EXPECT_EQ(ef.pair(i), std::make_pair(values[i], values[i + 1]));
+			}
+		}
+	}
+	EXPECT_THROW(EliasFano(std::vector<uint64_t>{ 2, 1 }), std::invalid_argument);
+}
+
+TEST(PrefixFilterTest, TestNoFalseNegatives) {
+	std::mt19937_64 rng(7);
+	std::vector<uint64_t> prefixes(10000);
+	for (auto& p : prefixes) {
+		p = rng();
+	}
+	PrefixFilter filter(prefixes);
+	for (const auto p : prefixes) {
+		EXPECT_TRUE(filter.mayContain(p));
+	}
+	size_t passed = 0;
+	for (size_t i = 0; i < 10000; ++i) {
+		passed += filter.mayContain(rng());
+	}
+	EXPECT_LT(passed, 300u);
+	EXPECT_TRUE(PrefixFilter().mayContain(rng()));
+}
+
+TEST(TableWriterTest, TestSortPrefixTuples) {
+	for (size_t n : { 0, 1, 100, 5000 }) {
+		std::vector<PrefixTuple> tuples;
+		uint64_t x = 88172645463325252ULL;
+		for (size_t i = 0; i < n; ++i) {
+			x ^= x << 13;
+			x ^= x >> 7;
+			x ^= x << 17;
+			// every fourth prefix repeats an earlier one, and the low byte is constant
+			const uint64_t prefix = (i % 4 == 3 ? tuples[i / 2].prefix : x) | 0xFF;
+			tuples.push_back(PrefixTuple{ prefix, uint32_t(i) });
+		}
+		auto expected = tuples;
+		std::stable_sort(expected.begin(), expected.end(), [](const PrefixTuple& a, const PrefixTuple& b) {
+			return a.prefix < b.prefix;
+		});
+		std::vector<PrefixTuple> scratch;
+		sortPrefixTuples(tuples, scratch);
+		ASSERT_EQ(tuples.size(), expected.size());
+		for (size_t i = 0; i < n; ++i) {
+			EXPECT_EQ(tuples[i].prefix, expected[i].prefix) << i;
+			EXPECT_EQ(tuples[i].ordinal, expected[i].ordinal) << i;
+		}
+	}
+}
@@ -1,11 +1,26 @@
-﻿#include "nbs/mem_table.h"
-#include "nbs/table.h"
+﻿#include "workload/all.h"
 
 #include <iostream>
-#include <string>
+#include <string_view>
+#include <vector>
 
 using namespace nomp;
 
-int main() {
-	std::cout << "Hello, Nomp!" << std::endl;
-}
\ No newline at end of file
+static constexpr std::string_view Usage = R"(usage: nomp <command> [args]
+
+commands:
+  workload    drive a ChunkStore with a synthetic workload and report latencies
+)";
+
+int main(int argc, char** argv) {
+	std::vector<std::string_view> args(argv + 1, argv + argc);
+	if (args.empty()) {
+		std::cout << "Hello, Nomp!\n\n" << Usage;
+		return 0;
+	}
+	if (args[0] == "workload") {
+		return workloadMain(std::span(args).subspan(1));
+	}
+	std::cerr << "Unknown command '" << args[0] << "'\n\n" << Usage;
+	return 2;
+}
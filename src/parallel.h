@@ -0,0 +1,46 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace nomp {
+	// Runs f(0) .. f(n - 1) on up to |threads| threads and rethrows the first failure.
+	template <typename F>
+	void parallelFor(size_t n, size_t threads, F&& f) {
+		threads = std::min(threads, n);
+		if (threads <= 1) {
+			for (size_t i = 0; i < n; ++i) {
+				f(i);
+			}
+			return;
+		}
+		std::atomic<size_t> next = 0;
+		std::mutex errMtx;
+		std::exception_ptr err;
+		auto work = [&] {
+			for (size_t i; (i = next++) < n;) {
+				try {
+					f(i);
+				}
+				catch (...) {
+					std::lock_guard lock(errMtx);
+					if (!err) err = std::current_exception();
+				}
+			}
+		};
+		std::vector<std::thread> workers;
+		for (size_t t = 1; t < threads; ++t) {
+			workers.emplace_back(work);
+		}
+		work();
+		for (auto& w : workers) {
+			w.join();
+		}
+		if (err) {
+			std::rethrow_exception(err);
+		}
+	}
+}
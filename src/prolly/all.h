@@ -0,0 +1,3 @@
+#pragma once
+#include "node.h"
+#include "map.h"
\ No newline at end of file
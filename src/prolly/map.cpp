@@ -0,0 +1,418 @@
+#include "map.h"
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace nomp {
+	namespace {
+		using Edits = std::map<std::string, std::optional<std::string>, std::less<>>;
+		using NodeCache = std::unordered_map<Hash, std::shared_ptr<const Node>, Hash::Hasher>;
+
+		std::shared_ptr<const Node> readNode(interface::IChunkStore& store, const Hash& h) {
+			auto chunk = store->get(h);
+			if (!chunk) {
+				throw std::runtime_error("Map node " + h.toString() + " is missing");
+			}
+			return std::make_shared<const Node>(Node::decode(*chunk));
+		}
+
+		// Reads the nodes at |hashes| with one getMany().
+		NodeCache readNodes(interface::IChunkStore& store, const HashSet& hashes) {
+			NodeCache nodes;
+			for (const auto& c : store->getMany(hashes)) {
+				nodes.emplace(c.hash(), std::make_shared<const Node>(Node::decode(c)));
+			}
+			if (nodes.size() != hashes.size()) {
+				for (const auto& h : hashes) {
+					if (!nodes.contains(h)) {
+						throw std::runtime_error("Map node " + h.toString() + " is missing");
+					}
+				}
+			}
+			return nodes;
+		}
+
+		// TreeEditor applies sorted edits to a tree one level at a time. At each level
+		// it merges the edits into the nodes they fall in and re-cuts those nodes,
+		// pulling in the following node whenever the merged entries no longer end at
+		// a boundary. Nodes replaced and written become the edits to the level above.
+		class TreeEditor {
+			interface::IChunkStore& store;
+			const Hash& root;
+			size_t nodeSize;
+			NodeCache cache;
+
+		public:
+			TreeEditor(interface::IChunkStore& store, const Hash& root, size_t nodeSize) :
+				store(store), root(root), nodeSize(nodeSize) {}
+
+			std::shared_ptr<const Node> load(const Hash& h) {
+				auto it = cache.find(h);
+				if (it != cache.end()) {
+					return it->second;
+				}
+				return cache.emplace(h, readNode(store, h)).first->second;
+			}
+
+			// Reads every node on the paths to |edits|, with one getMany() per level.
+			void prefetch(const Edits& edits) {
+				std::vector<std::pair<std::shared_ptr<const Node>, std::pair<Edits::const_iterator, Edits::const_iterator>>> level{
+					{ load(root), { edits.begin(), edits.end() } } };
+				while (!level.front().first->leaf()) {
+					HashSet wanted;
+					std::vector<std::pair<Hash, std::pair<Edits::const_iterator, Edits::const_iterator>>> next;
+					for (const auto& [node, edited] : level) {
+						auto it = edited.first;
+						for (size_t i = 0; i < node->size() && it != edited.second; ++i) {
+							auto end = i + 1 == node->size() ? edited.second : edits.upper_bound(node->keys[i]);
+							if (end == it) {
+								continue;
+							}
+							auto ref = node->ref(i);
+							if (!cache.contains(ref)) {
+								wanted.insert(ref);
+							}
+							next.emplace_back(std::move(ref), std::make_pair(it, end));
+							it = end;
+						}
+					}
+					if (!wanted.empty()) {
+						cache.merge(readNodes(store, wanted));
+					}
+					level.clear();
+					for (const auto& [ref, edited] : next) {
+						level.emplace_back(cache.at(ref), edited);
+					}
+				}
+			}
+
+			// Returns the node at |level| holding the first key above |key| (at or above
+			// unless |after|), the level's last node if there is no such key and not
+			// |after|, and nullptr if there is none and |after|.
+			std::shared_ptr<const Node> seek(uint8_t level, std::string_view key, bool after) {
+				auto node = load(root);
+				while (node->level > level) {
+					auto i = size_t((after ?
+						std::upper_bound(node->keys.begin(), node->keys.end(), key) :
+						std::lower_bound(node->keys.begin(), node->keys.end(), key)) - node->keys.begin());
+					if (i == node->size()) {
+						if (after) {
+							return nullptr;
+						}
+						--i;
+					}
+					node = load(node->ref(i));
+				}
+				if (after && node->keys.back() <= key) {
+					return nullptr;
+				}
+				return node;
+			}
+
+			Hash write(const Node& node) {
+				auto chunk = node.encode();
+				store->put(chunk);
+				return chunk.hash();
+			}
+
+			// Cuts |entries| into nodes at |level|, writes them and records them in
+			// |parentEdits|. Returns the number of nodes written.
+			size_t cut(uint8_t level, std::vector<std::pair<std::string, std::string>>& entries, Edits& parentEdits) {
+				size_t written = 0;
+				Node node;
+				node.level = level;
+				for (size_t i = 0; i < entries.size(); ++i) {
+					node.keys.push_back(std::move(entries[i].first));
+					node.values.push_back(std::move(entries[i].second));
+					if (i + 1 == entries.size() || isBoundary(node.keys.back(), level, nodeSize)) {
+						const auto h = write(node);
+						parentEdits[node.keys.back()] = makeRefValue(h, node.count());
+						node.keys.clear();
+						node.values.clear();
+						++written;
+					}
+				}
+				entries.clear();
+				return written;
+			}
+
+			// Applies |edits| to |level| of the tree and returns the edits to the level
+			// above, counting the nodes written in |written|.
+			Edits editLevel(uint8_t level, int height, const Edits& edits, size_t& written) {
+				Edits parentEdits;
+				std::vector<std::pair<std::string, std::string>> entries;
+				if (int(level) > height) {
+					// the level is new: every edit is a node written below
+					for (const auto& [key, value] : edits) {
+						if (value) {
+							entries.emplace_back(key, *value);
+						}
+					}
+					written += cut(level, entries, parentEdits);
+					return parentEdits;
+				}
+				auto it = edits.begin();
+				while (it != edits.end()) {
+					auto node = seek(level, it->first, false);
+					while (true) {
+						const auto& last = node->keys.back();
+						auto next = seek(level, last, true);
+						const auto end = next ? edits.upper_bound(last) : edits.end();
+						// the node goes; a new node ending at the same key replaces it below
+						parentEdits[last] = std::nullopt;
+						size_t i = 0;
+						for (; it != end; ++it) {
+							for (; i < node->size() && node->keys[i] < it->first; ++i) {
+								entries.emplace_back(node->keys[i], node->values[i]);
+							}
+							if (i < node->size() && node->keys[i] == it->first) {
+								++i;
+							}
+							if (it->second) {
+								entries.emplace_back(it->first, *it->second);
+							}
+						}
+						for (; i < node->size(); ++i) {
+							entries.emplace_back(node->keys[i], node->values[i]);
+						}
+						if (!next || entries.empty() || isBoundary(entries.back().first, level, nodeSize)) {
+							break;
+						}
+						node = std::move(next);
+					}
+					written += cut(level, entries, parentEdits);
+				}
+				return parentEdits;
+			}
+
+			// Returns the root of the edited tree.
+			Hash apply(Edits edits) {
+				int height = -1;
+				if (!root.isEmpty()) {
+					prefetch(edits);
+					height = load(root)->level;
+				}
+				for (uint8_t level = 0;; ++level) {
+					size_t written = 0;
+					auto parentEdits = editLevel(level, height, edits, written);
+					if (int(level) >= height && written <= 1) {
+						if (written == 0) {
+							return Hash();
+						}
+						const auto top = std::find_if(parentEdits.begin(), parentEdits.end(), [](const auto& e) { return e.second.has_value(); });
+						auto h = Hash(std::span{ top->second->data(), size_t(ByteLen) });
+						// a node with one child is not a level of its own
+						for (auto node = load(h); !node->leaf() && node->size() == 1; node = load(h)) {
+							h = node->ref(0);
+						}
+						return h;
+					}
+					edits = std::move(parentEdits);
+				}
+			}
+		};
+	}
+
+	ProllyMap::ProllyMap(interface::IChunkStore& store, const Hash& root, const MapOptions& options) :
+		store(&store), root(root), options(options)
+	{
+		if (options.nodeSize < 2 || options.prefetch == 0) {
+			throw std::invalid_argument("Map node size must be at least 2 and prefetch at least 1");
+		}
+	}
+
+	uint64_t ProllyMap::count() const {
+		return empty() ? 0 : readNode(*store, root)->count();
+	}
+
+	std::optional<std::string> ProllyMap::get(std::string_view key) const {
+		if (empty()) {
+			return std::nullopt;
+		}
+		auto node = readNode(*store, root);
+		while (!node->leaf()) {
+			const auto i = size_t(std::lower_bound(node->keys.begin(), node->keys.end(), key) - node->keys.begin());
+			if (i == node->size()) {
+				return std::nullopt;
+			}
+			node = readNode(*store, node->ref(i));
+		}
+		const auto it = std::lower_bound(node->keys.begin(), node->keys.end(), key);
+		if (it == node->keys.end() || *it != key) {
+			return std::nullopt;
+		}
+		return node->values[size_t(it - node->keys.begin())];
+	}
+
+	ProllyMap ProllyMap::put(std::string_view key, std::string_view value) const {
+		return edit().put(key, value).apply();
+	}
+
+	ProllyMap ProllyMap::remove(std::string_view key) const {
+		return edit().remove(key).apply();
+	}
+
+	MapEditor ProllyMap::edit() const {
+		return MapEditor(*this);
+	}
+
+	void ProllyMap::range(std::string_view from, std::optional<std::string_view> to, const Visit& f) const {
+		if (empty()) {
+			return;
+		}
+		auto& s = *store;
+		const auto prefetch = options.prefetch;
+		// Visits the part of |node| in range, reading children |prefetch| at a time.
+		std::function<bool(const Node&)> visit = [&](const Node& node) {
+			const auto begin = size_t(std::lower_bound(node.keys.begin(), node.keys.end(), from) - node.keys.begin());
+			if (node.leaf()) {
+				for (size_t i = begin; i < node.size(); ++i) {
+					if ((to && node.keys[i] >= *to) || !f(node.keys[i], node.values[i])) {
+						return false;
+					}
+				}
+				return true;
+			}
+			// the child holding the first key at or above |to| may still hold keys below it
+			const auto end = to ?
+				std::min(node.size(), size_t(std::lower_bound(node.keys.begin(), node.keys.end(), *to) - node.keys.begin()) + 1) :
+				node.size();
+			for (size_t b = begin; b < end; b += prefetch) {
+				const auto e = std::min(end, b + prefetch);
+				HashSet batch;
+				for (size_t i = b; i < e; ++i) {
+					batch.insert(node.ref(i));
+				}
+				const auto children = readNodes(s, batch);
+				for (size_t i = b; i < e; ++i) {
+					if (!visit(*children.at(node.ref(i)))) {
+						return false;
+					}
+				}
+			}
+			return true;
+		};
+		visit(*readNode(s, root));
+	}
+
+	void ProllyMap::diff(const ProllyMap& from, const std::function<bool(const MapDiff&)>& f) const {
+		// Each side is a stack of pending items, the next in key order on top: leaf
+		// entries (level -1) and unread subtrees (the level of the node they point to).
+		// An item covers the keys above the last key taken off its side up to its own.
+		struct Item {
+			int level;
+			std::string key;
+			std::string value;
+		};
+		struct Side {
+			interface::IChunkStore& store;
+			std::vector<Item> items;
+			std::optional<std::string> low;
+
+			Side(interface::IChunkStore& store, const Hash& root) : store(store) {
+				if (!root.isEmpty()) {
+					auto node = readNode(store, root);
+					items.push_back(Item{ node->level, node->keys.back(), makeRefValue(root, node->count()) });
+				}
+			}
+			const Item& top() const { return items.back(); }
+			void pop() {
+				low = std::move(items.back().key);
+				items.pop_back();
+			}
+			void expand() {
+				const auto ref = Hash(std::span{ top().value.data(), size_t(ByteLen) });
+				items.pop_back();
+				const auto node = readNode(store, ref);
+				const int level = node->leaf() ? -1 : int(node->level) - 1;
+				for (size_t i = node->size(); i-- > 0;) {
+					items.push_back(Item{ level, node->keys[i], node->values[i] });
+				}
+			}
+			// Whether the top item lies wholly below everything |other| has left.
+			bool before(const Side& other) const {
+				return other.low && top().key <= *other.low;
+			}
+		};
+		Side a(*from.store, from.root);
+		Side b(*store, root);
+		while (!a.items.empty() || !b.items.empty()) {
+			const bool takeA = b.items.empty() || (!a.items.empty() && a.before(b));
+			const bool takeB = a.items.empty() || (!b.items.empty() && b.before(a));
+			if (takeA || takeB) {
+				auto& side = takeA ? a : b;
+				if (side.top().level >= 0) {
+					side.expand();
+					continue;
+				}
+				MapDiff d{ side.top().key };
+				(takeA ? d.from : d.to) = side.top().value;
+				side.pop();
+				if (!f(d)) {
+					return;
+				}
+				continue;
+			}
+			const auto& x = a.top();
+			const auto& y = b.top();
+			if (x.level >= 0 && y.level >= 0 && x.value == y.value) {
+				// the same subtree on both sides
+				a.pop();
+				b.pop();
+				continue;
+			}
+			if (x.level < 0 && y.level < 0) {
+				MapDiff d{ std::min(x.key, y.key) };
+				if (x.key <= y.key) {
+					d.from = x.value;
+				}
+				if (y.key <= x.key) {
+					d.to = y.value;
+				}
+				if (d.from) {
+					a.pop();
+				}
+				if (d.to) {
+					b.pop();
+				}
+				if (d.from != d.to && !f(d)) {
+					return;
+				}
+				continue;
+			}
+			// overlapping and different: open the taller one, or both
+			const int level = std::max(x.level, y.level);
+			const bool expandA = x.level == level;
+			const bool expandB = y.level == level;
+			if (expandA) {
+				a.expand();
+			}
+			if (expandB) {
+				b.expand();
+			}
+		}
+	}
+
+	MapEditor& MapEditor::put(std::string_view key, std::string_view value) {
+		edits.insert_or_assign(std::string(key), std::string(value));
+		return *this;
+	}
+
+	MapEditor& MapEditor::remove(std::string_view key) {
+		edits.insert_or_assign(std::string(key), std::nullopt);
+		return *this;
+	}
+
+	ProllyMap MapEditor::apply() {
+		if (edits.empty()) {
+			return base;
+		}
+		TreeEditor editor(*base.store, base.root, base.options.nodeSize);
+		ProllyMap result(*base.store, editor.apply(std::move(edits)), base.options);
+		edits.clear();
+		return result;
+	}
+}
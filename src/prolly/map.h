@@ -0,0 +1,83 @@
+#pragma once
+#include "common.h"
+#include "chunks/all.h"
+#include "node.h"
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace nomp {
+	struct MapOptions {
+		size_t nodeSize = DefaultMapNodeSize; // mean entries per node
+		size_t prefetch = 16; // sibling nodes fetched together while iterating
+	};
+
+	// MapDiff is one key whose value differs between two maps; |from| or |to| is
+	// empty where the key is missing.
+	struct MapDiff {
+		std::string key;
+		std::optional<std::string> from;
+		std::optional<std::string> to;
+	};
+
+	class MapEditor;
+
+	// ProllyMap is an immutable ordered map of byte strings, stored in a ChunkStore
+	// as a prolly tree: a B-tree whose node boundaries are picked by hashing keys
+	// (see isBoundary), so the same entries always make the same tree and the same
+	// root hash. A map is just its root address; edits write new nodes for the paths
+	// they change and return a new map, sharing everything else with the old one.
+	// Nodes are put but never committed, commit hash() to keep a map.
+	class ProllyMap {
+		interface::IChunkStore* store;
+		Hash root; // empty for the empty map
+		MapOptions options;
+
+		friend class MapEditor;
+	public:
+		using Visit = std::function<bool(std::string_view key, std::string_view value)>;
+
+		explicit ProllyMap(interface::IChunkStore& store, const Hash& root = Hash(), const MapOptions& options = {});
+
+		const Hash& hash() const { return root; }
+		bool empty() const { return root.isEmpty(); }
+		uint64_t count() const;
+		std::optional<std::string> get(std::string_view key) const;
+		bool has(std::string_view key) const { return get(key).has_value(); }
+
+		ProllyMap put(std::string_view key, std::string_view value) const;
+		ProllyMap remove(std::string_view key) const;
+		// Starts a batch of edits, which is much cheaper than one edit at a time.
+		MapEditor edit() const;
+
+		// Calls |f| on the entries with from <= key < to, in order, until it returns
+		// false. Without |to| the range runs to the end of the map.
+		void range(std::string_view from, std::optional<std::string_view> to, const Visit& f) const;
+		void forEach(const Visit& f) const { range({}, std::nullopt, f); }
+
+		// Calls |f| in key order on every key that differs between |from| and this map,
+		// until it returns false. Subtrees the maps share are skipped by address, so
+		// the cost grows with the difference rather than with the maps.
+		void diff(const ProllyMap& from, const std::function<bool(const MapDiff&)>& f) const;
+	};
+
+	// MapEditor collects edits to a map and applies them in one pass, rewriting each
+	// affected node once however many edits land in it.
+	class MapEditor {
+		ProllyMap base;
+		std::map<std::string, std::optional<std::string>, std::less<>> edits; // empty deletes
+	public:
+		explicit MapEditor(const ProllyMap& base) : base(base) {}
+
+		MapEditor& put(std::string_view key, std::string_view value);
+		MapEditor& remove(std::string_view key);
+		size_t size() const { return edits.size(); }
+
+		// Writes the changed nodes and returns the edited map. The editor is empty
+		// afterwards.
+		ProllyMap apply();
+	};
+}
@@ -0,0 +1,53 @@
+#include <benchmark/benchmark.h>
+#include "map.h"
+#include "chunks/memory_store.h"
+#include <random>
+#include <string>
+
+using namespace nomp;
+
+static ProllyMap makeMap(interface::IChunkStore& store, int64_t n) {
+	auto editor = ProllyMap(store).edit();
+	for (int64_t i = 0; i < n; ++i) {
+		editor.put(std::to_string(i * 2), std::string(32, 'v'));
+	}
+	return editor.apply();
+}
+
+// Args: map size, edits per batch
+static void BM_MapBatchEdit(benchmark::State& state) {
+	MemoryStoreFactory factory;
+	auto store = factory.createStore("bench");
+	const auto base = makeMap(store, state.range(0));
+	std::mt19937_64 rng(1);
+	for (auto _ : state) {
+		auto editor = base.edit();
+		for (int64_t i = 0; i < state.range(1); ++i) {
+			editor.put(std::to_string(rng() % uint64_t(state.range(0) * 2)), std::string(32, 'e'));
+		}
+		benchmark::DoNotOptimize(editor.apply());
+	}
+	state.SetItemsProcessed(int64_t(state.iterations()) * state.range(1));
+}
+BENCHMARK(BM_MapBatchEdit)->ArgsProduct({ { 1 << 16 }, { 1, 64, 4096 } });
+
+// Args: map size, edits between the two versions
+static void BM_MapDiff(benchmark::State& state) {
+	MemoryStoreFactory factory;
+	auto store = factory.createStore("bench");
+	const auto from = makeMap(store, state.range(0));
+	auto editor = from.edit();
+	for (int64_t i = 0; i < state.range(1); ++i) {
+		editor.put(std::to_string(i * 2 + 1), "new");
+	}
+	const auto to = editor.apply();
+	for (auto _ : state) {
+		size_t n = 0;
+		to.diff(from, [&](const MapDiff&) {
+			++n;
+			return true;
+		});
+		benchmark::DoNotOptimize(n);
+	}
+}
+BENCHMARK(BM_MapDiff)->ArgsProduct({ { 1 << 16 }, { 1, 64, 4096 } });
@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+#include "map.h"
+#include "chunks/memory_store.h"
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace nomp;
+
+namespace {
+	std::string keyOf(int i) {
+		auto s = std::to_string(i);
+		return std::string(8 - s.size(), '0') + s;
+	}
+
+	// Checks |m| against |want| through every read path.
+	void expectMap(const ProllyMap& m, const std::map<std::string, std::string>& want) {
+		EXPECT_EQ(m.count(), want.size());
+		std::vector<std::pair<std::string, std::string>> got;
+		m.forEach([&](std::string_view k, std::string_view v) {
+			got.emplace_back(k, v);
+			return true;
+		});
+		EXPECT_EQ(got, (std::vector<std::pair<std::string, std::string>>(want.begin(), want.end())));
+		for (const auto& [k, v] : want) {
+			EXPECT_EQ(m.get(k), v);
+		}
+	}
+}
+
+TEST(MapTest, TestMapEdits) {
+	MemoryStoreFactory factory;
+	auto store = factory.createStore("map");
+	std::mt19937_64 rng(1);
+	std::map<std::string, std::string> want;
+	ProllyMap m(store, Hash(), MapOptions{ 8, 4 });
+	EXPECT_TRUE(m.empty());
+	EXPECT_FALSE(m.get("x").has_value());
+
+	for (int round = 0; round < 20; ++round) {
+		auto editor = m.edit();
+		for (int i = 0; i < 200; ++i) {
+			const auto k = keyOf(int(rng() % 3000));
+			if (rng() % 3 == 0) {
+				editor.remove(k);
+				want.erase(k);
+			}
+			else {
+				const auto v = "v" + std::to_string(round) + "." + std::to_string(i);
+				editor.put(k, v);
+				want[k] = v;
+			}
+		}
+		m = editor.apply();
+		expectMap(m, want);
+	}
+
+	// the tree depends on the entries alone, not on how they got there
+	auto fresh = ProllyMap(store, Hash(), MapOptions{ 8, 4 }).edit();
+	for (const auto& [k, v] : want) {
+		fresh.put(k, v);
+	}
+	EXPECT_EQ(fresh.apply().hash(), m.hash());
+
+	// single edits and ranges
+	const auto before = m;
+	m = m.put("zz", "last").remove(want.begin()->first);
+	EXPECT_EQ(m.get("zz"), "last");
+	EXPECT_FALSE(m.has(want.begin()->first));
+	EXPECT_EQ(m.remove("zz").put(want.begin()->first, want.begin()->second).hash(), before.hash());
+	std::vector<std::string> keys;
+	m.range(keyOf(1000), keyOf(1100), [&](std::string_view k, std::string_view) {
+		keys.emplace_back(k);
+		return true;
+	});
+	std::vector<std::string> wantKeys;
+	for (auto it = want.lower_bound(keyOf(1000)); it != want.lower_bound(keyOf(1100)); ++it) {
+		wantKeys.push_back(it->first);
+	}
+	EXPECT_EQ(keys, wantKeys);
+
+	// removing everything leaves the empty map
+	auto clear = m.edit();
+	m.forEach([&](std::string_view k, std::string_view) {
+		clear.remove(k);
+		return true;
+	});
+	EXPECT_TRUE(clear.apply().empty());
+}
+
+TEST(MapTest, TestMapDiff) {
+	MemoryStoreFactory factory;
+	auto store = factory.createStore("map");
+	auto editor = ProllyMap(store).edit();
+	for (int i = 0; i < 20000; ++i) {
+		editor.put(keyOf(i), "v" + std::to_string(i));
+	}
+	const auto from = editor.apply();
+	const auto to = from.edit().put(keyOf(5), "changed").remove(keyOf(7000)).put(keyOf(99999), "added").apply();
+
+	std::vector<MapDiff> diffs;
+	to.diff(from, [&](const MapDiff& d) {
+		diffs.push_back(d);
+		return true;
+	});
+	ASSERT_EQ(diffs.size(), 3u);
+	EXPECT_EQ(diffs[0].key, keyOf(5));
+	EXPECT_EQ(diffs[0].from, "v5");
+	EXPECT_EQ(diffs[0].to, "changed");
+	EXPECT_EQ(diffs[1].key, keyOf(7000));
+	EXPECT_FALSE(diffs[1].to.has_value());
+	EXPECT_EQ(diffs[2].key, keyOf(99999));
+	EXPECT_FALSE(diffs[2].from.has_value());
+
+	// everything against nothing, and nothing against itself
+	size_t added = 0;
+	from.diff(ProllyMap(store), [&](const MapDiff& d) {
+		added += d.from ? 0 : 1;
+		return true;
+	});
+	EXPECT_EQ(added, 20000u);
+	from.diff(from, [](const MapDiff&) {
+		ADD_FAILURE();
+		return true;
+	});
+
+	// a map's nodes are a ref graph any walker can follow
+	interface::IRefDecoder decoder = pro::make_proxy<interface::RefDecoder, RefListDecoder>();
+	std::vector<Hash> roots{ to.hash() };
+	uint64_t leafEntries = 0;
+	std::mutex mtx;
+	walk(store, roots, decoder, [&](const Chunk& c) {
+		const auto node = Node::decode(c);
+		std::lock_guard lock(mtx);
+		leafEntries += node.leaf() ? node.size() : 0;
+		return true;
+	});
+	EXPECT_EQ(leafEntries, to.count());
+}
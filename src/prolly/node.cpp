@@ -0,0 +1,141 @@
+#include "node.h"
+#include "binary/binary.h"
+#include <stdexcept>
+
+namespace nomp {
+	/*
+		Prolly node payload, after the RefList refs:
+			Level // 1 byte
+			Entry count // 4 bytes
+			Entries:
+				Key length // 4 bytes
+				Key
+				Leaf: Value length // 4 bytes
+				Leaf: Value
+				Internal: Leaf entry count // 8 bytes
+	*/
+	constexpr size_t RefListCountSize = 4; // bytes
+	constexpr size_t NodeLenSize = 4; // bytes
+	constexpr size_t NodeCountSize = 8; // bytes
+	constexpr size_t RefValueSize = ByteLen + NodeCountSize;
+
+	std::string makeRefValue(const Hash& ref, uint64_t count) {
+		std::string value(RefValueSize, '\0');
+		const std::span<const std::byte> bytes(ref);
+		std::copy(bytes.begin(), bytes.end(), (std::byte*)value.data());
+		BigEndian::storeUint64((std::byte*)value.data() + ByteLen, count);
+		return value;
+	}
+
+	Hash Node::ref(size_t i) const {
+		return Hash(std::span{ values[i].data(), size_t(ByteLen) });
+	}
+
+	uint64_t Node::count(size_t i) const {
+		return BigEndian::loadUint64((const std::byte*)values[i].data() + ByteLen);
+	}
+
+	uint64_t Node::count() const {
+		if (leaf()) {
+			return keys.size();
+		}
+		uint64_t total = 0;
+		for (size_t i = 0; i < keys.size(); ++i) {
+			total += count(i);
+		}
+		return total;
+	}
+
+	Chunk Node::encode() const {
+		std::vector<Hash> refs;
+		size_t size = 1 + NodeLenSize;
+		for (size_t i = 0; i < keys.size(); ++i) {
+			size += NodeLenSize + keys[i].size();
+			if (leaf()) {
+				size += NodeLenSize + values[i].size();
+			}
+			else {
+				size += NodeCountSize;
+				refs.push_back(ref(i));
+			}
+		}
+		std::vector<std::byte> payload(size);
+		std::byte* p = payload.data();
+		auto putBytes = [&](std::string_view s) {
+			BigEndian::storeUint32(p, uint32_t(s.size()));
+			p = std::copy((const std::byte*)s.data(), (const std::byte*)s.data() + s.size(), p + NodeLenSize);
+		};
+		*p++ = std::byte(level);
+		BigEndian::storeUint32(p, uint32_t(keys.size()));
+		p += NodeLenSize;
+		for (size_t i = 0; i < keys.size(); ++i) {
+			putBytes(keys[i]);
+			if (leaf()) {
+				putBytes(values[i]);
+			}
+			else {
+				BigEndian::storeUint64(p, count(i));
+				p += NodeCountSize;
+			}
+		}
+		return RefListDecoder::encode(refs, payload);
+	}
+
+	Node Node::decode(const Chunk& chunk) {
+		std::vector<Hash> refs;
+		RefListDecoder().refs(chunk, refs);
+		const auto data = chunk.data();
+		auto bytes = data.span().subspan(RefListCountSize + refs.size() * ByteLen);
+		auto need = [&](size_t n) {
+			if (bytes.size() < n) {
+				throw std::runtime_error("Chunk " + chunk.hash().toString() + " is not a prolly node");
+			}
+		};
+		auto takeBytes = [&] {
+			need(NodeLenSize);
+			const size_t n = BigEndian::loadUint32(bytes.data());
+			need(NodeLenSize + n);
+			std::string s((const char*)bytes.data() + NodeLenSize, n);
+			bytes = bytes.subspan(NodeLenSize + n);
+			return s;
+		};
+		Node node;
+		need(1 + NodeLenSize);
+		node.level = uint8_t(bytes[0]);
+		const size_t n = BigEndian::loadUint32(bytes.data() + 1);
+		bytes = bytes.subspan(1 + NodeLenSize);
+		if ((node.leaf() ? 0 : n) != refs.size()) {
+			throw std::runtime_error("Chunk " + chunk.hash().toString() + " is not a prolly node");
+		}
+		node.keys.reserve(n);
+		node.values.reserve(n);
+		for (size_t i = 0; i < n; ++i) {
+			node.keys.push_back(takeBytes());
+			if (node.leaf()) {
+				node.values.push_back(takeBytes());
+			}
+			else {
+				need(NodeCountSize);
+				node.values.push_back(makeRefValue(refs[i], BigEndian::loadUint64(bytes.data())));
+				bytes = bytes.subspan(NodeCountSize);
+			}
+		}
+		if (!bytes.empty()) {
+			throw std::runtime_error("Chunk " + chunk.hash().toString() + " is not a prolly node");
+		}
+		return node;
+	}
+
+	bool isBoundary(std::string_view key, uint8_t level, size_t nodeSize) {
+		// FNV-1a, seeded per level so a key that ends a node does not end its parent too
+		uint64_t h = 0xCBF29CE484222325 ^ (uint64_t(level) * 0x9E3779B97F4A7C15);
+		for (const char c : key) {
+			h = (h ^ uint8_t(c)) * 0x100000001B3;
+		}
+		// finish with a splitmix64 round so the low bits are as good as the high ones
+		h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9;
+		h = (h ^ (h >> 27)) * 0x94D049BB133111EB;
+		h ^= h >> 31;
+		return h % nodeSize == 0;
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include "common.h"
+#include "chunks/all.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace nomp {
+	constexpr size_t DefaultMapNodeSize = 64; // mean entries per node
+
+	// Node is one chunk of a prolly tree. Leaves (level 0) map keys to values;
+	// internal nodes map the last key of each child to the child's address and the
+	// number of leaf entries below it, kept as the entry's value (see makeRefValue).
+	struct Node {
+		uint8_t level = 0;
+		std::vector<std::string> keys; // ascending
+		std::vector<std::string> values;
+
+		bool leaf() const { return level == 0; }
+		size_t size() const { return keys.size(); }
+		Hash ref(size_t i) const;
+		uint64_t count(size_t i) const;
+		// Leaf entries under this node.
+		uint64_t count() const;
+
+		// Nodes are stored in the RefList encoding with their children as refs, so a
+		// RefListDecoder can walk a map.
+		Chunk encode() const;
+		// Throws std::runtime_error if |chunk| is not a node.
+		static Node decode(const Chunk& chunk);
+	};
+
+	// The value of an internal entry: the child's address and its leaf entry count.
+	std::string makeRefValue(const Hash& ref, uint64_t count);
+
+	// A node at |level| ends after |key| if key hashes to a boundary for that level,
+	// which happens once in |nodeSize| keys. Boundaries depend on keys alone, so a
+	// map's tree is the same whatever order its entries were written in.
+	bool isBoundary(std::string_view key, uint8_t level, size_t nodeSize);
+}
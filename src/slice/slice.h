@@ -4,6 +4,7 @@
 #include <string>
 #include <string_view>
 #include <memory>
+#include <vector>
 
 namespace nomp {
 	class ByteSlice {
@@ -22,6 +23,11 @@ namespace nomp {
 		ByteSlice(std::span<const std::byte> src) :data(std::make_shared<std::byte[]>(src.size())), offset(0), sz(src.size()) {
 			std::copy(src.begin(), src.end(), data.get());
 		}
+		// Takes over |src|'s buffer instead of copying it.
+		ByteSlice(std::vector<std::byte>&& src) : offset(0), sz(src.size()) {
+			auto owner = std::make_shared<std::vector<std::byte>>(std::move(src));
+			data = std::shared_ptr<std::byte[]>(owner, owner->data());
+		}
 		ByteSlice(std::string src) :data(std::make_shared<std::byte[]>(src.size())), offset(0), sz(src.size()) {
 			std::copy((std::byte*)src.data(), (std::byte*)src.data() + src.size(), data.get());
 		}
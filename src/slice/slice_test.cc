@@ -89,4 +89,16 @@ TEST(SliceTest, TestSliceConcat) {
 	ByteSlice combined = slice1 + slice2;
 	EXPECT_EQ(combined.size(), str1.size() + str2.size());
 	EXPECT_EQ(std::string((char*)combined.span().data(), combined.size()), "Hello, World!");
-}
\ No newline at end of file
+}
+
+TEST(SliceTest, TestSliceFromVector) {
+	std::vector<std::byte> bytes(1000, std::byte{ 7 });
+	const std::byte* raw = bytes.data();
+	ByteSlice slice(std::move(bytes));
+	EXPECT_EQ(slice.size(), 1000u);
+	EXPECT_EQ(slice.span().data(), raw); // adopted, not copied
+	EXPECT_EQ(slice[999], std::byte{ 7 });
+
+	ByteSlice empty(std::vector<std::byte>{});
+	EXPECT_TRUE(empty.empty());
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "chunks/chunk.h"
+#include <algorithm>
+#include <filesystem>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+
+// Helpers shared by the *_test.cc and *_bench.cc files.
+namespace nomp::test {
+	// Returns |n| distinct chunks of |size| bytes: the decimal index, from |first| on,
+	// padded with |fill|.
+	inline std::vector<Chunk> makeChunks(size_t n, size_t size, size_t first = 0, char fill = 'c') {
+		std::vector<Chunk> chunks;
+		chunks.reserve(n);
+		for (size_t i = first; i < first + n; ++i) {
+			auto s = std::to_string(i);
+			s.resize(std::max(size, s.size()), fill);
+			chunks.emplace_back(Chunk::FromString(s));
+		}
+		return chunks;
+	}
+
+	// Returns |n| chunks of |size| bytes that compress like real data: a random head
+	// keeps them distinct, a zero tail keeps them compressible.
+	inline std::vector<Chunk> makeCompressibleChunks(size_t n, size_t size) {
+		std::mt19937_64 rng(n ^ size);
+		std::vector<Chunk> chunks;
+		chunks.reserve(n);
+		std::vector<std::byte> buf(size);
+		for (size_t i = 0; i < n; ++i) {
+			for (size_t j = 0; j < std::min<size_t>(size, 64); ++j) {
+				buf[j] = std::byte(rng());
+			}
+			chunks.emplace_back(std::span{ buf });
+		}
+		return chunks;
+	}
+
+	// Returns the path |name| under the system temp directory.
+	inline std::string tempPath(const std::string& name) {
+		return (std::filesystem::temp_directory_path() / name).string();
+	}
+
+	// Returns tempPath(name) after removing whatever an earlier run left there.
+	inline std::string tempDir(const std::string& name) {
+		auto dir = tempPath(name);
+		std::filesystem::remove_all(dir);
+		return dir;
+	}
+}
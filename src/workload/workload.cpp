@@ -0,0 +1,368 @@
+#include "workload.h"
+#include "chunks/memory_store.h"
+#include "nbs/store.h"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+
+namespace nomp {
+	static double zeta(uint64_t n, double theta) {
+		double sum = 0;
+		for (uint64_t i = 1; i <= n; ++i) {
+			sum += 1 / std::pow(double(i), theta);
+		}
+		return sum;
+	}
+
+	ZipfGenerator::ZipfGenerator(uint64_t n, double theta) : n(n), theta(theta) {
+		if (n == 0) {
+			throw std::invalid_argument("ZipfGenerator needs at least one value");
+		}
+		if (theta < 0 || theta >= 1) {
+			throw std::invalid_argument("Zipf theta must be in [0, 1)");
+		}
+		zetan = zeta(n, theta);
+		alpha = 1 / (1 - theta);
+		eta = n < 2 ? 1 : (1 - std::pow(2.0 / double(n), 1 - theta)) / (1 - zeta(2, theta) / zetan);
+	}
+
+	uint64_t ZipfGenerator::next(std::mt19937_64& rng) const {
+		const double u = std::uniform_real_distribution<double>(0, 1)(rng);
+		const double uz = u * zetan;
+		if (uz < 1) {
+			return 0;
+		}
+		if (n > 1 && uz < 1 + std::pow(0.5, theta)) {
+			return 1;
+		}
+		return std::min(n - 1, uint64_t(double(n) * std::pow(eta * u - eta + 1, alpha)));
+	}
+
+	static double parseNumber(std::string_view s, std::string_view what) {
+		double v = 0;
+		auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), v);
+		if (ec != std::errc() || end != s.data() + s.size()) {
+			throw std::invalid_argument(std::format("Invalid {}: '{}'", what, s));
+		}
+		return v;
+	}
+
+	SizeDistribution SizeDistribution::parse(std::string_view spec) {
+		const auto colon = spec.find(':');
+		if (colon == std::string_view::npos) {
+			throw std::invalid_argument(std::format("Invalid size distribution '{}'", spec));
+		}
+		const auto kind = spec.substr(0, colon);
+		const auto args = spec.substr(colon + 1);
+		SizeDistribution d;
+		if (kind == "fixed") {
+			d.kind = Kind::Fixed;
+			d.a = parseNumber(args, "chunk size");
+		}
+		else if (kind == "uniform" || kind == "lognormal") {
+			const auto sep = args.find(kind == "uniform" ? '-' : ',');
+			if (sep == std::string_view::npos) {
+				throw std::invalid_argument(std::format("Invalid size distribution '{}'", spec));
+			}
+			d.kind = kind == "uniform" ? Kind::Uniform : Kind::LogNormal;
+			d.a = parseNumber(args.substr(0, sep), "chunk size");
+			d.b = parseNumber(args.substr(sep + 1), "chunk size");
+			if (d.kind == Kind::Uniform && d.b < d.a) {
+				throw std::invalid_argument(std::format("Invalid size range '{}'", args));
+			}
+		}
+		else {
+			throw std::invalid_argument(std::format("Unknown size distribution '{}'", kind));
+		}
+		if (d.a < 1 || d.a > double(MaxWorkloadChunkSize) || (d.kind == Kind::Uniform && d.b > double(MaxWorkloadChunkSize))) {
+			throw std::invalid_argument(std::format("Chunk sizes must be in [1, {}]", MaxWorkloadChunkSize));
+		}
+		return d;
+	}
+
+	size_t SizeDistribution::sample(std::mt19937_64& rng) const {
+		switch (kind) {
+		case Kind::Fixed:
+			return size_t(a);
+		case Kind::Uniform:
+			return std::uniform_int_distribution<size_t>(size_t(a), size_t(b))(rng);
+		case Kind::LogNormal:
+			return size_t(std::clamp(std::lognormal_distribution<double>(std::log(a), b)(rng), 1.0, double(MaxWorkloadChunkSize)));
+		}
+		return size_t(a);
+	}
+
+	std::string_view workloadOpName(WorkloadOp op) {
+		switch (op) {
+		case WorkloadOp::Put: return "put";
+		case WorkloadOp::Get: return "get";
+		case WorkloadOp::GetMany: return "getMany";
+		case WorkloadOp::Has: return "has";
+		case WorkloadOp::Absent: return "absent";
+		case WorkloadOp::Commit: return "commit";
+		}
+		return "unknown";
+	}
+
+	WorkloadOptions WorkloadOptions::parse(std::span<const std::string_view> args) {
+		WorkloadOptions o;
+		for (auto arg : args) {
+			if (!arg.starts_with("--") || arg.find('=') == std::string_view::npos) {
+				throw std::invalid_argument(std::format("Expected --name=value, got '{}'", arg));
+			}
+			const auto eq = arg.find('=');
+			const auto name = arg.substr(2, eq - 2);
+			auto value = arg.substr(eq + 1);
+			if (name == "store") o.store = value;
+			else if (name == "threads") o.threads = size_t(parseNumber(value, "thread count"));
+			else if (name == "ops") o.ops = uint64_t(parseNumber(value, "operation count"));
+			else if (name == "seconds") o.seconds = parseNumber(value, "duration");
+			else if (name == "keys") o.keys = uint64_t(parseNumber(value, "key count"));
+			else if (name == "zipf") o.zipf = parseNumber(value, "zipf theta");
+			else if (name == "sizes") o.sizes = SizeDistribution::parse(value);
+			else if (name == "batch") o.batch = size_t(parseNumber(value, "batch size"));
+			else if (name == "commit-every") o.commitEvery = uint64_t(parseNumber(value, "commit interval"));
+			else if (name == "seed") o.seed = uint64_t(parseNumber(value, "seed"));
+			else if (name == "mix") {
+				// put:20,get:50,...; operations left out get no weight
+				o.mix.fill(0);
+				while (!value.empty()) {
+					const auto comma = value.find(',');
+					const auto item = value.substr(0, comma);
+					const auto colon = item.find(':');
+					if (colon == std::string_view::npos) {
+						throw std::invalid_argument(std::format("Invalid mix entry '{}'", item));
+					}
+					const auto op = item.substr(0, colon);
+					size_t i = 0;
+					while (i < o.mix.size() && workloadOpName(WorkloadOp(i)) != op) ++i;
+					if (i == o.mix.size()) {
+						throw std::invalid_argument(std::format("Unknown operation '{}' in mix", op));
+					}
+					o.mix[i] = parseNumber(item.substr(colon + 1), "mix weight");
+					value = comma == std::string_view::npos ? std::string_view() : value.substr(comma + 1);
+				}
+			}
+			else {
+				throw std::invalid_argument(std::format("Unknown option --{}", name));
+			}
+		}
+		if (o.threads == 0 || o.keys == 0 || o.batch == 0) {
+			throw std::invalid_argument("threads, keys and batch must be at least 1");
+		}
+		if (std::all_of(o.mix.begin(), o.mix.end(), [](double w) { return w <= 0; })) {
+			throw std::invalid_argument("The operation mix is empty");
+		}
+		return o;
+	}
+
+	uint64_t WorkloadReport::ops() const {
+		uint64_t n = 0;
+		for (const auto& h : latency) {
+			n += h.count();
+		}
+		return n;
+	}
+
+	std::string WorkloadReport::render() const {
+		std::string out = std::format("{} operations in {:.2f}s, {:.0f} ops/s\n", ops(), seconds, seconds > 0 ? double(ops()) / seconds : 0);
+		out += std::format("{:<10} {:>10} {:>12} {:>10} {:>10} {:>10} {:>10}\n", "op", "count", "ops/s", "p50", "p99", "p999", "max");
+		for (size_t i = 0; i < WorkloadOpCount; ++i) {
+			const auto& h = latency[i];
+			if (h.count() == 0) {
+				continue;
+			}
+			out += std::format("{:<10} {:>10} {:>12.0f} {:>10} {:>10} {:>10} {:>10}\n", workloadOpName(WorkloadOp(i)), h.count(),
+				seconds > 0 ? double(h.count()) / seconds : 0, formatNanos(h.percentile(0.5)), formatNanos(h.percentile(0.99)),
+				formatNanos(h.percentile(0.999)), formatNanos(h.max));
+		}
+		if (latency[size_t(WorkloadOp::Commit)].count() > 0) {
+			out += std::format("commit conflicts: {}\n", commitConflicts);
+		}
+		if (!storeStats.empty()) {
+			out += "\nstore statistics:\n" + storeStats;
+		}
+		return out;
+	}
+
+	// The content of chunk |key|: its number followed by bytes derived from it, so
+	// every key has a distinct, reproducible chunk.
+	static Chunk makeChunk(uint64_t key, size_t size) {
+		std::vector<std::byte> data(std::max<size_t>(size, sizeof(key)));
+		std::mt19937_64 rng(key);
+		for (size_t i = 0; i < data.size(); i += sizeof(uint64_t)) {
+			const uint64_t word = i == 0 ? key : rng();
+			std::memcpy(data.data() + i, &word, std::min(sizeof(word), data.size() - i));
+		}
+		return Chunk(std::span{ data });
+	}
+
+	WorkloadReport runWorkload(interface::IChunkStore& store, const WorkloadOptions& options) {
+		// load the keyspace that reads pick from
+		std::vector<Hash> keys;
+		keys.reserve(options.keys);
+		{
+			std::mt19937_64 rng(options.seed);
+			for (uint64_t k = 0; k < options.keys; ++k) {
+				auto chunk = makeChunk(k, options.sizes.sample(rng));
+				keys.push_back(chunk.hash());
+				store->put(chunk);
+			}
+			store->commit(keys.back(), store->root());
+		}
+		const ZipfGenerator zipf(options.keys, options.zipf);
+		std::discrete_distribution<size_t> pickOp(options.mix.begin(), options.mix.end());
+
+		std::atomic<uint64_t> budget = 0;
+		std::atomic<uint64_t> nextKey = options.keys;
+		std::atomic<uint64_t> conflicts = 0;
+		const auto start = std::chrono::steady_clock::now();
+		const auto deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(options.seconds));
+		std::vector<std::array<Histogram, WorkloadOpCount>> perThread(options.threads);
+
+		auto worker = [&](size_t t) {
+			auto& latency = perThread[t];
+			std::mt19937_64 rng(options.seed * 0x9E3779B97F4A7C15ULL + t + 1);
+			auto ops = pickOp;
+			uint64_t puts = 0;
+			auto timed = [&](WorkloadOp op, auto&& f) {
+				const auto begin = std::chrono::steady_clock::now();
+				f();
+				latency[size_t(op)].record(uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count()));
+			};
+			while (true) {
+				if (options.seconds > 0 ? std::chrono::steady_clock::now() >= deadline : budget.fetch_add(1) >= options.ops) {
+					break;
+				}
+				const auto op = WorkloadOp(ops(rng));
+				switch (op) {
+				case WorkloadOp::Put: {
+					auto chunk = makeChunk(nextKey.fetch_add(1), options.sizes.sample(rng));
+					timed(op, [&] { store->put(chunk); });
+					if (options.commitEvery > 0 && ++puts % options.commitEvery == 0) {
+						timed(WorkloadOp::Commit, [&] {
+							if (!store->commit(chunk.hash(), store->root())) {
+								++conflicts;
+								store->rebase();
+							}
+						});
+					}
+					break;
+				}
+				case WorkloadOp::Get: {
+					const auto& h = keys[zipf.next(rng)];
+					timed(op, [&] { store->get(h); });
+					break;
+				}
+				case WorkloadOp::GetMany:
+				case WorkloadOp::Absent: {
+					HashSet hashes;
+					for (size_t i = 0; i < options.batch; ++i) {
+						if (op == WorkloadOp::Absent && i % 2 == 1) {
+							// every other hash names a chunk that was never written
+							hashes.insert(makeChunk(~rng(), 8).hash());
+						}
+						else {
+							hashes.insert(keys[zipf.next(rng)]);
+						}
+					}
+					if (op == WorkloadOp::GetMany) {
+						timed(op, [&] { store->getMany(hashes); });
+					}
+					else {
+						timed(op, [&] { store->absent(hashes); });
+					}
+					break;
+				}
+				case WorkloadOp::Has: {
+					const auto& h = keys[zipf.next(rng)];
+					timed(op, [&] { store->has(h); });
+					break;
+				}
+				case WorkloadOp::Commit:
+					break;
+				}
+			}
+		};
+		std::vector<std::thread> threads;
+		for (size_t t = 0; t < options.threads; ++t) {
+			threads.emplace_back(worker, t);
+		}
+		for (auto& t : threads) {
+			t.join();
+		}
+
+		WorkloadReport report;
+		report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		for (const auto& latency : perThread) {
+			for (size_t i = 0; i < WorkloadOpCount; ++i) {
+				report.latency[i].merge(latency[i]);
+			}
+		}
+		report.commitConflicts = conflicts;
+		report.storeStats = store->statsSummary();
+		return report;
+	}
+
+	static constexpr std::string_view WorkloadUsage = R"(usage: nomp workload [--name=value ...]
+
+  --store=memory|nbs|nbs-file:<dir>  store to drive (default memory)
+  --threads=N                        concurrent clients (default 4)
+  --ops=N                            total operations (default 100000)
+  --seconds=S                        run for S seconds instead of --ops
+  --keys=N                           chunks loaded before the run (default 10000)
+  --zipf=THETA                       key popularity skew in [0, 1) (default 0.99)
+  --sizes=fixed:N|uniform:A-B|lognormal:MEDIAN,SIGMA
+                                     chunk sizes (default lognormal:4096,1)
+  --mix=put:W,get:W,getMany:W,has:W,absent:W
+                                     operation weights (default 20,50,10,15,5)
+  --batch=N                          hashes per getMany or absent (default 16)
+  --commit-every=N                   puts per thread between commits (default 1000)
+  --seed=N                           random seed (default 1)
+)";
+
+	int workloadMain(std::span<const std::string_view> args) {
+		WorkloadOptions options;
+		try {
+			options = WorkloadOptions::parse(args);
+		}
+		catch (const std::invalid_argument& e) {
+			std::cerr << e.what() << "\n\n" << WorkloadUsage;
+			return 2;
+		}
+
+		MemoryStoreFactory memory;
+		NbsMemoryStoreFactory nbs;
+		std::optional<interface::IChunkStore> store;
+		if (options.store == "memory") {
+			store = memory.createStore("workload");
+		}
+		else if (options.store == "nbs") {
+			store = nbs.createStore("workload");
+		}
+		else if (options.store.starts_with("nbs-file:")) {
+			const auto dir = options.store.substr(std::string_view("nbs-file:").size());
+			std::filesystem::create_directories(dir);
+			store = pro::make_proxy<interface::ChunkStore, NomsBlockStore>(
+				interface::IManifest(pro::make_proxy<interface::Manifest, MemoryManifest>()),
+				interface::ITablePersister(pro::make_proxy<interface::TablePersister, FileTablePersister>(dir)));
+		}
+		else {
+			std::cerr << "Unknown store '" << options.store << "'\n\n" << WorkloadUsage;
+			return 2;
+		}
+
+		auto report = runWorkload(*store, options);
+		(*store)->close();
+		std::cout << report.render();
+		return 0;
+	}
+}
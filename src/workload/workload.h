@@ -0,0 +1,90 @@
+#pragma once
+#include "common.h"
+#include "chunks/all.h"
+#include <array>
+#include <cstdint>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace nomp {
+	// ZipfGenerator draws integers in [0, n) where the k-th most popular value is
+	// drawn with probability proportional to 1 / (k + 1)^theta, using the method of
+	// Gray et al., "Quickly Generating Billion-Record Synthetic Databases". theta = 0
+	// is uniform, theta close to 1 is heavily skewed towards the smallest values.
+	class ZipfGenerator {
+		uint64_t n;
+		double theta;
+		double zetan;
+		double alpha;
+		double eta;
+	public:
+		ZipfGenerator(uint64_t n, double theta);
+		uint64_t next(std::mt19937_64& rng) const;
+	};
+
+	// SizeDistribution describes the sizes of generated chunks. Specs are
+	// "fixed:<n>", "uniform:<min>-<max>" or "lognormal:<median>,<sigma>"; log-normal
+	// sizes are clamped to [1, MaxWorkloadChunkSize].
+	struct SizeDistribution {
+		enum class Kind { Fixed, Uniform, LogNormal };
+		Kind kind = Kind::Fixed;
+		double a = 4096; // size, min or median
+		double b = 0; // max or sigma
+
+		static SizeDistribution parse(std::string_view spec);
+		size_t sample(std::mt19937_64& rng) const;
+	};
+	constexpr size_t MaxWorkloadChunkSize = 1 << 24;
+
+	enum class WorkloadOp {
+		Put,
+		Get,
+		GetMany,
+		Has,
+		Absent,
+		Commit,
+	};
+	constexpr size_t WorkloadOpCount = 6;
+	std::string_view workloadOpName(WorkloadOp op);
+
+	// WorkloadOptions configures runWorkload. Every field can be set from the command
+	// line as --<name>=<value>, see parse().
+	struct WorkloadOptions {
+		std::string store = "memory"; // memory, nbs or nbs-file:<dir>
+		size_t threads = 4;
+		uint64_t ops = 100000; // total operations, across threads, excluding commits
+		double seconds = 0; // stop after this long instead, if set
+		uint64_t keys = 10000; // chunks loaded before the run, which reads pick from
+		double zipf = 0.99; // skew of key popularity
+		SizeDistribution sizes{ SizeDistribution::Kind::LogNormal, 4096, 1 };
+		// relative weights of put, get, getMany, has and absent
+		std::array<double, 5> mix{ 20, 50, 10, 15, 5 };
+		size_t batch = 16; // hashes per getMany or absent
+		uint64_t commitEvery = 1000; // puts per thread between commits, 0 to never commit
+		uint64_t seed = 1;
+
+		// Parses --name=value flags, throws std::invalid_argument on anything it does
+		// not understand.
+		static WorkloadOptions parse(std::span<const std::string_view> args);
+	};
+
+	struct WorkloadReport {
+		std::array<Histogram, WorkloadOpCount> latency; // nanoseconds
+		double seconds = 0;
+		uint64_t commitConflicts = 0; // commits that lost a race and rebased
+		std::string storeStats; // the store's statsSummary() after the run
+
+		uint64_t ops() const;
+		std::string render() const;
+	};
+
+	// Drives |store| with |options|: loads options.keys chunks and commits them, then
+	// runs the operation mix on options.threads threads until the budget is spent.
+	WorkloadReport runWorkload(interface::IChunkStore& store, const WorkloadOptions& options);
+
+	// Entry point of `nomp workload`, |args| excludes the subcommand itself.
+	int workloadMain(std::span<const std::string_view> args);
+}
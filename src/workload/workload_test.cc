@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+
+#include "workload.h"
+#include "chunks/memory_store.h"
+#include "nbs/store.h"
+#include <string_view>
+#include <vector>
+
+using namespace nomp;
+
+TEST(WorkloadTest, TestZipfSkew) {
+	std::mt19937_64 rng(3);
+	ZipfGenerator zipf(1000, 0.99);
+	std::vector<size_t> hits(1000);
+	for (int i = 0; i < 100000; ++i) {
+		auto k = zipf.next(rng);
+		ASSERT_LT(k, 1000u);
+		++hits[k];
+	}
+	// the head is far more popular than the tail, and popularity falls off with rank
+	EXPECT_GT(hits[0], 10 * hits[500]);
+	EXPECT_GT(hits[0], hits[1]);
+	EXPECT_GT(hits[1], hits[10]);
+
+	ZipfGenerator uniform(10, 0);
+	std::vector<size_t> flat(10);
+	for (int i = 0; i < 100000; ++i) {
+		++flat[uniform.next(rng)];
+	}
+	for (auto n : flat) {
+		EXPECT_NEAR(double(n), 10000, 1000);
+	}
+	EXPECT_THROW(ZipfGenerator(10, 1), std::invalid_argument);
+}
+
+TEST(WorkloadTest, TestSizeDistributions) {
+	std::mt19937_64 rng(5);
+	EXPECT_EQ(SizeDistribution::parse("fixed:512").sample(rng), 512u);
+	auto uniform = SizeDistribution::parse("uniform:100-200");
+	auto lognormal = SizeDistribution::parse("lognormal:4096,0.5");
+	std::vector<size_t> sizes;
+	for (int i = 0; i < 1000; ++i) {
+		auto s = uniform.sample(rng);
+		EXPECT_GE(s, 100u);
+		EXPECT_LE(s, 200u);
+		sizes.push_back(lognormal.sample(rng));
+	}
+	std::nth_element(sizes.begin(), sizes.begin() + 500, sizes.end());
+	EXPECT_NEAR(double(sizes[500]), 4096, 500);
+	EXPECT_THROW(SizeDistribution::parse("uniform:200-100"), std::invalid_argument);
+	EXPECT_THROW(SizeDistribution::parse("pareto:1,2"), std::invalid_argument);
+	EXPECT_THROW(SizeDistribution::parse("fixed:0"), std::invalid_argument);
+}
+
+TEST(WorkloadTest, TestParseOptions) {
+	std::vector<std::string_view> args{ "--threads=2", "--ops=500", "--mix=get:3,put:1", "--sizes=fixed:64", "--commit-every=10" };
+	auto options = WorkloadOptions::parse(args);
+	EXPECT_EQ(options.threads, 2u);
+	EXPECT_EQ(options.ops, 500u);
+	EXPECT_EQ(options.mix[size_t(WorkloadOp::Get)], 3);
+	EXPECT_EQ(options.mix[size_t(WorkloadOp::Put)], 1);
+	EXPECT_EQ(options.mix[size_t(WorkloadOp::Has)], 0);
+	EXPECT_EQ(options.commitEvery, 10u);
+
+	for (std::string_view bad : { "--nope=1", "--threads", "threads=1", "--mix=commit:1", "--mix=get:0", "--ops=lots" }) {
+		std::vector<std::string_view> one{ bad };
+		EXPECT_THROW(WorkloadOptions::parse(one), std::invalid_argument) << bad;
+	}
+}
+
+TEST(WorkloadTest, TestRunAgainstStores) {
+	std::vector<std::string_view> args{ "--threads=3", "--ops=3000", "--keys=200", "--sizes=uniform:16-256", "--commit-every=50" };
+	auto options = WorkloadOptions::parse(args);
+
+	MemoryStoreFactory memory;
+	NbsMemoryStoreFactory nbs(NbsOptions{ 1 << 14, 2 });
+	std::vector<interface::IChunkStore> stores;
+	stores.push_back(memory.createStore("w"));
+	stores.push_back(nbs.createStore("w"));
+	for (auto& store : stores) {
+		auto report = runWorkload(store, options);
+		uint64_t ops = 0;
+		for (size_t i = 0; i < WorkloadOpCount; ++i) {
+			if (WorkloadOp(i) != WorkloadOp::Commit) ops += report.latency[i].count();
+		}
+		EXPECT_EQ(ops, options.ops);
+		EXPECT_GT(report.latency[size_t(WorkloadOp::Get)].count(), 0u);
+		EXPECT_GT(report.latency[size_t(WorkloadOp::Commit)].count(), 0u);
+		auto text = report.render();
+		EXPECT_NE(text.find("getMany"), std::string::npos);
+		EXPECT_NE(text.find("store statistics"), std::string::npos);
+		store->close();
+	}
+}